@@ -26,6 +26,7 @@ call ROBO "../../ObjectivelyMVC/ObjectivelyMVC.vs15/libs/sdl_image/lib/%build_pl
 call ROBO "../../ObjectivelyMVC/ObjectivelyMVC.vs15/libs/sdl_ttf/lib/%build_platform%/" "%quetoo_folder%/bin/" *.dll
 
 call ROBO "libs/openal/bin/%build_platform%/" "%quetoo_folder%/bin/" *.dll
+call ROBO "libs/zlib/lib/%build_platform%/" "%quetoo_folder%/bin/" *.dll
 
 GOTO DONE
 
@@ -32,7 +32,7 @@
 
 #include "client/cl_types.h"
 
-#define CGAME_API_VERSION 20
+#define CGAME_API_VERSION 22
 
 /**
  * @brief The client game import struct imports engine functionailty to the client game.
@@ -125,8 +125,10 @@ typedef struct cg_import_s {
 	 * @param name The thread name.
 	 * @param run The thread function.
 	 * @param data User data.
+	 * @param options Thread options, e.g. THREAD_NO_WAIT.
+	 * @return The thread handle, which must be waited on unless THREAD_NO_WAIT is set.
 	 */
-	thread_t *(*Thread)(const char *name, ThreadRunFunc run, void *data);
+	thread_t *(*Thread)(const char *name, ThreadRunFunc run, void *data, thread_options_t options);
 
 	/**
 	 * @}
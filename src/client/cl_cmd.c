@@ -120,7 +120,7 @@ void Cl_SendCommands(void) {
 		case CL_CONNECTED:
 		case CL_LOADING:
 
-			if (cls.net_chan.message.size || delta > 1000) {
+			if (Netchan_Pending(&cls.net_chan) || delta > 1000) {
 				Netchan_Transmit(&cls.net_chan, NULL, 0);
 				cl.packet_counter++;
 			}
@@ -72,8 +72,13 @@ static void Cl_WriteDemoHeader(void) {
 			msg.size = 0;
 		}
 
+		net_bit_stream_t stream;
+
 		Net_WriteByte(&msg, SV_CMD_BASELINE);
-		Net_WriteDeltaEntity(&msg, &null_state, &cl.entities[i].baseline, true);
+
+		Net_BeginBitStream(&stream, &msg);
+		Net_WriteDeltaEntity(&stream, &null_state, &cl.entities[i].baseline, true);
+		Net_FlushBits(&stream);
 	}
 
 	Net_WriteByte(&msg, SV_CMD_CBUF_TEXT);
@@ -72,11 +72,30 @@ static _Bool Cl_ValidDeltaEntity(const cl_frame_t *frame, const cl_entity_t *ent
 	return true;
 }
 
+/**
+ * @return The state of the specified entity as received in the specified frame,
+ * or NULL if it is no longer retained.
+ */
+static const entity_state_t *Cl_KnownEntityState(const cl_entity_t *ent, int32_t frame_num) {
+
+	const uint32_t count = Min(ent->history_index, (uint32_t) ENTITY_STATE_HISTORY);
+
+	for (uint32_t i = 1; i <= count; i++) {
+		const uint32_t index = (ent->history_index - i) % ENTITY_STATE_HISTORY;
+		if (ent->history_frame_nums[index] == frame_num) {
+			return &ent->history[index];
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * @brief Reads deltas from the given base and adds the resulting entity to the
  * current frame.
  */
-static void Cl_ReadDeltaEntity(cl_frame_t *frame, const entity_state_t *from, uint16_t number, uint16_t bits) {
+static void Cl_ReadDeltaEntity(net_bit_stream_t *stream, cl_frame_t *frame, const entity_state_t *from,
+                               uint16_t number, uint16_t bits) {
 
 	cl_entity_t *ent = &cl.entities[number];
 
@@ -85,7 +104,7 @@ static void Cl_ReadDeltaEntity(cl_frame_t *frame, const entity_state_t *from, ui
 
 	frame->num_entities++;
 
-	Net_ReadDeltaEntity(&net_message, from, to, number, bits);
+	Net_ReadDeltaEntity(stream, from, to, number, bits);
 
 	// check to see if the delta was successful and valid
 	if (!Cl_ValidDeltaEntity(frame, ent, from, to)) {
@@ -102,6 +121,11 @@ static void Cl_ReadDeltaEntity(cl_frame_t *frame, const entity_state_t *from, ui
 	ent->frame_num = cl.frame.frame_num;
 	ent->current = *to;
 
+	// and retain it, in case the entity leaves and later re-enters our frame
+	const uint32_t index = ent->history_index++ % ENTITY_STATE_HISTORY;
+	ent->history[index] = *to;
+	ent->history_frame_nums[index] = cl.frame.frame_num;
+
 	// mark the lighting cache as dirty
 	if (bits & (U_ORIGIN | U_TERMINATION | U_ANGLES | U_MODELS | U_BOUNDS)) {
 		ent->lighting.state = LIGHTING_DIRTY;
@@ -126,14 +150,13 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 		from_number = from->number;
 	}
 
+	net_bit_stream_t stream;
+	Net_BeginBitStream(&stream, &net_message);
+
 	uint32_t index = 0;
 
 	while (true) {
-		const uint16_t number = Net_ReadShort(&net_message);
-
-		if (number >= MAX_ENTITIES) {
-			Com_Error(ERROR_DROP, "Bad number: %i\n", number);
-		}
+		const uint16_t number = Net_ReadEntityNumber(&stream);
 
 		if (net_message.read > net_message.size) {
 			Com_Error(ERROR_DROP, "End of message\n");
@@ -150,7 +173,7 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 				Com_Print("   unchanged: %i\n", from_number);
 			}
 
-			Cl_ReadDeltaEntity(frame, from, from_number, 0);
+			Cl_ReadDeltaEntity(&stream, frame, from, from_number, 0);
 
 			index++;
 
@@ -163,7 +186,7 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 		}
 
 		// now deal with the new entity
-		const uint16_t bits = Net_ReadShort(&net_message);
+		const uint16_t bits = Net_ReadEntityBits(&stream);
 
 		if (bits & U_REMOVE) { // remove it, no delta
 
@@ -193,7 +216,7 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 				Com_Print("   delta: %i\n", number);
 			}
 
-			Cl_ReadDeltaEntity(frame, from, number, bits);
+			Cl_ReadDeltaEntity(&stream, frame, from, number, bits);
 
 			index++;
 
@@ -207,13 +230,27 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 			continue;
 		}
 
-		if (from_number > number) { // delta from baseline
+		if (from_number > number) { // delta from the last known state, or baseline
+			const entity_state_t *known = &cl.entities[number].baseline;
 
-			if (cl_draw_net_messages->integer == 3) {
-				Com_Print("   baseline: %i\n", number);
+			if (bits & U_KNOWN) {
+				const uint32_t age = Net_ReadEntityAge(&stream);
+
+				known = Cl_KnownEntityState(&cl.entities[number], cl.frame.frame_num - age);
+				if (known == NULL) {
+					Com_Error(ERROR_DROP, "Unknown state for %i from %d frames ago\n", number, age);
+				}
+
+				if (cl_draw_net_messages->integer == 3) {
+					Com_Print("   known: %i (%d)\n", number, age);
+				}
+			} else {
+				if (cl_draw_net_messages->integer == 3) {
+					Com_Print("   baseline: %i\n", number);
+				}
 			}
 
-			Cl_ReadDeltaEntity(frame, &cl.entities[number].baseline, number, bits);
+			Cl_ReadDeltaEntity(&stream, frame, known, number, bits);
 
 			continue;
 		}
@@ -226,7 +263,7 @@ static void Cl_ParseEntities(const cl_frame_t *delta_frame, cl_frame_t *frame) {
 			Com_Print("   unchanged: %i\n", from_number);
 		}
 
-		Cl_ReadDeltaEntity(frame, from, from_number, 0);
+		Cl_ReadDeltaEntity(&stream, frame, from, from_number, 0);
 
 		index++;
 
@@ -252,6 +289,8 @@ void Cl_ParseFrame(void) {
 
 	memset(&cl.frame, 0, sizeof(cl.frame));
 
+	const size_t frame_start = net_message.read;
+
 	cl.frame.frame_num = Net_ReadLong(&net_message);
 	cl.frame.delta_frame_num = Net_ReadLong(&net_message);
 
@@ -292,8 +331,16 @@ void Cl_ParseFrame(void) {
 
 	Cl_ParsePlayerState(cl.delta_frame, &cl.frame);
 
+	const size_t entities_start = net_message.read;
+
 	Cl_ParseEntities(cl.delta_frame, &cl.frame);
 
+	if (time_demo->value) { // accumulate bandwidth statistics
+		cl.time_demo_server_frames++;
+		cl.time_demo_frame_bytes += net_message.read - frame_start;
+		cl.time_demo_entity_bytes += net_message.read - entities_start;
+	}
+
 	// set the simulation time for the frame
 	cl.frame.time = cl.frame.frame_num * QUETOO_TICK_MILLIS;
 
@@ -74,8 +74,8 @@ static void Cl_SendConnect(void) {
 		addr.port = htons(PORT_SERVER);
 	}
 
-	Netchan_OutOfBandPrint(NS_UDP_CLIENT, &addr, "connect %i %i %u \"%s\"\n", PROTOCOL_MAJOR,
-	                       qport->integer, cls.challenge, Cvar_UserInfo());
+	Netchan_OutOfBandPrint(NS_UDP_CLIENT, &addr, "connect %i %i %u \"%s\" %i\n", PROTOCOL_MAJOR,
+	                       qport->integer, cls.challenge, Cvar_UserInfo(), net_compression->integer);
 
 	cvar_user_info_modified = false;
 }
@@ -312,7 +312,15 @@ void Cl_Disconnect(void) {
 		Com_Print("%i frames, %3.2f seconds: %4.2ffps\n", cl.time_demo_frames, s,
 				  cl.time_demo_frames / s);
 
+		if (cl.time_demo_server_frames) {
+			const vec_t n = cl.time_demo_server_frames;
+			Com_Print("%i server frames: %4.2f bytes per frame, %4.2f bytes of entities\n",
+					  cl.time_demo_server_frames, cl.time_demo_frame_bytes / n, cl.time_demo_entity_bytes / n);
+		}
+
 		cl.time_demo_frames = cl.time_demo_start = 0;
+		cl.time_demo_server_frames = 0;
+		cl.time_demo_frame_bytes = cl.time_demo_entity_bytes = 0;
 	}
 
 	Cl_SetKeyDest(KEY_UI);
@@ -385,13 +393,15 @@ static void Cl_ConnectionlessPacket(void) {
 
 		Netchan_Setup(NS_UDP_CLIENT, &cls.net_chan, &net_from, qport->integer);
 
+		cls.net_chan.compress = strtol(Cmd_Argv(1), NULL, 0) > 0;
+
 		Net_WriteByte(&cls.net_chan.message, CL_CMD_STRING);
 		Net_WriteString(&cls.net_chan.message, "new");
 
 		cls.state = CL_CONNECTED;
 
-		if (Cmd_Argc() == 2) { // http download url
-			g_strlcpy(cls.download_url, Cmd_Argv(1), sizeof(cls.download_url));
+		if (Cmd_Argc() == 3) { // http download url
+			g_strlcpy(cls.download_url, Cmd_Argv(2), sizeof(cls.download_url));
 		} else {
 			cls.download_url[0] = '\0';
 		}
@@ -141,12 +141,15 @@ void Cl_Precache_f(void) {
 static void Cl_ParseBaseline(void) {
 	static entity_state_t null_state;
 
-	const uint16_t number = Net_ReadShort(&net_message);
-	const uint16_t bits = Net_ReadShort(&net_message);
+	net_bit_stream_t stream;
+	Net_BeginBitStream(&stream, &net_message);
+
+	const uint16_t number = Net_ReadEntityNumber(&stream);
+	const uint16_t bits = Net_ReadEntityBits(&stream);
 
 	cl_entity_t *ent = &cl.entities[number];
 
-	Net_ReadDeltaEntity(&net_message, &null_state, &ent->baseline, number, bits);
+	Net_ReadDeltaEntity(&stream, &null_state, &ent->baseline, number, bits);
 
 	// initialize clipping matrices
 	if (ent->baseline.solid) {
@@ -240,10 +243,7 @@ static void Cl_ParseDownload(void) {
 
 	net_message.read += size;
 
-	if (percent != 100) {
-		Net_WriteByte(&cls.net_chan.message, CL_CMD_STRING);
-		Net_WriteString(&cls.net_chan.message, "next_download");
-	} else {
+	if (percent == 100) {
 		Fs_Close(cls.download.file);
 		cls.download.file = NULL;
 
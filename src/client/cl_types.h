@@ -69,6 +69,10 @@ typedef struct {
 
 	int32_t frame_num; // the last frame in which this entity was seen
 
+	entity_state_t history[ENTITY_STATE_HISTORY]; // recently received states
+	int32_t history_frame_nums[ENTITY_STATE_HISTORY]; // and the frames they were received in
+	uint32_t history_index; // the number of states received
+
 	uint32_t timestamp; // for intermittent effects
 
 	cl_entity_animation_t animation1; // torso animation
@@ -156,6 +160,9 @@ typedef struct {
 typedef struct {
 	uint32_t time_demo_frames;
 	uint32_t time_demo_start;
+	uint32_t time_demo_server_frames; // server frames parsed, for bandwidth statistics
+	size_t time_demo_frame_bytes; // the total size of parsed server frames
+	size_t time_demo_entity_bytes; // the portion of which is entity deltas
 
 	uint32_t frame_counter;
 	uint32_t packet_counter;
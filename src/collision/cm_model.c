@@ -249,6 +249,8 @@ static void Cm_LoadBspVisibility(void) {
 		Bsp_AllocLump(&cm_bsp.bsp, BSP_LUMP_VISIBILITY, MAX_BSP_VISIBILITY);
 		cm_bsp.bsp.vis_data.vis->num_clusters = cm_bsp.bsp.num_leafs;
 	}
+
+	Cm_LoadVisMatrix();
 }
 
 /**
@@ -371,6 +373,7 @@ cm_bsp_model_t *Cm_LoadBspModel(const char *name, int64_t *size) {
 	Mem_Free(cm_bsp.brush_sides);
 	Mem_Free(cm_bsp.areas);
 	Mem_Free(cm_bsp.portal_open);
+	Mem_Free(cm_bsp.vis_matrix);
 
 	memset(&cm_bsp, 0, sizeof(cm_bsp));
 
@@ -52,6 +52,9 @@ typedef struct {
 	cm_bsp_brush_side_t *brush_sides;
 	cm_bsp_area_t *areas;
 
+	byte *vis_matrix;
+	size_t vis_row_size;
+
 	_Bool *portal_open;
 	int32_t flood_valid;
 
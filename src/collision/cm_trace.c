@@ -21,23 +21,34 @@
 
 #include "cm_local.h"
 
+#if defined(__SSE__)
+	#include <xmmintrin.h>
+#endif
+
 /**
  * @brief Plane side epsilon (1.0 / 32.0) to keep floating point happy.
  */
 #define DIST_EPSILON 0.03125
 
 /**
- * @brief Box trace data encapsulation and context management.
+ * @brief The bounding box being traced, which may be shared by many traces.
  */
 typedef struct {
-	vec3_t start, end;
 	vec3_t mins, maxs;
 	vec3_t extents;
 	vec3_t offsets[8];
+	_Bool is_point;
+} cm_trace_hull_t;
+
+/**
+ * @brief Box trace data encapsulation and context management.
+ */
+typedef struct {
+	vec3_t start, end;
+	cm_trace_hull_t hull;
 	vec3_t box_mins, box_maxs;
 
 	int32_t contents;
-	_Bool is_point;
 
 	cm_trace_t trace;
 
@@ -83,7 +94,7 @@ static void Cm_TraceToBrush(cm_trace_data_t *data, const cm_bsp_brush_t *brush)
 	for (int32_t i = 0; i < brush->num_sides; i++, side++) {
 		const cm_bsp_plane_t *plane = side->plane;
 
-		const vec_t dist = plane->dist - DotProduct(data->offsets[plane->sign_bits], plane->normal);
+		const vec_t dist = plane->dist - DotProduct(data->hull.offsets[plane->sign_bits], plane->normal);
 
 		const vec_t d1 = DotProduct(data->start, plane->normal) - dist;
 		const vec_t d2 = DotProduct(data->end, plane->normal) - dist;
@@ -160,7 +171,7 @@ static void Cm_TestBoxInBrush(cm_trace_data_t *data, const cm_bsp_brush_t *brush
 	for (int32_t i = 0; i < brush->num_sides; i++, side++) {
 		const cm_bsp_plane_t *plane = side->plane;
 
-		const vec_t dist = plane->dist - DotProduct(data->offsets[plane->sign_bits], plane->normal);
+		const vec_t dist = plane->dist - DotProduct(data->hull.offsets[plane->sign_bits], plane->normal);
 
 		const vec_t d1 = DotProduct(data->start, plane->normal) - dist;
 
@@ -245,6 +256,21 @@ static void Cm_TestInLeaf(cm_trace_data_t *data, int32_t leaf_num) {
 	}
 }
 
+/**
+ * @return The distance by which the specified non-axial plane must be shifted
+ * to account for the hull's size.
+ */
+static inline vec_t Cm_HullOffset(const cm_trace_hull_t *hull, const cm_bsp_plane_t *plane) {
+
+	if (hull->is_point) {
+		return 0.0;
+	}
+
+	return fabsf(hull->extents[0] * plane->normal[0])
+	       + fabsf(hull->extents[1] * plane->normal[1])
+	       + fabsf(hull->extents[2] * plane->normal[2]);
+}
+
 /**
  * @brief
  */
@@ -270,16 +296,11 @@ static void Cm_TraceToNode(cm_trace_data_t *data, int32_t num, vec_t p1f, vec_t
 	if (AXIAL(plane)) {
 		d1 = p1[plane->type] - plane->dist;
 		d2 = p2[plane->type] - plane->dist;
-		offset = data->extents[plane->type];
+		offset = data->hull.extents[plane->type];
 	} else {
 		d1 = DotProduct(plane->normal, p1) - plane->dist;
 		d2 = DotProduct(plane->normal, p2) - plane->dist;
-		if (data->is_point) {
-			offset = 0.0;
-		} else
-			offset = fabsf(data->extents[0] * plane->normal[0])
-			         + fabsf(data->extents[1] * plane->normal[1])
-			         + fabsf(data->extents[2] * plane->normal[2]);
+		offset = Cm_HullOffset(&data->hull, plane);
 	}
 
 	// see which sides we need to consider
@@ -333,6 +354,93 @@ static void Cm_TraceToNode(cm_trace_data_t *data, int32_t num, vec_t p1f, vec_t
 	Cm_TraceToNode(data, node->children[side ^ 1], midf2, p2f, mid, p2);
 }
 
+/**
+ * @brief Initializes the hull for the specified bounding box.
+ */
+static void Cm_InitTraceHull(cm_trace_hull_t *hull, const vec3_t mins, const vec3_t maxs) {
+
+	VectorCopy(mins, hull->mins);
+	VectorCopy(maxs, hull->maxs);
+
+	// check for point special case
+	hull->is_point = VectorCompare(mins, vec3_origin) && VectorCompare(maxs, vec3_origin);
+
+	// extents allow planes to be shifted to account for the box size
+	hull->extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
+	hull->extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
+	hull->extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
+
+	// offsets provide sign bit lookups for fast plane tests
+	for (int32_t i = 0; i < 8; i++) {
+		hull->offsets[i][0] = (i & 1) ? maxs[0] : mins[0];
+		hull->offsets[i][1] = (i & 2) ? maxs[1] : mins[1];
+		hull->offsets[i][2] = (i & 4) ? maxs[2] : mins[2];
+	}
+}
+
+/**
+ * @brief Initializes the trace data for a single trace of the given hull. Only
+ * the fields that are read before being written are reset.
+ */
+static void Cm_InitTraceData(cm_trace_data_t *data, const vec3_t start, const vec3_t end,
+                             const cm_trace_hull_t *hull, const int32_t contents) {
+
+	VectorCopy(start, data->start);
+	VectorCopy(end, data->end);
+
+	data->hull = *hull;
+	data->contents = contents;
+
+	memset(&data->trace, 0, sizeof(data->trace));
+	data->trace.fraction = 1.0;
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (start[i] < end[i]) {
+			data->box_mins[i] = start[i] + hull->mins[i] - 1.0;
+			data->box_maxs[i] = end[i] + hull->maxs[i] + 1.0;
+		} else {
+			data->box_mins[i] = end[i] + hull->mins[i] - 1.0;
+			data->box_maxs[i] = start[i] + hull->maxs[i] + 1.0;
+		}
+	}
+}
+
+/**
+ * @brief Resolves the position test special case, where start and end are equal.
+ */
+static void Cm_TestTrace(cm_trace_data_t *data, const int32_t head_node) {
+	int32_t leafs[MAX_ENTITIES];
+
+	const size_t len = Cm_BoxLeafnums(data->box_mins, data->box_maxs, leafs, lengthof(leafs),
+	                                  NULL, head_node);
+
+	memset(data->brushes, 0xff, sizeof(data->brushes));
+
+	for (size_t i = 0; i < len; i++) {
+		Cm_TestInLeaf(data, leafs[i]);
+
+		if (data->trace.all_solid) {
+			break;
+		}
+	}
+
+	VectorCopy(data->start, data->trace.end);
+}
+
+/**
+ * @brief Calculates the end point of a completed trace.
+ */
+static void Cm_FinishTrace(cm_trace_data_t *data) {
+
+	if (data->trace.fraction == 0.0) {
+		VectorCopy(data->start, data->trace.end);
+	} else if (data->trace.fraction == 1.0) {
+		VectorCopy(data->end, data->trace.end);
+	} else {
+		VectorLerp(data->start, data->end, data->trace.fraction, data->trace.end);
+	}
+}
+
 /**
  * @brief Primary collision detection entry point. This function recurses down
  * the BSP tree from the specified head node, clipping the desired movement to
@@ -351,107 +459,231 @@ cm_trace_t Cm_BoxTrace(const vec3_t start, const vec3_t end, const vec3_t mins,
                        const int32_t head_node, const int32_t contents) {
 
 	static __thread cm_trace_data_t data;
-	memset(&data, 0, sizeof(data));
-
-	data.trace.fraction = 1.0;
 
 	if (!cm_bsp.bsp.num_nodes) { // map not loaded
+		return (cm_trace_t) { .fraction = 1.0 };
+	}
+
+	cm_trace_hull_t hull;
+	Cm_InitTraceHull(&hull, mins, maxs);
+
+	Cm_InitTraceData(&data, start, end, &hull, contents);
+
+	// check for position test special case
+	if (VectorCompare(start, end)) {
+		Cm_TestTrace(&data, head_node);
 		return data.trace;
 	}
 
-	VectorCopy(start, data.start);
-	VectorCopy(end, data.end);
+	Cm_TraceToNode(&data, head_node, 0.0, 1.0, start, end);
 
-	VectorCopy(mins, data.mins);
-	VectorCopy(maxs, data.maxs);
+	Cm_FinishTrace(&data);
 
-	data.contents = contents;
+	return data.trace;
+}
 
-	// check for point special case
-	if (VectorCompare(mins, vec3_origin) && VectorCompare(maxs, vec3_origin)) {
-		data.is_point = true;
-	} else {
-		data.is_point = false;
+#define CM_TRACE_PACKET_SIZE 4
 
-		// extents allow planes to be shifted to account for the box size
-		data.extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
-		data.extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
-		data.extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
+/**
+ * @brief A packet of traces sharing a hull and contents mask, which descend the
+ * BSP tree together for as long as they agree on which side of each plane they
+ * fall. Start and end points are stored as structures of arrays, so that planes
+ * are tested against the whole packet at once.
+ */
+typedef struct {
+	cm_trace_data_t *data[CM_TRACE_PACKET_SIZE];
+	vec_t start[3][CM_TRACE_PACKET_SIZE];
+	vec_t end[3][CM_TRACE_PACKET_SIZE];
+} cm_trace_packet_t;
 
-		// offsets provide sign bit lookups for fast plane tests
-		data.offsets[0][0] = mins[0];
-		data.offsets[0][1] = mins[1];
-		data.offsets[0][2] = mins[2];
+/**
+ * @brief Classifies the traces of the packet against the specified plane.
+ *
+ * @param front Receives the mask of traces entirely in front of the plane.
+ * @param back Receives the mask of traces entirely behind the plane.
+ */
+static void Cm_ClassifyPacket(const cm_trace_packet_t *packet, const cm_bsp_plane_t *plane,
+                              const vec_t offset, uint32_t *front, uint32_t *back) {
 
-		data.offsets[1][0] = maxs[0];
-		data.offsets[1][1] = mins[1];
-		data.offsets[1][2] = mins[2];
+#if defined(__SSE__)
+	__m128 d1, d2;
 
-		data.offsets[2][0] = mins[0];
-		data.offsets[2][1] = maxs[1];
-		data.offsets[2][2] = mins[2];
+	const __m128 dist = _mm_set1_ps(plane->dist);
 
-		data.offsets[3][0] = maxs[0];
-		data.offsets[3][1] = maxs[1];
-		data.offsets[3][2] = mins[2];
+	if (AXIAL(plane)) {
+		d1 = _mm_sub_ps(_mm_loadu_ps(packet->start[plane->type]), dist);
+		d2 = _mm_sub_ps(_mm_loadu_ps(packet->end[plane->type]), dist);
+	} else {
+		const __m128 nx = _mm_set1_ps(plane->normal[0]);
+		const __m128 ny = _mm_set1_ps(plane->normal[1]);
+		const __m128 nz = _mm_set1_ps(plane->normal[2]);
+
+		d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(packet->start[0])),
+		                           _mm_mul_ps(ny, _mm_loadu_ps(packet->start[1]))),
+		                _mm_mul_ps(nz, _mm_loadu_ps(packet->start[2])));
+		d1 = _mm_sub_ps(d1, dist);
+
+		d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(packet->end[0])),
+		                           _mm_mul_ps(ny, _mm_loadu_ps(packet->end[1]))),
+		                _mm_mul_ps(nz, _mm_loadu_ps(packet->end[2])));
+		d2 = _mm_sub_ps(d2, dist);
+	}
 
-		data.offsets[4][0] = mins[0];
-		data.offsets[4][1] = mins[1];
-		data.offsets[4][2] = maxs[2];
+	const __m128 pos = _mm_set1_ps(offset);
+	const __m128 neg = _mm_set1_ps(-offset);
 
-		data.offsets[5][0] = maxs[0];
-		data.offsets[5][1] = mins[1];
-		data.offsets[5][2] = maxs[2];
+	*front = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(d1, pos), _mm_cmpge_ps(d2, pos)));
+	*back = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(d1, neg), _mm_cmple_ps(d2, neg)));
 
-		data.offsets[6][0] = mins[0];
-		data.offsets[6][1] = maxs[1];
-		data.offsets[6][2] = maxs[2];
+	// traces lying on the plane go front only, as they do in Cm_TraceToNode
+	*back &= ~*front;
+#else
+	*front = *back = 0;
 
-		data.offsets[7][0] = maxs[0];
-		data.offsets[7][1] = maxs[1];
-		data.offsets[7][2] = maxs[2];
-	}
+	for (uint32_t i = 0; i < CM_TRACE_PACKET_SIZE; i++) {
+		vec_t d1, d2;
 
-	for (int32_t i = 0; i < 3; i++) {
-		if (start[i] < end[i]) {
-			data.box_mins[i] = start[i] + mins[i] - 1.0;
-			data.box_maxs[i] = end[i] + maxs[i] + 1.0;
+		if (AXIAL(plane)) {
+			d1 = packet->start[plane->type][i] - plane->dist;
+			d2 = packet->end[plane->type][i] - plane->dist;
 		} else {
-			data.box_mins[i] = end[i] + mins[i] - 1.0;
-			data.box_maxs[i] = start[i] + maxs[i] + 1.0;
+			d1 = plane->normal[0] * packet->start[0][i] + plane->normal[1] * packet->start[1][i] +
+			     plane->normal[2] * packet->start[2][i] - plane->dist;
+			d2 = plane->normal[0] * packet->end[0][i] + plane->normal[1] * packet->end[1][i] +
+			     plane->normal[2] * packet->end[2][i] - plane->dist;
+		}
+
+		if (d1 >= offset && d2 >= offset) {
+			*front |= (1 << i);
+		} else if (d1 <= -offset && d2 <= -offset) {
+			*back |= (1 << i);
 		}
 	}
+#endif
+}
 
-	// check for position test special case
-	if (VectorCompare(start, end)) {
-		int32_t leafs[MAX_ENTITIES];
+/**
+ * @brief Descends the BSP tree with the traces of the packet that are set in
+ * mask. Traces that straddle a plane leave the packet and continue alone via
+ * Cm_TraceToNode, so the results are identical to tracing them one at a time.
+ */
+static void Cm_TracePacketToNode(cm_trace_packet_t *packet, int32_t num, uint32_t mask) {
 
-		const size_t len = Cm_BoxLeafnums(data.box_mins, data.box_maxs, leafs, lengthof(leafs),
-		                                  NULL, head_node);
+	for (uint32_t i = 0; i < CM_TRACE_PACKET_SIZE; i++) {
+		if ((mask & (1 << i)) && packet->data[i]->trace.fraction <= 0.0) {
+			mask &= ~(1 << i); // already hit something nearer
+		}
+	}
 
-		for (size_t i = 0; i < len; i++) {
-			Cm_TestInLeaf(&data, leafs[i]);
+	if (!mask) {
+		return;
+	}
 
-			if (data.trace.all_solid) {
-				break;
+	// if < 0, we are in a leaf node
+	if (num < 0) {
+		for (uint32_t i = 0; i < CM_TRACE_PACKET_SIZE; i++) {
+			if (mask & (1 << i)) {
+				Cm_TraceToLeaf(packet->data[i], -1 - num);
 			}
 		}
+		return;
+	}
 
-		VectorCopy(start, data.trace.end);
-		return data.trace;
+	const cm_bsp_node_t *node = cm_bsp.nodes + num;
+	const cm_bsp_plane_t *plane = node->plane;
+
+	const cm_trace_hull_t *hull = &packet->data[0]->hull;
+	const vec_t offset = AXIAL(plane) ? hull->extents[plane->type] : Cm_HullOffset(hull, plane);
+
+	uint32_t front, back;
+	Cm_ClassifyPacket(packet, plane, offset, &front, &back);
+
+	front &= mask;
+	back &= mask;
+
+	if (front) {
+		Cm_TracePacketToNode(packet, node->children[0], front);
 	}
 
-	Cm_TraceToNode(&data, head_node, 0.0, 1.0, start, end);
+	if (back) {
+		Cm_TracePacketToNode(packet, node->children[1], back);
+	}
 
-	if (data.trace.fraction == 0.0) {
-		VectorCopy(start, data.trace.end);
-	} else if (data.trace.fraction == 1.0) {
-		VectorCopy(end, data.trace.end);
-	} else {
-		VectorLerp(start, end, data.trace.fraction, data.trace.end);
+	const uint32_t split = mask & ~(front | back);
+
+	for (uint32_t i = 0; i < CM_TRACE_PACKET_SIZE; i++) {
+		if (split & (1 << i)) {
+			cm_trace_data_t *data = packet->data[i];
+			Cm_TraceToNode(data, num, 0.0, 1.0, data->start, data->end);
+		}
 	}
+}
 
-	return data.trace;
+/**
+ * @brief Traces many segments which share a bounding box and contents mask. The
+ * segments are traced in packets which share the walk down the BSP tree for as
+ * long as possible. This is considerably faster than tracing each segment with
+ * Cm_BoxTrace when the segments are coherent, e.g. shotgun pellets or light
+ * samples, and the results are identical.
+ *
+ * @param starts The starting points.
+ * @param ends The desired end points.
+ * @param count The number of segments to trace.
+ * @param mins The bounding box mins, in model space.
+ * @param maxs The bounding box maxs, in model space.
+ * @param head_node The BSP head node to recurse down.
+ * @param contents The contents mask to clip to.
+ * @param traces Receives the traces, one per segment.
+ */
+void Cm_BoxTraceBatch(const vec3_t *starts, const vec3_t *ends, const size_t count,
+                      const vec3_t mins, const vec3_t maxs, const int32_t head_node,
+                      const int32_t contents, cm_trace_t *traces) {
+
+	cm_trace_data_t data[CM_TRACE_PACKET_SIZE];
+	cm_trace_packet_t packet;
+
+	if (!cm_bsp.bsp.num_nodes) { // map not loaded
+		for (size_t i = 0; i < count; i++) {
+			traces[i] = (cm_trace_t) { .fraction = 1.0 };
+		}
+		return;
+	}
+
+	cm_trace_hull_t hull;
+	Cm_InitTraceHull(&hull, mins, maxs);
+
+	for (size_t i = 0; i < count; i += CM_TRACE_PACKET_SIZE) {
+		uint32_t mask = 0;
+
+		for (uint32_t j = 0; j < CM_TRACE_PACKET_SIZE; j++) {
+			const size_t k = i + j < count ? i + j : i; // pad with the first trace
+
+			Cm_InitTraceData(&data[j], starts[k], ends[k], &hull, contents);
+			packet.data[j] = &data[j];
+
+			for (int32_t l = 0; l < 3; l++) {
+				packet.start[l][j] = starts[k][l];
+				packet.end[l][j] = ends[k][l];
+			}
+
+			if (i + j < count) {
+				if (VectorCompare(starts[k], ends[k])) {
+					Cm_TestTrace(&data[j], head_node);
+				} else {
+					mask |= (1 << j);
+				}
+			}
+		}
+
+		Cm_TracePacketToNode(&packet, head_node, mask);
+
+		for (uint32_t j = 0; j < CM_TRACE_PACKET_SIZE && i + j < count; j++) {
+			if (mask & (1 << j)) {
+				Cm_FinishTrace(&data[j]);
+			}
+			traces[i + j] = data[j].trace;
+		}
+	}
 }
 
 /**
@@ -26,6 +26,10 @@
 cm_trace_t Cm_BoxTrace(const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
                        const int32_t head_node, const int32_t contents);
 
+void Cm_BoxTraceBatch(const vec3_t *starts, const vec3_t *ends, const size_t count,
+                      const vec3_t mins, const vec3_t maxs, const int32_t head_node,
+                      const int32_t contents, cm_trace_t *traces);
+
 cm_trace_t Cm_TransformedBoxTrace(const vec3_t start, const vec3_t end, const vec3_t mins,
                                   const vec3_t maxs, const int32_t head_node, const int32_t contents,
                                   const matrix4x4_t *matrix, const matrix4x4_t *inverse_matrix);
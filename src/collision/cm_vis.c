@@ -26,6 +26,95 @@
  */
 _Bool cm_no_areas = false;
 
+/**
+ * @brief The memory budget, in bytes, for the decompressed visibility matrix.
+ * Maps whose PVS and PHS would exceed this are decompressed on demand instead.
+ */
+size_t cm_vis_cache_size = 64 * 1024 * 1024;
+
+/**
+ * @brief Decompresses every PVS and PHS row into a contiguous matrix, so that
+ * row lookups become pointer arithmetic. Rows are padded to a multiple of
+ * 8 bytes so that they may be merged word-wide. A trailing row of zeros is
+ * reserved for cluster -1.
+ */
+void Cm_LoadVisMatrix(void) {
+
+	const bsp_vis_t *vis = cm_bsp.bsp.vis_data.vis;
+
+	cm_bsp.vis_matrix = NULL;
+	cm_bsp.vis_row_size = ((vis->num_clusters + 63) >> 6) << 3;
+
+	const size_t size = cm_bsp.vis_row_size * (vis->num_clusters * 2 + 1);
+
+	if (size == 0 || size > cm_vis_cache_size) {
+		Com_Debug(DEBUG_COLLISION, "Visibility matrix %zu bytes exceeds budget\n", size);
+		return;
+	}
+
+	cm_bsp.vis_matrix = Mem_TagMalloc(size, MEM_TAG_CMODEL);
+
+	byte *row = cm_bsp.vis_matrix;
+	for (int32_t i = 0; i < vis->num_clusters; i++, row += cm_bsp.vis_row_size) {
+		Bsp_DecompressVis(&cm_bsp.bsp, cm_bsp.bsp.vis_data.raw + vis->bit_offsets[i][DVIS_PVS], row);
+	}
+
+	for (int32_t i = 0; i < vis->num_clusters; i++, row += cm_bsp.vis_row_size) {
+		Bsp_DecompressVis(&cm_bsp.bsp, cm_bsp.bsp.vis_data.raw + vis->bit_offsets[i][DVIS_PHS], row);
+	}
+
+	Com_Debug(DEBUG_COLLISION, "Visibility matrix %zu bytes\n", size);
+}
+
+/**
+ * @return The decompressed visibility row for the given cluster, either from
+ * the visibility matrix or decompressed into `scratch`.
+ */
+static const byte *Cm_ClusterVisRow(const int32_t cluster, const int32_t type, byte *scratch) {
+
+	const bsp_vis_t *vis = cm_bsp.bsp.vis_data.vis;
+
+	if (cm_bsp.vis_matrix) {
+		int32_t row;
+		if (cluster == -1) {
+			row = vis->num_clusters * 2;
+		} else {
+			row = type == DVIS_PVS ? cluster : vis->num_clusters + cluster;
+		}
+		return cm_bsp.vis_matrix + row * cm_bsp.vis_row_size;
+	}
+
+	if (cluster == -1) {
+		memset(scratch, 0, (vis->num_clusters + 7) >> 3);
+	} else {
+		Bsp_DecompressVis(&cm_bsp.bsp, cm_bsp.bsp.vis_data.raw + vis->bit_offsets[cluster][type], scratch);
+	}
+
+	return scratch;
+}
+
+/**
+ * @brief Resolves the PVS row for the specified cluster without copying it,
+ * if the visibility matrix is resident.
+ *
+ * @param scratch Storage for the row if it must be decompressed. Must be at
+ * least `MAX_BSP_LEAFS >> 3` in length.
+ *
+ * @return The row, which is valid until the next map load.
+ */
+const byte *Cm_ClusterPVSRow(const int32_t cluster, byte *scratch) {
+	return Cm_ClusterVisRow(cluster, DVIS_PVS, scratch);
+}
+
+/**
+ * @brief Resolves the PHS row for the specified cluster.
+ *
+ * @see Cm_ClusterPVSRow
+ */
+const byte *Cm_ClusterPHSRow(const int32_t cluster, byte *scratch) {
+	return Cm_ClusterVisRow(cluster, DVIS_PHS, scratch);
+}
+
 /**
  * @brief
  *
@@ -33,13 +122,11 @@ _Bool cm_no_areas = false;
  */
 size_t Cm_ClusterPVS(const int32_t cluster, byte *pvs) {
 
-	const bsp_vis_t *vis = cm_bsp.bsp.vis_data.vis;
-	const size_t len = (vis->num_clusters + 7) >> 3;
+	const size_t len = (cm_bsp.bsp.vis_data.vis->num_clusters + 7) >> 3;
 
-	if (cluster == -1) {
-		memset(pvs, 0, len);
-	} else {
-		Bsp_DecompressVis(&cm_bsp.bsp, cm_bsp.bsp.vis_data.raw + vis->bit_offsets[cluster][DVIS_PVS], pvs);
+	const byte *row = Cm_ClusterPVSRow(cluster, pvs);
+	if (row != pvs) {
+		memcpy(pvs, row, len);
 	}
 
 	return len;
@@ -50,18 +137,61 @@ size_t Cm_ClusterPVS(const int32_t cluster, byte *pvs) {
  */
 size_t Cm_ClusterPHS(const int32_t cluster, byte *phs) {
 
-	const bsp_vis_t *vis = cm_bsp.bsp.vis_data.vis;
-	const size_t len = (vis->num_clusters + 7) >> 3;
+	const size_t len = (cm_bsp.bsp.vis_data.vis->num_clusters + 7) >> 3;
 
-	if (cluster == -1) {
-		memset(phs, 0, len);
-	} else {
-		Bsp_DecompressVis(&cm_bsp.bsp, cm_bsp.bsp.vis_data.raw + vis->bit_offsets[cluster][DVIS_PHS], phs);
+	const byte *row = Cm_ClusterPHSRow(cluster, phs);
+	if (row != phs) {
+		memcpy(phs, row, len);
 	}
 
 	return len;
 }
 
+/**
+ * @return The length of a visibility row in bytes.
+ */
+size_t Cm_VisRowSize(void) {
+	return (cm_bsp.bsp.vis_data.vis->num_clusters + 7) >> 3;
+}
+
+/**
+ * @brief Merges `in` into `out` with bitwise OR, a word at a time.
+ */
+void Cm_UnionVis(byte *out, const byte *in, const size_t len) {
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t a, b;
+		memcpy(&a, out + i, sizeof(a));
+		memcpy(&b, in + i, sizeof(b));
+		a |= b;
+		memcpy(out + i, &a, sizeof(a));
+	}
+
+	for (; i < len; i++) {
+		out[i] |= in[i];
+	}
+}
+
+/**
+ * @brief Merges `in` into `out` with bitwise AND, a word at a time.
+ */
+void Cm_IntersectVis(byte *out, const byte *in, const size_t len) {
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t a, b;
+		memcpy(&a, out + i, sizeof(a));
+		memcpy(&b, in + i, sizeof(b));
+		a &= b;
+		memcpy(out + i, &a, sizeof(a));
+	}
+
+	for (; i < len; i++) {
+		out[i] &= in[i];
+	}
+}
+
 /**
  * @brief Recurse over the area portals, marking adjacent ones as flooded.
  */
@@ -25,6 +25,12 @@
 
 size_t Cm_ClusterPVS(const int32_t cluster, byte *pvs);
 size_t Cm_ClusterPHS(const int32_t cluster, byte *phs);
+const byte *Cm_ClusterPVSRow(const int32_t cluster, byte *scratch);
+const byte *Cm_ClusterPHSRow(const int32_t cluster, byte *scratch);
+
+size_t Cm_VisRowSize(void);
+void Cm_UnionVis(byte *out, const byte *in, const size_t len);
+void Cm_IntersectVis(byte *out, const byte *in, const size_t len);
 
 void Cm_SetAreaPortalState(const int32_t portal_num, const _Bool open);
 _Bool Cm_AreasConnected(const int32_t area1, const int32_t area2);
@@ -33,7 +39,9 @@ int32_t Cm_WriteAreaBits(const int32_t area, byte *out);
 _Bool Cm_HeadnodeVisible(const int32_t head_node, const byte *vis);
 
 extern _Bool cm_no_areas;
+extern size_t cm_vis_cache_size;
 
 #ifdef __CM_LOCAL_H__
 void Cm_FloodAreas(void);
+void Cm_LoadVisMatrix(void);
 #endif /* __CM_LOCAL_H__ */
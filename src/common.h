@@ -45,7 +45,7 @@
  * of core net messages or serialized data types change. The game and client
  * game maintain PROTOCOL_MINOR as well.
  */
-#define PROTOCOL_MAJOR		1023
+#define PROTOCOL_MAJOR		1025
 
 /**
  * @brief The IP address of the master server, where the authoritative list of
@@ -82,6 +82,14 @@
  */
 #define MAX_PACKET_ENTITIES	128
 
+/**
+ * @brief The number of recent states the client retains for each entity. An
+ * entity re-entering a client's frame may be delta compressed from the last
+ * state the client acknowledged, rather than its baseline, if it has been sent
+ * in fewer than this many frames since.
+ */
+#define ENTITY_STATE_HISTORY	16
+
 /**
  * @brief Client bandwidth throttling thresholds, in bytes per second. Clients
  * may actually request that the server drops messages for them above a certain
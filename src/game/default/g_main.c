@@ -1296,7 +1296,11 @@ static void G_Frame(void) {
 			}
 		}
 
+		const uint64_t ai_start = gi.ProfileBegin();
+
 		G_Ai_Frame();
+
+		gi.ProfileEnd("ai", ai_start);
 	}
 
 	// see if a vote has passed
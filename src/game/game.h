@@ -25,7 +25,7 @@
 #include "filesystem.h"
 #include "ai/ai.h"
 
-#define GAME_API_VERSION 9
+#define GAME_API_VERSION 12
 
 /**
  * @brief Server flags for g_entity_t.
@@ -413,6 +413,13 @@ typedef struct g_import_s {
 	size_t (*BoxEntities)(const vec3_t mins, const vec3_t maxs, g_entity_t **list, const size_t len,
 	                      const uint32_t type);
 
+	/**
+	 * @brief Server tick profiler facilities. Time spent between ProfileBegin
+	 * and ProfileEnd is reported by `sv_profile` under the given name.
+	 */
+	uint64_t (*ProfileBegin)(void);
+	void (*ProfileEnd)(const char *name, const uint64_t start);
+
 	/**
 	 * @brief Network messaging facilities.
 	 */
@@ -248,7 +248,8 @@ static const char *mem_tag_names[MEM_TAG_TOTAL] = {
 	"cvar",
 	"cmodel",
 	"bsp",
-	"fs"
+	"fs",
+	"frame"
 };
 
 /**
@@ -401,6 +402,8 @@ static void Shutdown(const char *msg) {
  */
 static void Frame(const uint32_t msec) {
 
+	Mem_ResetFrame();
+
 	Cbuf_Execute();
 
 	if (threads->modified) {
@@ -19,7 +19,9 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+
 #include <signal.h>
+#include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_thread.h>
 
 #include "mem.h"
@@ -30,34 +32,76 @@
   #if defined(WIN32)
     #include <DbgHelp.h>
   #endif
+
+  #if !defined(MEM_CHECKS)
+    #define MEM_CHECKS
+  #endif
 #endif
 
-#define MEM_MAGIC 0x69696969
-typedef uint32_t mem_magic_t;
+#if defined(MEM_CHECKS)
+  #define MEM_MAGIC 0x69696969
+  typedef uint32_t mem_magic_t;
+#endif
 
+/**
+ * @brief The header of every managed allocation. Blocks are kept in intrusive
+ * lists: root blocks in the list of their tag, and linked blocks in the list of
+ * their parent's children. A block and all of its descendants belong to the
+ * same shard.
+ */
 typedef struct mem_block_s {
+#if defined(MEM_CHECKS)
 	mem_magic_t magic;
+#endif
 	mem_tag_t tag; // for group free
+	uint32_t shard;
 	struct mem_block_s *parent;
-	GSList *children;
+	struct mem_block_s *children;
+	struct mem_block_s *next;
+	struct mem_block_s **prev; // the pointer that points to this block
 	size_t size;
 #if defined(SUPER_MEMORY_CHECKS)
 	void *stack[MAX_MEMORY_STACK];
 #endif
 } mem_block_t;
 
+#if defined(MEM_CHECKS)
 typedef struct {
 	mem_magic_t magic;
 } mem_footer_t;
+#endif
+
+/**
+ * @brief The root blocks of a single tag within a shard.
+ */
+typedef struct mem_tag_list_s {
+	mem_tag_t tag;
+	mem_block_t *blocks;
+	struct mem_tag_list_s *next;
+} mem_tag_list_t;
 
+#define MEM_SHARDS 16
+
+/**
+ * @brief Each thread allocates root blocks into its own shard, so that threads
+ * do not contend for a single lock.
+ */
 typedef struct {
-	GHashTable *blocks;
-	size_t size;
 	SDL_mutex *lock;
+	mem_tag_list_t *tags;
+	size_t size;
+} mem_shard_t;
+
+typedef struct {
+	mem_shard_t shards[MEM_SHARDS];
+	SDL_atomic_t next_shard;
+	SDL_atomic_t frame;
 } mem_state_t;
 
 static mem_state_t mem_state;
 
+static __thread int32_t mem_shard = -1;
+
 #if defined(SUPER_MEMORY_CHECKS)
 /**
  * @brief
@@ -95,8 +139,9 @@ static void Mem_Print(const mem_block_t *block, const char *why) {
 #endif
 
 /**
- * @brief Throws a fatal error if the specified memory block is non-NULL but
- * not owned by the memory subsystem.
+ * @brief Resolves the block header of the specified managed memory. With
+ * MEM_CHECKS, throws a fatal error if the memory is non-NULL but not owned by
+ * the memory subsystem.
  */
 static mem_block_t *Mem_CheckMagic(void *p) {
 	mem_block_t *b = NULL;
@@ -104,6 +149,7 @@ static mem_block_t *Mem_CheckMagic(void *p) {
 	if (p) {
 		b = ((mem_block_t *) p) - 1;
 
+#if defined(MEM_CHECKS)
 		if (b->magic != MEM_MAGIC) {
 			fprintf(stderr, "Invalid magic (%d) for %p\n", b->magic, p);
 			raise(SIGABRT);
@@ -115,34 +161,133 @@ static mem_block_t *Mem_CheckMagic(void *p) {
 			fprintf(stderr, "Invalid footer magic (%d) for %p\n", b->magic, p);
 			raise(SIGABRT);
 		}
+#endif
 	}
 
 	return b;
 }
 
 /**
- * @brief
+ * @brief Verifies the specified block of managed memory. This is a no-op unless
+ * MEM_CHECKS is defined.
  */
 void Mem_Check(void *p) {
 	Mem_CheckMagic(p);
 }
 
 /**
- * @brief Recursively frees linked managed memory.
+ * @return The shard of the calling thread.
+ */
+static uint32_t Mem_Shard(void) {
+
+	if (mem_shard == -1) {
+		mem_shard = (int32_t) (((uint32_t) SDL_AtomicAdd(&mem_state.next_shard, 1)) % MEM_SHARDS);
+	}
+
+	return (uint32_t) mem_shard;
+}
+
+/**
+ * @brief Locks the specified shards in a consistent order.
+ */
+static void Mem_LockShards(uint32_t a, uint32_t b) {
+
+	if (a == b) {
+		SDL_mutexP(mem_state.shards[a].lock);
+	} else if (a < b) {
+		SDL_mutexP(mem_state.shards[a].lock);
+		SDL_mutexP(mem_state.shards[b].lock);
+	} else {
+		SDL_mutexP(mem_state.shards[b].lock);
+		SDL_mutexP(mem_state.shards[a].lock);
+	}
+}
+
+/**
+ * @brief Unlocks shards locked by Mem_LockShards.
+ */
+static void Mem_UnlockShards(uint32_t a, uint32_t b) {
+
+	SDL_mutexV(mem_state.shards[a].lock);
+
+	if (a != b) {
+		SDL_mutexV(mem_state.shards[b].lock);
+	}
+}
+
+/**
+ * @return The head of the root block list for the specified tag in the shard,
+ * which is created if necessary. The shard must be locked.
+ */
+static mem_block_t **Mem_TagBlocks(mem_shard_t *shard, mem_tag_t tag) {
+
+	mem_tag_list_t *list;
+	for (list = shard->tags; list; list = list->next) {
+		if (list->tag == tag) {
+			return &list->blocks;
+		}
+	}
+
+	if (!(list = calloc(1, sizeof(*list)))) {
+		fprintf(stderr, "Failed to allocate tag list\n");
+		raise(SIGABRT);
+		return NULL;
+	}
+
+	list->tag = tag;
+	list->next = shard->tags;
+	shard->tags = list;
+
+	return &list->blocks;
+}
+
+/**
+ * @brief Inserts the block at the head of the specified list.
  */
-static void Mem_Free_(mem_block_t *b) {
+static void Mem_InsertBlock(mem_block_t *b, mem_block_t **head) {
+
+	b->next = *head;
+	if (b->next) {
+		b->next->prev = &b->next;
+	}
+
+	b->prev = head;
+	*head = b;
+}
+
+/**
+ * @brief Removes the block from whichever list it is in.
+ */
+static void Mem_RemoveBlock(mem_block_t *b) {
+
+	*b->prev = b->next;
+	if (b->next) {
+		b->next->prev = b->prev;
+	}
+
+	b->next = NULL;
+	b->prev = NULL;
+}
+
+/**
+ * @brief Recursively frees linked managed memory. The shard must be locked.
+ */
+static void Mem_Free_(mem_shard_t *shard, mem_block_t *b) {
 
 #if defined(SUPER_MEMORY_CHECKS)
 	Mem_Print(b, "Freeing");
 #endif
 
 	// recurse down the tree, freeing children
-	if (b->children) {
-		g_slist_free_full(b->children, (GDestroyNotify) Mem_Free_);
+	mem_block_t *child = b->children;
+	while (child) {
+		mem_block_t *next = child->next;
+		Mem_Free_(shard, child);
+		child = next;
 	}
 
 	// decrement the pool size and free the memory
-	mem_state.size -= b->size;
+	shard->size -= b->size;
 
 	free(b);
 }
@@ -154,49 +299,67 @@ static void Mem_Free_(mem_block_t *b) {
 void Mem_Free(void *p) {
 	if (p) {
 		mem_block_t *b = Mem_CheckMagic(p);
+		mem_shard_t *shard = &mem_state.shards[b->shard];
 
-		SDL_mutexP(mem_state.lock);
+		SDL_mutexP(shard->lock);
 
-		if (b->parent) {
-			b->parent->children = g_slist_remove(b->parent->children, b);
-		} else {
-			g_hash_table_remove(mem_state.blocks, (gconstpointer) b);
-		}
+		Mem_RemoveBlock(b);
 
-		Mem_Free_(b);
+		Mem_Free_(shard, b);
 
-		SDL_mutexV(mem_state.lock);
+		SDL_mutexV(shard->lock);
 	}
 }
 
 /**
- * @brief Free all managed items allocated with the specified tag.
+ * @brief Free all managed items allocated with the specified tag. Only the
+ * blocks of that tag are visited.
  */
 void Mem_FreeTag(mem_tag_t tag) {
-	GHashTableIter it;
-	gpointer key, value;
 
-	SDL_mutexP(mem_state.lock);
+	for (uint32_t i = 0; i < MEM_SHARDS; i++) {
+		mem_shard_t *shard = &mem_state.shards[i];
+
+		SDL_mutexP(shard->lock);
+
+		for (mem_tag_list_t *list = shard->tags; list; list = list->next) {
 
-	g_hash_table_iter_init(&it, mem_state.blocks);
+			if (tag == MEM_TAG_ALL || list->tag == tag) {
 
-	while (g_hash_table_iter_next(&it, &key, &value)) {
-		mem_block_t *b = (mem_block_t *) key;
+				mem_block_t *b = list->blocks;
+				list->blocks = NULL;
 
-		if (tag == MEM_TAG_ALL || b->tag == tag) {
-			g_hash_table_iter_remove(&it);
-			Mem_Free_(b);
+				while (b) {
+					mem_block_t *next = b->next;
+					Mem_Free_(shard, b);
+					b = next;
+				}
+			}
 		}
-	}
 
-	SDL_mutexV(mem_state.lock);
+		SDL_mutexV(shard->lock);
+	}
 }
 
 /**
  * @brief Returns the total size of a memory block.
  */
 static size_t Mem_BlockSize(const size_t size) {
+#if defined(MEM_CHECKS)
 	return size + sizeof(mem_block_t) + sizeof(mem_footer_t);
+#else
+	return size + sizeof(mem_block_t);
+#endif
+}
+
+/**
+ * @brief Writes the footer magic for the specified block.
+ */
+static void Mem_SetFooter(mem_block_t *b) {
+#if defined(MEM_CHECKS)
+	mem_footer_t *footer = (mem_footer_t *) (((byte *) (b + 1)) + b->size);
+	footer->magic = (mem_magic_t) (MEM_MAGIC + b->size);
+#endif
 }
 
 /**
@@ -222,35 +385,39 @@ static void *Mem_Malloc_(size_t size, mem_tag_t tag, void *parent) {
 		return NULL;
 	}
 
+#if defined(MEM_CHECKS)
 	b->magic = MEM_MAGIC;
+#endif
 	b->tag = tag;
 	b->parent = p;
 	b->size = size;
 
-	void *data = (void *) (b + 1);
+	Mem_SetFooter(b);
 
-	mem_footer_t *footer = (mem_footer_t *) (((byte *) data) + size);
-	footer->magic = (mem_magic_t) (MEM_MAGIC + b->size);
+	// children live in the shard of their parent, roots in that of this thread
+	b->shard = p ? p->shard : Mem_Shard();
+
+	mem_shard_t *shard = &mem_state.shards[b->shard];
 
 	// insert it into the managed memory structures
-	SDL_mutexP(mem_state.lock);
+	SDL_mutexP(shard->lock);
 
-	if (b->parent) {
-		b->parent->children = g_slist_prepend(b->parent->children, b);
+	if (p) {
+		Mem_InsertBlock(b, &p->children);
 	} else {
-		g_hash_table_add(mem_state.blocks, b);
+		Mem_InsertBlock(b, Mem_TagBlocks(shard, tag));
 	}
 
-	mem_state.size += size;
-	
+	shard->size += size;
+
 #if defined(SUPER_MEMORY_CHECKS)
 	Mem_SetStack(b);
 #endif
 
-	SDL_mutexV(mem_state.lock);
+	SDL_mutexV(shard->lock);
 
 	// return the address in front of the block
-	return data;
+	return (void *) (b + 1);
 }
 
 /**
@@ -310,9 +477,14 @@ void *Mem_Realloc(void *p, size_t size) {
 	}
 
 	// allocate the block plus the desired size
-	const size_t old_size = b->size;
 	const size_t s = Mem_BlockSize(size);
 
+	mem_shard_t *shard = &mem_state.shards[b->shard];
+
+	// the block may move, so it must not be visible to other threads meanwhile
+	SDL_mutexP(shard->lock);
+
+	const size_t old_size = b->size;
 	b->size = size;
 
 #if defined(SUPER_MEMORY_PRINTS)
@@ -325,33 +497,25 @@ void *Mem_Realloc(void *p, size_t size) {
 		return NULL;
 	}
 
-	void *data = (void *) (new_b + 1);
-
-	mem_footer_t *footer = (mem_footer_t *) (((byte *) data) + size);
-	footer->magic = (mem_magic_t) (MEM_MAGIC + new_b->size);
+	Mem_SetFooter(new_b);
 
-	SDL_mutexP(mem_state.lock);
-
-	// re-seat us in our parent or in global hash list
-	if (new_b->parent) {
-		new_b->parent->children = g_slist_remove(new_b->parent->children, b);
-		new_b->parent->children = g_slist_prepend(new_b->parent->children, new_b);
-	} else {
-		g_hash_table_remove(mem_state.blocks, b);
-		g_hash_table_add(mem_state.blocks, new_b);
+	// re-seat us in our list, and our children in us
+	*new_b->prev = new_b;
+	if (new_b->next) {
+		new_b->next->prev = &new_b->next;
 	}
 
-	// change our childrens' parent pointers
 	if (new_b->children) {
-		for (GSList *children = new_b->children; children; children = children->next) {
-			mem_block_t *child = (mem_block_t *) children->data;
+		new_b->children->prev = &new_b->children;
+
+		for (mem_block_t *child = new_b->children; child; child = child->next) {
 			child->parent = new_b;
 		}
 	}
 
-	mem_state.size -= old_size;
-	mem_state.size += size;
-	
+	shard->size -= old_size;
+	shard->size += size;
+
 #if defined(SUPER_MEMORY_CHECKS)
 	Mem_SetStack(new_b);
 
@@ -360,9 +524,26 @@ void *Mem_Realloc(void *p, size_t size) {
 #endif
 #endif
 
-	SDL_mutexV(mem_state.lock);
+	SDL_mutexV(shard->lock);
 
-	return data;
+	return (void *) (new_b + 1);
+}
+
+/**
+ * @brief Moves the specified block and all of its descendants to a shard.
+ *
+ * @return The total size of the moved blocks.
+ */
+static size_t Mem_SetShard(mem_block_t *b, uint32_t shard) {
+
+	size_t size = b->size;
+	b->shard = shard;
+
+	for (mem_block_t *child = b->children; child; child = child->next) {
+		size += Mem_SetShard(child, shard);
+	}
+
+	return size;
 }
 
 /**
@@ -378,18 +559,23 @@ void *Mem_Link(void *child, void *parent) {
 	mem_block_t *c = Mem_CheckMagic(child);
 	mem_block_t *p = Mem_CheckMagic(parent);
 
-	SDL_mutexP(mem_state.lock);
+	const uint32_t c_shard = c->shard, p_shard = p->shard;
 
-	if (c->parent) {
-		c->parent->children = g_slist_remove(c->parent->children, c);
-	} else {
-		g_hash_table_remove(mem_state.blocks, c);
-	}
+	Mem_LockShards(c_shard, p_shard);
+
+	Mem_RemoveBlock(c);
 
 	c->parent = p;
-	p->children = g_slist_prepend(p->children, c);
+	Mem_InsertBlock(c, &p->children);
 
-	SDL_mutexV(mem_state.lock);
+	if (c_shard != p_shard) {
+		const size_t size = Mem_SetShard(c, p_shard);
+
+		mem_state.shards[c_shard].size -= size;
+		mem_state.shards[p_shard].size += size;
+	}
+
+	Mem_UnlockShards(c_shard, p_shard);
 
 	return child;
 }
@@ -398,7 +584,16 @@ void *Mem_Link(void *child, void *parent) {
  * @return The current size (user bytes) of the zone allocation pool.
  */
 size_t Mem_Size(void) {
-	return mem_state.size;
+
+	size_t size = 0;
+
+	for (uint32_t i = 0; i < MEM_SHARDS; i++) {
+		SDL_mutexP(mem_state.shards[i].lock);
+		size += mem_state.shards[i].size;
+		SDL_mutexV(mem_state.shards[i].lock);
+	}
+
+	return size;
 }
 
 /**
@@ -435,8 +630,8 @@ static size_t Mem_CalculateBlockSize(const mem_block_t *b) {
 
 	size_t size = b->size;
 
-	for (GSList *child = b->children; child; child = child->next) {
-		size += Mem_CalculateBlockSize((const mem_block_t *) child->data);
+	for (const mem_block_t *child = b->children; child; child = child->next) {
+		size += Mem_CalculateBlockSize(child);
 	}
 
 	return size;
@@ -447,52 +642,212 @@ static size_t Mem_CalculateBlockSize(const mem_block_t *b) {
  */
 GArray *Mem_Stats(void) {
 
-	GHashTableIter it;
-	gpointer key, value;
-
-	SDL_mutexP(mem_state.lock);
-
 	GArray *stat_array = g_array_new(false, true, sizeof(mem_stat_t));
 
 	stat_array = g_array_append_vals(stat_array, &(const mem_stat_t) {
 		.tag = -1,
-		 .size = mem_state.size,
+		 .size = 0,
 		  .count = 0
 	}, 1);
 
-	g_hash_table_iter_init(&it, mem_state.blocks);
+	for (uint32_t i = 0; i < MEM_SHARDS; i++) {
+		mem_shard_t *shard = &mem_state.shards[i];
+
+		SDL_mutexP(shard->lock);
 
-	while (g_hash_table_iter_next(&it, &key, &value)) {
-		const mem_block_t *b = (const mem_block_t *) key;
-		mem_stat_t *stats = NULL;
+		g_array_index(stat_array, mem_stat_t, 0).size += shard->size;
+
+		for (const mem_tag_list_t *list = shard->tags; list; list = list->next) {
+
+			if (list->blocks == NULL) {
+				continue;
+			}
 
-		for (size_t i = 0; i < stat_array->len; i++) {
+			mem_stat_t *stats = NULL;
 
-			mem_stat_t *stat_i = &g_array_index(stat_array, mem_stat_t, i);
+			for (size_t j = 0; j < stat_array->len; j++) {
+
+				mem_stat_t *stat_j = &g_array_index(stat_array, mem_stat_t, j);
+
+				if (stat_j->tag == list->tag) {
+					stats = stat_j;
+					break;
+				}
+			}
+
+			if (stats == NULL) {
+				stat_array = g_array_append_vals(stat_array, &(const mem_stat_t) {
+					.tag = list->tag
+				}, 1);
+
+				stats = &g_array_index(stat_array, mem_stat_t, stat_array->len - 1);
+			}
 
-			if (stat_i->tag == b->tag) {
-				stats = stat_i;
-				break;
+			for (const mem_block_t *b = list->blocks; b; b = b->next) {
+				stats->size += Mem_CalculateBlockSize(b);
+				stats->count++;
 			}
 		}
 
-		if (stats == NULL) {
-			stat_array = g_array_append_vals(stat_array, &(const mem_stat_t) {
-				.tag = b->tag,
-				 .size = Mem_CalculateBlockSize(b),
-				  .count = 1
-			}, 1);
+		SDL_mutexV(shard->lock);
+	}
+
+	g_array_sort(stat_array, Mem_Stats_Sort);
+
+	return stat_array;
+}
+
+#define MEM_ARENA_ALIGN 16
+#define MEM_FRAME_CHUNK_SIZE (256 * 1024)
+
+/**
+ * @brief A chunk of arena memory, linked to the arena that owns it.
+ */
+typedef struct mem_arena_chunk_s {
+	struct mem_arena_chunk_s *next;
+	size_t size;
+	size_t used;
+	byte *data;
+} mem_arena_chunk_t;
+
+struct mem_arena_s {
+	size_t chunk_size;
+	mem_arena_chunk_t *chunks;
+	mem_arena_chunk_t *current;
+	int32_t frame;
+};
+
+/**
+ * @brief Creates a new arena. The arena and its chunks are managed memory with
+ * the specified tag, and so are reported by Mem_Stats and freed by Mem_FreeTag.
+ *
+ * @param chunk_size The size of the chunks backing the arena. Allocations larger
+ * than this are given chunks of their own.
+ * @param tag The tag to allocate the arena with.
+ */
+mem_arena_t *Mem_ArenaCreate(size_t chunk_size, mem_tag_t tag) {
+
+	mem_arena_t *arena = Mem_TagMalloc(sizeof(mem_arena_t), tag);
+
+	arena->chunk_size = chunk_size;
+	arena->frame = -1;
+
+	return arena;
+}
+
+/**
+ * @brief Allocates a block of memory from the specified arena, adding a chunk
+ * if the remaining chunks can not hold it.
+ *
+ * @return A block of memory initialized to 0x0.
+ */
+void *Mem_ArenaAlloc(mem_arena_t *arena, size_t size) {
+
+	size = (size + MEM_ARENA_ALIGN - 1) & ~((size_t) MEM_ARENA_ALIGN - 1);
+
+	mem_arena_chunk_t *chunk = arena->current;
+	while (chunk && chunk->used + size > chunk->size) {
+		chunk = chunk->next;
+	}
+
+	if (chunk == NULL) {
+		const size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+
+		chunk = Mem_LinkMalloc(sizeof(mem_arena_chunk_t) + MEM_ARENA_ALIGN + chunk_size, arena);
+
+		chunk->size = chunk_size;
+		chunk->data = (byte *) (((uintptr_t) (chunk + 1) + MEM_ARENA_ALIGN - 1) & ~((uintptr_t) MEM_ARENA_ALIGN - 1));
+
+		if (arena->current) {
+			mem_arena_chunk_t *tail = arena->current;
+			while (tail->next) {
+				tail = tail->next;
+			}
+			tail->next = chunk;
 		} else {
-			stats->size += Mem_CalculateBlockSize(b);
-			stats->count++;
+			arena->chunks = chunk;
 		}
 	}
 
-	SDL_mutexV(mem_state.lock);
+	arena->current = chunk;
 
-	g_array_sort(stat_array, Mem_Stats_Sort);
+	void *data = chunk->data + chunk->used;
+	chunk->used += size;
 
-	return stat_array;
+	memset(data, 0, size);
+	return data;
+}
+
+/**
+ * @brief Allocates and returns a copy of the specified string from the arena.
+ */
+char *Mem_ArenaCopyString(mem_arena_t *arena, const char *in) {
+
+	const size_t len = strlen(in) + 1;
+
+	char *out = Mem_ArenaAlloc(arena, len);
+	memcpy(out, in, len);
+
+	return out;
+}
+
+/**
+ * @brief Releases all allocations made from the arena at once. Its chunks are
+ * retained for subsequent allocations.
+ */
+void Mem_ArenaReset(mem_arena_t *arena) {
+
+	for (mem_arena_chunk_t *chunk = arena->chunks; chunk; chunk = chunk->next) {
+		chunk->used = 0;
+	}
+
+	arena->current = arena->chunks;
+}
+
+static __thread mem_arena_t *mem_frame_arena;
+
+/**
+ * @brief Allocates a block of memory that is valid until the next call to
+ * Mem_ResetFrame. Each thread allocates from its own arena, so no lock is taken.
+ * Frame memory must not be handed to jobs that may outlive the frame.
+ *
+ * @return A block of memory initialized to 0x0.
+ */
+void *Mem_FrameMalloc(size_t size) {
+
+	if (mem_frame_arena == NULL) {
+		mem_frame_arena = Mem_ArenaCreate(MEM_FRAME_CHUNK_SIZE, MEM_TAG_FRAME);
+	}
+
+	// the arena is reset lazily by its owning thread
+	const int32_t frame = SDL_AtomicGet(&mem_state.frame);
+	if (mem_frame_arena->frame != frame) {
+		Mem_ArenaReset(mem_frame_arena);
+		mem_frame_arena->frame = frame;
+	}
+
+	return Mem_ArenaAlloc(mem_frame_arena, size);
+}
+
+/**
+ * @brief Allocates and returns a copy of the specified string in frame memory.
+ */
+char *Mem_FrameCopyString(const char *in) {
+
+	const size_t len = strlen(in) + 1;
+
+	char *out = Mem_FrameMalloc(len);
+	memcpy(out, in, len);
+
+	return out;
+}
+
+/**
+ * @brief Releases all frame memory, for all threads. This is called once at the
+ * start of each server and client frame.
+ */
+void Mem_ResetFrame(void) {
+	SDL_AtomicAdd(&mem_state.frame, 1);
 }
 
 /**
@@ -503,9 +858,9 @@ void Mem_Init(void) {
 
 	memset(&mem_state, 0, sizeof(mem_state));
 
-	mem_state.blocks = g_hash_table_new(g_direct_hash, g_direct_equal);
-
-	mem_state.lock = SDL_CreateMutex();
+	for (uint32_t i = 0; i < MEM_SHARDS; i++) {
+		mem_state.shards[i].lock = SDL_CreateMutex();
+	}
 }
 
 /**
@@ -516,7 +871,17 @@ void Mem_Shutdown(void) {
 
 	Mem_FreeTag(MEM_TAG_ALL);
 
-	g_hash_table_destroy(mem_state.blocks);
+	mem_frame_arena = NULL;
+
+	for (uint32_t i = 0; i < MEM_SHARDS; i++) {
+		mem_shard_t *shard = &mem_state.shards[i];
 
-	SDL_DestroyMutex(mem_state.lock);
+		while (shard->tags) {
+			mem_tag_list_t *list = shard->tags;
+			shard->tags = list->next;
+			free(list);
+		}
+
+		SDL_DestroyMutex(shard->lock);
+	}
 }
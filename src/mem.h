@@ -46,5 +46,22 @@ typedef struct {
 
 GArray *Mem_Stats(void);
 
+/**
+ * @brief Arenas are bump-pointer allocators backed by managed memory. Their
+ * allocations can not be freed individually, but are released in bulk with
+ * Mem_ArenaReset, or with the arena itself through Mem_Free. Arenas are not
+ * thread-safe.
+ */
+typedef struct mem_arena_s mem_arena_t;
+
+mem_arena_t *Mem_ArenaCreate(size_t chunk_size, mem_tag_t tag);
+void *Mem_ArenaAlloc(mem_arena_t *arena, size_t size);
+char *Mem_ArenaCopyString(mem_arena_t *arena, const char *in);
+void Mem_ArenaReset(mem_arena_t *arena);
+
+void *Mem_FrameMalloc(size_t size);
+char *Mem_FrameCopyString(const char *in);
+void Mem_ResetFrame(void);
+
 void Mem_Init(void);
 void Mem_Shutdown(void);
@@ -19,42 +19,52 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <SDL2/SDL_timer.h>
+#include <zlib.h>
+
 #include "cvar.h"
 #include "net_chan.h"
+#include "net_sim.h"
 
 /*
  *
  * packet header
  * -------------
  * 31	sequence
- * 1	does this message contain a reliable payload
+ * 1	does this message contain reliable fragments
  * 31	acknowledge sequence
- * 1	acknowledge receipt of even/odd message
- * 8	qport
+ * 1	unused
+ * 8	qport (client to server only)
+ * 32	reliable acknowledge, the first fragment not yet received
+ * 32	selective acknowledge of the fragments following it
  *
- * The remote connection never knows if it missed a reliable message, the
- * local side detects that it has been dropped by seeing a sequence acknowledge
- * higher than the last reliable sequence, but without the correct even/odd
- * bit for the reliable set.
+ * Reliable messages are split into fragments of up to NET_FRAGMENT_SIZE bytes,
+ * each with its own sequence number, and up to NET_WINDOW_SIZE fragments may be
+ * in flight at once. Every packet acknowledges the fragments its sender has
+ * received, both cumulatively and selectively, so that only those fragments
+ * that were actually lost are retransmitted.
  *
- * If the sender notices that a reliable message has been dropped, it will be
- * retransmitted. It will not be retransmitted again until a message after
- * the retransmit has been acknowledged and the reliable still failed to get theve.
+ * The sender notices that a fragment has been dropped when a packet sent after
+ * it has been acknowledged, but the fragment has not. Because stale packets
+ * are discarded, the fragment can no longer arrive, and it is retransmitted.
  *
  * if the sequence number is -1, the packet should be handled without a netcon
  *
  * The reliable message can be added to at any time by doing
- * Net_Write*(&netchan->message, <data>).
+ * Net_Write*(&netchan->message, <data>). The message is fragmented once the
+ * window has room for all of it, so messages are never split across windows.
  *
  * If the message buffer is overflowed, either by a single message, or by
- * multiple frames worth piling up while the last reliable transmit goes
- * unacknowledged, the netchan signals a fatal error.
+ * multiple frames worth piling up while the window is full, the netchan
+ * signals a fatal error.
  *
- * Reliable messages are always placed first in a packet, then the unreliable
+ * Reliable fragments are always placed first in a packet, then the unreliable
  * message is included if there is sufficient room.
  *
- * To the receiver, there is no distinction between the reliable and unreliable
- * parts of the message, they are just processed out as a single larger message.
+ * The receiver reassembles fragments, and delivers complete reliable messages
+ * in order, ahead of the unreliable part of the packet. To the receiver, there
+ * is no distinction between the reliable and unreliable parts of the message,
+ * they are just processed out as a single larger message.
  *
  * Illogical packet sequence numbers cause the packet to be dropped, but do
  * not kill the connection. This, combined with the tight window of valid
@@ -72,11 +82,55 @@
  * such as during the connection stage while waiting for the client to load,
  * then a packet only needs to be delivered if there is something in the
  * unacknowledged reliable
+ *
+ * If both sides enable net_compression, the channel is set up to compress its
+ * payloads. Each packet header is then followed by a single byte indicating
+ * whether the payload was sent raw, or deflated with a preset dictionary.
+ * Packets are compressed independently of one another, so that loss does not
+ * affect the decoding of subsequent packets.
  */
 
 static cvar_t *net_show_packets;
 static cvar_t *net_show_drop;
 
+cvar_t *net_compression;
+
+/**
+ * @brief Netchan payload encodings.
+ */
+typedef enum {
+	NET_PAYLOAD_RAW,
+	NET_PAYLOAD_DEFLATE
+} net_payload_t;
+
+/**
+ * @brief Payloads smaller than this are not worth deflating.
+ */
+#define NET_COMPRESS_MIN_SIZE 64
+
+/**
+ * @brief The preset dictionary primes each deflated payload with strings that
+ * are common to reliable commands, so that even small payloads compress well.
+ * The most common strings should appear last.
+ */
+static const char net_dictionary[] =
+	"print\nServer is full\nConnection refused\nBad challenge\n"
+	"models/players/sounds/players/pics/maps/.md3.obj.bsp.ogg.wav.tga.png"
+	"\\skin\\color\\hand\\hook\\name\\team\\"
+	"baselines precache download disconnect reconnect changing "
+	" entered the game\n timed out\n was fragged by  picked up the "
+	"\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
+
+/**
+ * @brief The compression streams, one pair for each net source, since each
+ * source transmits and processes packets from a single thread.
+ */
+static struct {
+	z_stream deflate;
+	z_stream inflate;
+	_Bool initialized;
+} net_codecs[NS_UDP_SERVER + 1];
+
 net_addr_t net_from;
 mem_buf_t net_message;
 static byte net_message_buffer[MAX_MSG_SIZE];
@@ -134,27 +188,352 @@ void Netchan_Setup(net_src_t source, net_chan_t *chan, net_addr_t *addr, uint8_t
 }
 
 /**
- * @return True if reliable data must be transmitted this frame, false
- * otherwise.
+ * @return The fragment slot for the given reliable sequence number.
+ */
+static inline net_fragment_t *Netchan_Fragment(net_fragment_t *window, uint32_t sequence) {
+	return &window[sequence & (NET_WINDOW_SIZE - 1)];
+}
+
+/**
+ * @brief Splits the pending reliable message into fragments, if the window has
+ * room for all of them.
+ */
+static void Netchan_QueueReliable(net_chan_t *chan) {
+
+	if (chan->message.size == 0) {
+		return;
+	}
+
+	const uint32_t count = (uint32_t) ((chan->message.size + NET_FRAGMENT_SIZE - 1) / NET_FRAGMENT_SIZE);
+
+	if (chan->reliable_outgoing - chan->reliable_acknowledged + count > NET_WINDOW_SIZE) {
+		return;
+	}
+
+	for (size_t offset = 0; offset < chan->message.size; offset += NET_FRAGMENT_SIZE) {
+		net_fragment_t *frag = Netchan_Fragment(chan->reliable_out, chan->reliable_outgoing);
+
+		frag->sequence = chan->reliable_outgoing++;
+		frag->size = (uint16_t) Min(chan->message.size - offset, (size_t) NET_FRAGMENT_SIZE);
+		frag->last = offset + frag->size == chan->message.size;
+		frag->acknowledged = false;
+		frag->sent_sequence = 0;
+
+		memcpy(frag->data, chan->message.data + offset, frag->size);
+	}
+
+	chan->message.size = 0;
+}
+
+/**
+ * @brief Marks the fragments the remote side has received as acknowledged, and
+ * slides the window past them. Unacknowledged fragments that were sent in or
+ * before the acknowledged packet were lost, and are marked for retransmission.
+ */
+static void Netchan_AcknowledgeReliable(net_chan_t *chan, uint32_t ack, uint32_t selective, uint32_t sequence_ack) {
+
+	if (ack - chan->reliable_acknowledged > chan->reliable_outgoing - chan->reliable_acknowledged) {
+		return; // illogical, or stale
+	}
+
+	for (uint32_t seq = chan->reliable_acknowledged; seq != ack; seq++) {
+		Netchan_Fragment(chan->reliable_out, seq)->acknowledged = true;
+	}
+
+	for (uint32_t i = 0; i < 32; i++) {
+		if (selective & (1u << i)) {
+			const uint32_t seq = ack + 1 + i;
+			if (seq - chan->reliable_acknowledged < chan->reliable_outgoing - chan->reliable_acknowledged) {
+				Netchan_Fragment(chan->reliable_out, seq)->acknowledged = true;
+			}
+		}
+	}
+
+	while (chan->reliable_acknowledged != chan->reliable_outgoing) {
+		if (!Netchan_Fragment(chan->reliable_out, chan->reliable_acknowledged)->acknowledged) {
+			break;
+		}
+		chan->reliable_acknowledged++;
+	}
+
+	for (uint32_t seq = chan->reliable_acknowledged; seq != chan->reliable_outgoing; seq++) {
+		net_fragment_t *frag = Netchan_Fragment(chan->reliable_out, seq);
+
+		if (!frag->acknowledged && frag->sent_sequence && frag->sent_sequence <= sequence_ack) {
+			frag->sent_sequence = 0;
+
+			if (net_show_drop->value) {
+				Com_Print("%s:Retransmitting fragment %u\n", Net_NetaddrToString(&chan->remote_address), seq);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Computes the acknowledgement of received fragments to send to the
+ * remote side: the first fragment not yet received, and a bit for each of the
+ * 32 fragments following it that has been received.
+ */
+static void Netchan_ReliableAcknowledgement(net_chan_t *chan, uint32_t *ack, uint32_t *selective) {
+
+	const uint32_t end = chan->reliable_incoming + NET_WINDOW_SIZE;
+
+	uint32_t seq = chan->reliable_incoming;
+	while (seq != end) {
+		const net_fragment_t *frag = Netchan_Fragment(chan->reliable_in, seq);
+		if (!frag->received || frag->sequence != seq) {
+			break;
+		}
+		seq++;
+	}
+
+	*ack = seq;
+	*selective = 0;
+
+	for (uint32_t i = 0; i < 32; i++) {
+		const uint32_t s = seq + 1 + i;
+		if (s - chan->reliable_incoming >= NET_WINDOW_SIZE) {
+			break;
+		}
+
+		const net_fragment_t *frag = Netchan_Fragment(chan->reliable_in, s);
+		if (frag->received && frag->sequence == s) {
+			*selective |= (1u << i);
+		}
+	}
+}
+
+/**
+ * @brief Reads the reliable fragments in the current message into the receive
+ * window. Fragments outside of the window, or already received, are skipped.
+ *
+ * @return True if the fragments were read, false if the message is corrupt.
+ */
+static _Bool Netchan_ReadFragments(net_chan_t *chan, mem_buf_t *msg) {
+
+	const int32_t count = Net_ReadByte(msg);
+
+	for (int32_t i = 0; i < count; i++) {
+
+		const uint32_t seq = (uint32_t) Net_ReadLong(msg);
+		const uint16_t bits = (uint16_t) Net_ReadShort(msg);
+
+		const uint16_t size = bits & ~NET_FRAGMENT_LAST;
+
+		if (size > NET_FRAGMENT_SIZE || msg->read + size > msg->size) {
+			return false;
+		}
+
+		net_fragment_t *frag = Netchan_Fragment(chan->reliable_in, seq);
+
+		if (seq - chan->reliable_incoming < NET_WINDOW_SIZE && !(frag->received && frag->sequence == seq)) {
+			frag->sequence = seq;
+			frag->size = size;
+			frag->last = !!(bits & NET_FRAGMENT_LAST);
+			frag->received = true;
+
+			memcpy(frag->data, msg->data + msg->read, size);
+		}
+
+		msg->read += size;
+		chan->reliable_ack_pending = true;
+	}
+
+	return msg->read <= msg->size;
+}
+
+/**
+ * @brief Rewrites the current message, from offset, as the complete reliable
+ * messages now available, in order, followed by the unreliable payload. Reliable
+ * messages that do not fit are held for subsequent packets.
+ */
+static void Netchan_Deliver(net_chan_t *chan, mem_buf_t *msg, size_t offset) {
+	byte buffer[MAX_MSG_SIZE];
+	mem_buf_t out;
+
+	Mem_InitBuffer(&out, buffer, Min(sizeof(buffer), msg->max_size - offset));
+
+	while (true) {
+
+		size_t size = 0;
+		uint32_t seq = chan->reliable_incoming;
+
+		const net_fragment_t *frag;
+		while (true) {
+			frag = Netchan_Fragment(chan->reliable_in, seq);
+			if (!frag->received || frag->sequence != seq) {
+				break;
+			}
+
+			size += frag->size;
+
+			if (frag->last) {
+				break;
+			}
+
+			seq++;
+		}
+
+		if (!frag->received || frag->sequence != seq || !frag->last) {
+			break; // the next message is incomplete
+		}
+
+		if (out.size + size > out.max_size) {
+			break; // or does not fit
+		}
+
+		for (; chan->reliable_incoming != seq + 1; chan->reliable_incoming++) {
+			net_fragment_t *f = Netchan_Fragment(chan->reliable_in, chan->reliable_incoming);
+
+			Mem_WriteBuffer(&out, f->data, f->size);
+			f->received = false;
+		}
+	}
+
+	const size_t len = msg->size - msg->read;
+
+	if (out.size + len <= out.max_size) {
+		Mem_WriteBuffer(&out, msg->data + msg->read, len);
+	} else if (net_show_drop->value) {
+		Com_Print("%s:Dumped unreliable\n", Net_NetaddrToString(&chan->remote_address));
+	}
+
+	memcpy(msg->data + offset, out.data, out.size);
+
+	msg->size = offset + out.size;
+	msg->read = offset;
+}
+
+/**
+ * @return True if the channel has reliable fragments to send or to acknowledge,
+ * and should therefore transmit a packet soon, even if it has no other data.
  */
-static _Bool Netchan_CheckRetransmit(net_chan_t *chan) {
+_Bool Netchan_Pending(const net_chan_t *chan) {
 
-	// if the remote side dropped the last reliable message, re-send it
-	if (chan->incoming_acknowledged > chan->reliable_outgoing && chan->reliable_acknowledged
-	        != chan->reliable_sequence) {
+	if (chan->message.size || chan->reliable_ack_pending) {
 		return true;
 	}
 
+	for (uint32_t seq = chan->reliable_acknowledged; seq != chan->reliable_outgoing; seq++) {
+		const net_fragment_t *frag = &chan->reliable_out[seq & (NET_WINDOW_SIZE - 1)];
+		if (!frag->acknowledged && frag->sent_sequence == 0) {
+			return true;
+		}
+	}
+
 	return false;
 }
 
+/**
+ * @return The number of reliable bytes that may be written to the channel's
+ * message before they would exceed either the window or the message buffer.
+ */
+size_t Netchan_ReliableSpace(const net_chan_t *chan) {
+
+	const size_t used = (chan->reliable_outgoing - chan->reliable_acknowledged) * NET_FRAGMENT_SIZE + chan->message.size;
+	const size_t window = NET_WINDOW_SIZE * NET_FRAGMENT_SIZE;
+
+	if (used >= window || chan->message.size >= chan->message.max_size) {
+		return 0;
+	}
+
+	return Min(window - used, chan->message.max_size - chan->message.size);
+}
+
+/**
+ * @brief Deflates the payload of the pending datagram, starting at offset, in
+ * place. The payload is left raw if it is small or does not compress.
+ */
+static void Netchan_Deflate(net_chan_t *chan, mem_buf_t *send, size_t offset) {
+	byte buffer[MAX_MSG_SIZE];
+
+	const size_t len = send->size - offset;
+	if (len < NET_COMPRESS_MIN_SIZE || !net_codecs[chan->source].initialized) {
+		return;
+	}
+
+	const uint64_t start = SDL_GetPerformanceCounter();
+
+	z_stream *stream = &net_codecs[chan->source].deflate;
+
+	deflateReset(stream);
+	deflateSetDictionary(stream, (const Bytef *) net_dictionary, sizeof(net_dictionary));
+
+	stream->next_in = send->data + offset;
+	stream->avail_in = (uInt) len;
+	stream->next_out = buffer;
+	stream->avail_out = (uInt) len - 1;
+
+	size_t size = len;
+
+	if (deflate(stream, Z_FINISH) == Z_STREAM_END) {
+		size = stream->total_out;
+
+		memcpy(send->data + offset, buffer, size);
+		send->data[offset - 1] = NET_PAYLOAD_DEFLATE;
+		send->size = offset + size;
+	}
+
+	chan->compress_packets++;
+	chan->compress_bytes_in += len;
+	chan->compress_bytes_out += size;
+	chan->compress_time += SDL_GetPerformanceCounter() - start;
+}
+
+/**
+ * @brief Reads the payload encoding of the current message, inflating the
+ * payload if necessary. The encoding byte is removed, so that the message
+ * appears to have been sent uncompressed (e.g. for demo recording).
+ *
+ * @return True if the payload is ready to be read, false if it is corrupt.
+ */
+static _Bool Netchan_Inflate(net_chan_t *chan, mem_buf_t *msg) {
+	byte buffer[MAX_MSG_SIZE];
+
+	const int32_t encoding = Net_ReadByte(msg);
+
+	if (encoding == NET_PAYLOAD_RAW) {
+		memmove(msg->data + msg->read - 1, msg->data + msg->read, msg->size - msg->read);
+		msg->read--;
+		msg->size--;
+		return true;
+	}
+
+	if (encoding != NET_PAYLOAD_DEFLATE || !net_codecs[chan->source].initialized) {
+		return false;
+	}
+
+	z_stream *stream = &net_codecs[chan->source].inflate;
+
+	inflateReset(stream);
+	inflateSetDictionary(stream, (const Bytef *) net_dictionary, sizeof(net_dictionary));
+
+	msg->read--;
+
+	stream->next_in = msg->data + msg->read + 1;
+	stream->avail_in = (uInt) (msg->size - msg->read - 1);
+	stream->next_out = buffer;
+	stream->avail_out = (uInt) Min(sizeof(buffer), msg->max_size - msg->read);
+
+	if (inflate(stream, Z_FINISH) != Z_STREAM_END) {
+		return false;
+	}
+
+	memcpy(msg->data + msg->read, buffer, stream->total_out);
+	msg->size = msg->read + stream->total_out;
+
+	return true;
+}
+
 /**
  * @brief Tries to send an unreliable message to a connection, and handles the
  * transmission / retransmission of the reliable messages.
  *
  * A 0 size will still generate a packet and deal with the reliable messages.
+ *
+ * @return The size of the datagram sent, after compression.
  */
-void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
+size_t Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
 	mem_buf_t send;
 	byte send_buffer[MAX_MSG_SIZE];
 
@@ -163,23 +542,41 @@ void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
 		Com_Error(ERROR_DROP, "%s: Overflow\n", Net_NetaddrToString(&chan->remote_address));
 	}
 
-	// check for re-transmission of reliable message
-	_Bool send_reliable = Netchan_CheckRetransmit(chan);
+	// fragment the pending reliable message, if the window has room for it
+	Netchan_QueueReliable(chan);
+
+	// select the fragments to send, lost fragments first since they are oldest
+	uint32_t fragments[NET_PACKET_FRAGMENTS];
+	uint32_t num_fragments = 0;
+	size_t fragments_size = 1;
+
+	for (uint32_t seq = chan->reliable_acknowledged; seq != chan->reliable_outgoing; seq++) {
+		const net_fragment_t *frag = Netchan_Fragment(chan->reliable_out, seq);
+
+		if (frag->acknowledged || frag->sent_sequence) {
+			continue;
+		}
+
+		const size_t size = fragments_size + 6 + frag->size;
+		if (num_fragments && size + len > MAX_MSG_SIZE - 32) {
+			break; // leave room for the unreliable part
+		}
 
-	// or for transmission of a new one
-	if (!chan->reliable_size && chan->message.size) {
-		memcpy(chan->reliable_buffer, chan->message_buffer, chan->message.size);
-		chan->reliable_size = chan->message.size;
-		chan->message.size = 0;
-		chan->reliable_sequence ^= 1;
-		send_reliable = true;
+		fragments[num_fragments++] = seq;
+		fragments_size = size;
+
+		if (num_fragments == NET_PACKET_FRAGMENTS) {
+			break;
+		}
 	}
 
+	const _Bool send_reliable = num_fragments > 0;
+
 	// write the packet header
 	Mem_InitBuffer(&send, send_buffer, sizeof(send_buffer));
 
-	const uint32_t w1 = (chan->outgoing_sequence & ~(1u << 31)) | (send_reliable << 31);
-	const uint32_t w2 = (chan->incoming_sequence & ~(1u << 31)) | (chan->reliable_incoming << 31);
+	const uint32_t w1 = (chan->outgoing_sequence & ~(1u << 31)) | ((uint32_t) send_reliable << 31);
+	const uint32_t w2 = (chan->incoming_sequence & ~(1u << 31));
 
 	chan->outgoing_sequence++;
 	chan->last_sent = quetoo.ticks;
@@ -192,10 +589,35 @@ void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
 		Net_WriteByte(&send, chan->qport);
 	}
 
-	// copy the reliable message to the packet first
+	// acknowledge the reliable fragments we've received
+	uint32_t ack, selective;
+	Netchan_ReliableAcknowledgement(chan, &ack, &selective);
+
+	Net_WriteLong(&send, ack);
+	Net_WriteLong(&send, selective);
+
+	chan->reliable_ack_pending = false;
+
+	// and the payload encoding, if negotiated
+	if (chan->compress) {
+		Net_WriteByte(&send, NET_PAYLOAD_RAW);
+	}
+
+	const size_t payload = send.size;
+
+	// copy the reliable fragments to the packet first
 	if (send_reliable) {
-		Mem_WriteBuffer(&send, chan->reliable_buffer, chan->reliable_size);
-		chan->reliable_outgoing = chan->outgoing_sequence;
+		Net_WriteByte(&send, num_fragments);
+
+		for (uint32_t i = 0; i < num_fragments; i++) {
+			net_fragment_t *frag = Netchan_Fragment(chan->reliable_out, fragments[i]);
+
+			Net_WriteLong(&send, frag->sequence);
+			Net_WriteShort(&send, frag->size | (frag->last ? NET_FRAGMENT_LAST : 0));
+			Mem_WriteBuffer(&send, frag->data, frag->size);
+
+			frag->sent_sequence = chan->outgoing_sequence - 1;
+		}
 	}
 
 	// add the unreliable part if space is available
@@ -205,18 +627,24 @@ void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
 		Com_Warn("Netchan_Transmit: dumped unreliable\n");
 	}
 
+	if (chan->compress) {
+		Netchan_Deflate(chan, &send, payload);
+	}
+
 	// send the datagram
 	Net_SendDatagram(chan->source, &chan->remote_address, send.data, send.size);
 
 	if (net_show_packets->value) {
 		if (send_reliable)
-			Com_Print("Send %u bytes: s=%i reliable=%i ack=%i rack=%i\n", (uint32_t) send.size,
-			          chan->outgoing_sequence - 1, chan->reliable_sequence, chan->incoming_sequence,
-			          chan->reliable_incoming);
+			Com_Print("Send %u bytes: s=%i fragments=%u-%u ack=%i rack=%u\n", (uint32_t) send.size,
+			          chan->outgoing_sequence - 1, fragments[0], fragments[num_fragments - 1],
+			          chan->incoming_sequence, ack);
 		else
-			Com_Print("Send %u bytes : s=%i ack=%i rack=%i\n", (uint32_t) send.size,
-			          chan->outgoing_sequence - 1, chan->incoming_sequence, chan->reliable_incoming);
+			Com_Print("Send %u bytes : s=%i ack=%i rack=%u\n", (uint32_t) send.size,
+			          chan->outgoing_sequence - 1, chan->incoming_sequence, ack);
 	}
+
+	return send.size;
 }
 
 /**
@@ -225,7 +653,8 @@ void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len) {
  */
 _Bool Netchan_Process(net_chan_t *chan, mem_buf_t *msg) {
 	uint32_t sequence, sequence_ack;
-	uint32_t reliable_ack, reliable_message;
+	uint32_t reliable_ack, reliable_selective;
+	_Bool reliable_message;
 
 	// get sequence numbers
 	Net_BeginReading(msg);
@@ -238,21 +667,32 @@ _Bool Netchan_Process(net_chan_t *chan, mem_buf_t *msg) {
 		Net_ReadByte(msg);
 	}
 
+	// the payload, as delivered, begins here
+	const size_t offset = msg->read;
+
+	reliable_ack = Net_ReadLong(msg);
+	reliable_selective = Net_ReadLong(msg);
+
 	reliable_message = sequence >> 31u;
-	reliable_ack = sequence_ack >> 31u;
 
 	sequence &= ~(1u << 31);
 	sequence_ack &= ~(1u << 31);
 
 	if (net_show_packets->value) {
 		if (reliable_message)
-			Com_Print("Recv %u bytes: s=%i reliable=%i ack=%i rack=%i\n", (uint32_t) msg->size,
-			          sequence, chan->reliable_incoming ^ 1, sequence_ack, reliable_ack);
+			Com_Print("Recv %u bytes: s=%i reliable ack=%i rack=%u\n", (uint32_t) msg->size,
+			          sequence, sequence_ack, reliable_ack);
 		else
-			Com_Print("Recv %u bytes : s=%i ack=%i rack=%i\n", (uint32_t) msg->size, sequence,
+			Com_Print("Recv %u bytes : s=%i ack=%i rack=%u\n", (uint32_t) msg->size, sequence,
 			          sequence_ack, reliable_ack);
 	}
 
+	if (msg->read > msg->size) {
+		if (net_show_drop->value)
+			Com_Print("%s:Runt packet %i\n", Net_NetaddrToString(&chan->remote_address), sequence);
+		return false;
+	}
+
 	// discard stale or duplicated packets
 	if (sequence <= chan->incoming_sequence) {
 		if (net_show_drop->value)
@@ -261,6 +701,20 @@ _Bool Netchan_Process(net_chan_t *chan, mem_buf_t *msg) {
 		return false;
 	}
 
+	// inflate the payload, if necessary
+	if (chan->compress && !Netchan_Inflate(chan, msg)) {
+		if (net_show_drop->value)
+			Com_Print("%s:Corrupt payload %i\n", Net_NetaddrToString(&chan->remote_address), sequence);
+		return false;
+	}
+
+	// read any reliable fragments into the receive window
+	if (reliable_message && !Netchan_ReadFragments(chan, msg)) {
+		if (net_show_drop->value)
+			Com_Print("%s:Corrupt fragments %i\n", Net_NetaddrToString(&chan->remote_address), sequence);
+		return false;
+	}
+
 	// dropped packets don't keep the message from being used
 	chan->dropped = sequence - (chan->incoming_sequence + 1);
 	if (chan->dropped > 0) {
@@ -269,19 +723,14 @@ _Bool Netchan_Process(net_chan_t *chan, mem_buf_t *msg) {
 			          chan->dropped, sequence);
 	}
 
-	// if the current outgoing reliable message has been acknowledged
-	// clear the buffer to make way for the next
-	if (reliable_ack == chan->reliable_sequence) {
-		chan->reliable_size = 0;    // it has been received
-	}
+	// slide the send window past any fragments the remote side has received
+	Netchan_AcknowledgeReliable(chan, reliable_ack, reliable_selective, sequence_ack);
 
-	// if this message contains a reliable message, bump reliable_incoming
 	chan->incoming_sequence = sequence;
 	chan->incoming_acknowledged = sequence_ack;
-	chan->reliable_acknowledged = reliable_ack;
-	if (reliable_message) {
-		chan->reliable_incoming ^= 1;
-	}
+
+	// deliver any complete reliable messages ahead of the unreliable payload
+	Netchan_Deliver(chan, msg, offset);
 
 	// the message can now be read from the current message pointer
 	chan->last_received = quetoo.ticks;
@@ -298,6 +747,28 @@ void Netchan_Init(void) {
 
 	net_show_packets = Cvar_Add("net_show_packets", "0", 0, NULL);
 	net_show_drop = Cvar_Add("net_show_drop", "0", 0, NULL);
+	net_compression = Cvar_Add("net_compression", "1", CVAR_ARCHIVE,
+	                           "Negotiate compression of network payloads when connecting");
+
+	Net_InitSim();
+
+	for (size_t i = 0; i < lengthof(net_codecs); i++) {
+
+		memset(&net_codecs[i], 0, sizeof(net_codecs[i]));
+
+		if (deflateInit2(&net_codecs[i].deflate, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			Com_Warn("Failed to initialize deflate\n");
+			continue;
+		}
+
+		if (inflateInit2(&net_codecs[i].inflate, -MAX_WBITS) != Z_OK) {
+			Com_Warn("Failed to initialize inflate\n");
+			deflateEnd(&net_codecs[i].deflate);
+			continue;
+		}
+
+		net_codecs[i].initialized = true;
+	}
 
 	Mem_InitBuffer(&net_message, net_message_buffer, sizeof(net_message_buffer));
 }
@@ -310,6 +781,16 @@ void Netchan_Shutdown(void) {
 	Net_Config(NS_UDP_CLIENT, false);
 	Net_Config(NS_UDP_SERVER, false);
 
+	Net_ShutdownSim();
+
+	for (size_t i = 0; i < lengthof(net_codecs); i++) {
+		if (net_codecs[i].initialized) {
+			deflateEnd(&net_codecs[i].deflate);
+			inflateEnd(&net_codecs[i].inflate);
+			net_codecs[i].initialized = false;
+		}
+	}
+
 	Net_Shutdown();
 }
 
@@ -27,11 +27,15 @@
 extern net_addr_t net_from;
 extern mem_buf_t net_message;
 
+extern cvar_t *net_compression;
+
 void Netchan_Setup(net_src_t source, net_chan_t *chan, net_addr_t *addr, uint8_t qport);
-void Netchan_Transmit(net_chan_t *chan, byte *data, size_t len);
+size_t Netchan_Transmit(net_chan_t *chan, byte *data, size_t len);
 void Netchan_OutOfBand(int32_t sock, const net_addr_t *addr, const void *data, size_t len);
 void Netchan_OutOfBandPrint(int32_t sock, const net_addr_t *addr, const char *format, ...) __attribute__((format(printf,
         3, 4)));
 _Bool Netchan_Process(net_chan_t *chan, mem_buf_t *msg);
+_Bool Netchan_Pending(const net_chan_t *chan);
+size_t Netchan_ReliableSpace(const net_chan_t *chan);
 void Netchan_Init(void);
 void Netchan_Shutdown(void);
@@ -324,11 +324,193 @@ void Net_WriteDeltaPlayerState(mem_buf_t *msg, const player_state_t *from, const
 }
 
 /**
- * @brief Writes an entity's state changes to a net message. Can delta from
- * either a baseline or a previous packet_entity
+ * @brief Entity origins and beam terminations are quantized to this fraction
+ * of a world unit, so that position deltas may be sent as small integers.
  */
-void Net_WriteDeltaEntity(mem_buf_t *msg, const entity_state_t *from, const entity_state_t *to,
-                          _Bool force) {
+#define NET_POSITION_SCALE 8.0
+
+/**
+ * @brief Entity angles are quantized to this many bits per component.
+ */
+#define NET_ANGLE_BITS 12
+
+/**
+ * @return The specified position component, quantized for transmission.
+ */
+static int32_t Net_QuantizePosition(const vec_t v) {
+	return (int32_t) floor(v * NET_POSITION_SCALE + 0.5);
+}
+
+/**
+ * @return The specified angle component, quantized for transmission.
+ */
+static uint32_t Net_QuantizeAngle(const vec_t a) {
+	return (uint32_t) (ClampAngle(a) * (1 << NET_ANGLE_BITS) / 360.0 + 0.5) & ((1 << NET_ANGLE_BITS) - 1);
+}
+
+/**
+ * @brief Prepares a bit stream for writing to or reading from the specified
+ * message. Entity numbers written to the stream are delta compressed against
+ * one another, and so must be written in ascending order.
+ */
+void Net_BeginBitStream(net_bit_stream_t *stream, mem_buf_t *msg) {
+
+	memset(stream, 0, sizeof(*stream));
+
+	stream->msg = msg;
+}
+
+/**
+ * @brief Appends the low `num_bits` bits of `value` to the stream. Whole bytes
+ * are written to the message as they are filled.
+ */
+void Net_WriteBits(net_bit_stream_t *stream, const uint32_t value, const uint32_t num_bits) {
+
+	assert(num_bits <= 32);
+
+	if (num_bits == 0) {
+		return;
+	}
+
+	const uint64_t mask = (num_bits == 32) ? 0xffffffffull : ((1ull << num_bits) - 1);
+
+	stream->bits |= (value & mask) << stream->num_bits;
+	stream->num_bits += num_bits;
+
+	while (stream->num_bits >= 8) {
+		Net_WriteByte(stream->msg, (int32_t) (stream->bits & 0xff));
+		stream->bits >>= 8;
+		stream->num_bits -= 8;
+	}
+}
+
+/**
+ * @brief Writes an unsigned integer using the fewest of 4, 8, 16 or 32 bits,
+ * prefixed by a 2 bit selector. Small values cost as little as 6 bits.
+ */
+void Net_WriteBitsVar(net_bit_stream_t *stream, const uint32_t value) {
+
+	if (value < (1u << 4)) {
+		Net_WriteBits(stream, 0, 2);
+		Net_WriteBits(stream, value, 4);
+	} else if (value < (1u << 8)) {
+		Net_WriteBits(stream, 1, 2);
+		Net_WriteBits(stream, value, 8);
+	} else if (value < (1u << 16)) {
+		Net_WriteBits(stream, 2, 2);
+		Net_WriteBits(stream, value, 16);
+	} else {
+		Net_WriteBits(stream, 3, 2);
+		Net_WriteBits(stream, value, 32);
+	}
+}
+
+/**
+ * @brief Writes a signed integer, zig-zag encoded so that values near zero
+ * in either direction remain small.
+ */
+void Net_WriteBitsSigned(net_bit_stream_t *stream, const int32_t value) {
+	Net_WriteBitsVar(stream, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+}
+
+/**
+ * @brief Writes any partially filled byte to the message, padding the stream
+ * to a byte boundary so that byte-aligned writes may follow.
+ */
+void Net_FlushBits(net_bit_stream_t *stream) {
+
+	if (stream->num_bits) {
+		Net_WriteByte(stream->msg, (int32_t) (stream->bits & 0xff));
+	}
+
+	stream->bits = 0;
+	stream->num_bits = 0;
+}
+
+/**
+ * @brief Writes the quantized delta between two positions. A 3 bit mask
+ * indicates which components changed, followed by each changed component.
+ */
+static void Net_WriteDeltaPosition(net_bit_stream_t *stream, const vec3_t from, const vec3_t to) {
+	int32_t delta[3];
+	uint32_t mask = 0;
+
+	for (int32_t i = 0; i < 3; i++) {
+		delta[i] = Net_QuantizePosition(to[i]) - Net_QuantizePosition(from[i]);
+		if (delta[i]) {
+			mask |= (1 << i);
+		}
+	}
+
+	Net_WriteBits(stream, mask, 3);
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (mask & (1 << i)) {
+			Net_WriteBitsSigned(stream, delta[i]);
+		}
+	}
+}
+
+/**
+ * @brief Writes the quantized angles that differ between from and to. A 3 bit
+ * mask indicates which components changed, followed by each changed component.
+ */
+static void Net_WriteDeltaAngles(net_bit_stream_t *stream, const vec3_t from, const vec3_t to) {
+	uint32_t angles[3];
+	uint32_t mask = 0;
+
+	for (int32_t i = 0; i < 3; i++) {
+		angles[i] = Net_QuantizeAngle(to[i]);
+		if (angles[i] != Net_QuantizeAngle(from[i])) {
+			mask |= (1 << i);
+		}
+	}
+
+	Net_WriteBits(stream, mask, 3);
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (mask & (1 << i)) {
+			Net_WriteBits(stream, angles[i], NET_ANGLE_BITS);
+		}
+	}
+}
+
+/**
+ * @return True if the quantized positions differ.
+ */
+static _Bool Net_PositionChanged(const vec3_t from, const vec3_t to) {
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (Net_QuantizePosition(to[i]) != Net_QuantizePosition(from[i])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @return True if the quantized angles differ.
+ */
+static _Bool Net_AnglesChanged(const vec3_t from, const vec3_t to) {
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (Net_QuantizeAngle(to[i]) != Net_QuantizeAngle(from[i])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Writes an entity's state changes to a bit stream. The entity number is
+ * written as the difference from the last entity number written to the stream,
+ * and origins and angles are quantized. If age is not negative, the delta is
+ * from the receiver's state of that many frames ago, and is flagged U_KNOWN.
+ */
+static void Net_WriteDeltaEntity_(net_bit_stream_t *stream, const entity_state_t *from, const entity_state_t *to,
+                                  _Bool force, int32_t age) {
 
 	uint16_t bits = 0;
 
@@ -340,15 +522,19 @@ void Net_WriteDeltaEntity(mem_buf_t *msg, const entity_state_t *from, const enti
 		Com_Error(ERROR_FATAL, "Entity number >= MAX_ENTITIES\n");
 	}
 
-	if (!VectorCompare(to->origin, from->origin)) {
+	if (to->number <= stream->number) {
+		Com_Error(ERROR_FATAL, "Entity number %u out of order\n", to->number);
+	}
+
+	if (Net_PositionChanged(from->origin, to->origin)) {
 		bits |= U_ORIGIN;
 	}
 
-	if (!VectorCompare(from->termination, to->termination)) {
+	if (Net_PositionChanged(from->termination, to->termination)) {
 		bits |= U_TERMINATION;
 	}
 
-	if (!VectorCompare(to->angles, from->angles)) {
+	if (Net_AnglesChanged(from->angles, to->angles)) {
 		bits |= U_ANGLES;
 	}
 
@@ -393,62 +579,114 @@ void Net_WriteDeltaEntity(mem_buf_t *msg, const entity_state_t *from, const enti
 		return;    // nothing to send
 	}
 
+	if (age >= 0) {
+		bits |= U_KNOWN;
+	}
+
 	// write the message
 
-	Net_WriteShort(msg, to->number);
-	Net_WriteShort(msg, bits);
+	Net_WriteBitsVar(stream, to->number - stream->number);
+	Net_WriteBitsVar(stream, bits);
+
+	if (bits & U_KNOWN) {
+		Net_WriteBitsVar(stream, (uint32_t) age);
+	}
+
+	stream->number = to->number;
 
 	if (bits & U_ORIGIN) {
-		Net_WritePosition(msg, to->origin);
+		Net_WriteDeltaPosition(stream, from->origin, to->origin);
 	}
 
 	if (bits & U_TERMINATION) {
-		Net_WritePosition(msg, to->termination);
+		Net_WriteDeltaPosition(stream, from->termination, to->termination);
 	}
 
 	if (bits & U_ANGLES) {
-		Net_WriteAngles(msg, to->angles);
+		Net_WriteDeltaAngles(stream, from->angles, to->angles);
 	}
 
 	if (bits & U_ANIMATIONS) {
-		Net_WriteByte(msg, to->animation1);
-		Net_WriteByte(msg, to->animation2);
+		Net_WriteBits(stream, to->animation1, 8);
+		Net_WriteBits(stream, to->animation2, 8);
 	}
 
 	if (bits & U_EVENT) {
-		Net_WriteByte(msg, to->event);
+		Net_WriteBits(stream, to->event, 8);
 	}
 
 	if (bits & U_EFFECTS) {
-		Net_WriteShort(msg, to->effects);
+		Net_WriteBitsVar(stream, to->effects);
 	}
 
 	if (bits & U_TRAIL) {
-		Net_WriteByte(msg, to->trail);
+		Net_WriteBits(stream, to->trail, 8);
 	}
 
 	if (bits & U_MODELS) {
-		Net_WriteByte(msg, to->model1);
-		Net_WriteByte(msg, to->model2);
-		Net_WriteByte(msg, to->model3);
-		Net_WriteByte(msg, to->model4);
+		Net_WriteBits(stream, to->model1, 8);
+		Net_WriteBits(stream, to->model2, 8);
+		Net_WriteBits(stream, to->model3, 8);
+		Net_WriteBits(stream, to->model4, 8);
 	}
 
 	if (bits & U_CLIENT) {
-		Net_WriteByte(msg, to->client);
+		Net_WriteBits(stream, to->client, 8);
 	}
 
 	if (bits & U_SOUND) {
-		Net_WriteByte(msg, to->sound);
+		Net_WriteBits(stream, to->sound, 8);
 	}
 
 	if (bits & U_SOLID) {
-		Net_WriteByte(msg, to->solid);
+		Net_WriteBits(stream, to->solid, 8);
 	}
 
 	if (bits & U_BOUNDS) {
-		Net_WriteLong(msg, to->bounds);
+		Net_WriteBits(stream, to->bounds, 32);
+	}
+}
+
+/**
+ * @brief Writes an entity's state changes to a bit stream. Can delta from
+ * either a baseline or a previous packet_entity.
+ */
+void Net_WriteDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, const entity_state_t *to,
+                          _Bool force) {
+	Net_WriteDeltaEntity_(stream, from, to, force, -1);
+}
+
+/**
+ * @brief Writes an entity's state changes to a bit stream, from the state the
+ * receiver held for it `age` frames ago. The receiver must retain that state.
+ *
+ * @see ENTITY_STATE_HISTORY
+ */
+void Net_WriteKnownDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, const entity_state_t *to,
+                               uint32_t age) {
+	Net_WriteDeltaEntity_(stream, from, to, true, (int32_t) age);
+}
+
+/**
+ * @brief Writes the removal of the specified entity to the bit stream.
+ */
+void Net_WriteRemoveEntity(net_bit_stream_t *stream, uint16_t number) {
+
+	if (number <= stream->number) {
+		Com_Error(ERROR_FATAL, "Entity number %u out of order\n", number);
 	}
+
+	Net_WriteBitsVar(stream, number - stream->number);
+	Net_WriteBitsVar(stream, U_REMOVE);
+
+	stream->number = number;
+}
+
+/**
+ * @brief Terminates a sequence of entities written to the bit stream.
+ */
+void Net_WriteEndOfEntities(net_bit_stream_t *stream) {
+	Net_WriteBitsVar(stream, 0);
 }
 
 /**
@@ -733,9 +971,123 @@ void Net_ReadDeltaPlayerState(mem_buf_t *msg, const player_state_t *from, player
 }
 
 /**
- * @brief
+ * @brief Reads `num_bits` bits from the stream, consuming bytes from the
+ * message as they are needed.
+ */
+uint32_t Net_ReadBits(net_bit_stream_t *stream, const uint32_t num_bits) {
+
+	assert(num_bits <= 32);
+
+	if (num_bits == 0) {
+		return 0;
+	}
+
+	while (stream->num_bits < num_bits) {
+		stream->bits |= ((uint64_t) (Net_ReadByte(stream->msg) & 0xff)) << stream->num_bits;
+		stream->num_bits += 8;
+	}
+
+	const uint64_t mask = (num_bits == 32) ? 0xffffffffull : ((1ull << num_bits) - 1);
+	const uint32_t value = (uint32_t) (stream->bits & mask);
+
+	stream->bits >>= num_bits;
+	stream->num_bits -= num_bits;
+
+	return value;
+}
+
+/**
+ * @brief Reads an unsigned integer written with Net_WriteBitsVar.
+ */
+uint32_t Net_ReadBitsVar(net_bit_stream_t *stream) {
+	static const uint32_t widths[] = { 4, 8, 16, 32 };
+
+	return Net_ReadBits(stream, widths[Net_ReadBits(stream, 2)]);
+}
+
+/**
+ * @brief Reads a signed integer written with Net_WriteBitsSigned.
+ */
+int32_t Net_ReadBitsSigned(net_bit_stream_t *stream) {
+
+	const uint32_t value = Net_ReadBitsVar(stream);
+
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+/**
+ * @brief Reads the quantized delta of a position written with Net_WriteDeltaPosition.
+ */
+static void Net_ReadDeltaPosition(net_bit_stream_t *stream, vec3_t pos) {
+
+	const uint32_t mask = Net_ReadBits(stream, 3);
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (mask & (1 << i)) {
+			const int32_t delta = Net_ReadBitsSigned(stream);
+			pos[i] = (Net_QuantizePosition(pos[i]) + delta) / NET_POSITION_SCALE;
+		}
+	}
+}
+
+/**
+ * @brief Reads the quantized angles written with Net_WriteDeltaAngles.
+ */
+static void Net_ReadDeltaAngles(net_bit_stream_t *stream, vec3_t angles) {
+
+	const uint32_t mask = Net_ReadBits(stream, 3);
+
+	for (int32_t i = 0; i < 3; i++) {
+		if (mask & (1 << i)) {
+			const uint32_t a = Net_ReadBits(stream, NET_ANGLE_BITS);
+			angles[i] = UnclampAngle(a * 360.0 / (1 << NET_ANGLE_BITS));
+		}
+	}
+}
+
+/**
+ * @brief Reads the number of the next entity in the bit stream.
+ *
+ * @return The entity number, or 0 at the end of the entities.
+ */
+uint16_t Net_ReadEntityNumber(net_bit_stream_t *stream) {
+
+	const uint32_t delta = Net_ReadBitsVar(stream);
+	if (delta == 0) {
+		return 0;
+	}
+
+	const uint32_t number = stream->number + delta;
+	if (number >= MAX_ENTITIES) {
+		Com_Error(ERROR_DROP, "Bad number: %u\n", number);
+	}
+
+	stream->number = (uint16_t) number;
+	return stream->number;
+}
+
+/**
+ * @brief Reads the delta compression flags of the entity most recently read
+ * with Net_ReadEntityNumber.
+ */
+uint16_t Net_ReadEntityBits(net_bit_stream_t *stream) {
+	return (uint16_t) Net_ReadBitsVar(stream);
+}
+
+/**
+ * @brief Reads the age, in frames, of the known state from which the entity
+ * most recently read with Net_ReadEntityBits is delta compressed.
+ *
+ * @remarks This must only be called if U_KNOWN is set in the entity's bits.
+ */
+uint32_t Net_ReadEntityAge(net_bit_stream_t *stream) {
+	return Net_ReadBitsVar(stream);
+}
+
+/**
+ * @brief Reads an entity's state changes from a bit stream.
  */
-void Net_ReadDeltaEntity(mem_buf_t *msg, const entity_state_t *from, entity_state_t *to,
+void Net_ReadDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, entity_state_t *to,
                          uint16_t number, uint16_t bits) {
 
 	*to = *from;
@@ -743,56 +1095,56 @@ void Net_ReadDeltaEntity(mem_buf_t *msg, const entity_state_t *from, entity_stat
 	to->number = number;
 
 	if (bits & U_ORIGIN) {
-		Net_ReadPosition(msg, to->origin);
+		Net_ReadDeltaPosition(stream, to->origin);
 	}
 
 	if (bits & U_TERMINATION) {
-		Net_ReadPosition(msg, to->termination);
+		Net_ReadDeltaPosition(stream, to->termination);
 	}
 
 	if (bits & U_ANGLES) {
-		Net_ReadAngles(msg, to->angles);
+		Net_ReadDeltaAngles(stream, to->angles);
 	}
 
 	if (bits & U_ANIMATIONS) {
-		to->animation1 = Net_ReadByte(msg);
-		to->animation2 = Net_ReadByte(msg);
+		to->animation1 = Net_ReadBits(stream, 8);
+		to->animation2 = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_EVENT) {
-		to->event = Net_ReadByte(msg);
+		to->event = Net_ReadBits(stream, 8);
 	} else {
 		to->event = 0;
 	}
 
 	if (bits & U_EFFECTS) {
-		to->effects = Net_ReadShort(msg);
+		to->effects = Net_ReadBitsVar(stream);
 	}
 
 	if (bits & U_TRAIL) {
-		to->trail = Net_ReadByte(msg);
+		to->trail = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_MODELS) {
-		to->model1 = Net_ReadByte(msg);
-		to->model2 = Net_ReadByte(msg);
-		to->model3 = Net_ReadByte(msg);
-		to->model4 = Net_ReadByte(msg);
+		to->model1 = Net_ReadBits(stream, 8);
+		to->model2 = Net_ReadBits(stream, 8);
+		to->model3 = Net_ReadBits(stream, 8);
+		to->model4 = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_CLIENT) {
-		to->client = Net_ReadByte(msg);
+		to->client = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_SOUND) {
-		to->sound = Net_ReadByte(msg);
+		to->sound = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_SOLID) {
-		to->solid = Net_ReadByte(msg);
+		to->solid = Net_ReadBits(stream, 8);
 	}
 
 	if (bits & U_BOUNDS) {
-		to->bounds = Net_ReadLong(msg);
+		to->bounds = Net_ReadBits(stream, 32);
 	}
 }
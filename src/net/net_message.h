@@ -66,6 +66,7 @@
 #define U_SOLID					(1 << 10) // solid type
 #define U_BOUNDS				(1 << 11) // encoded bounding box
 #define U_REMOVE				(1 << 12) // remove this entity, don't add it
+#define U_KNOWN					(1 << 13) // delta from a recent state, rather than the baseline
 
 /**
  * @brief These flags indicate which fields a given sound packet will contain. Maximum 8 flags.
@@ -75,6 +76,19 @@
 #define S_ENTITY				(1 << 2)
 #define S_PITCH					(1 << 3)
 
+/**
+ * @brief A bit-level cursor over a message buffer. Entity deltas are packed
+ * into bit streams rather than byte-aligned fields. Pending bits are written
+ * to the message a byte at a time, and must be flushed with Net_FlushBits
+ * before any byte-aligned writes may follow.
+ */
+typedef struct {
+	mem_buf_t *msg;
+	uint64_t bits; // pending bits, least significant first
+	uint32_t num_bits;
+	uint16_t number; // the last entity number written or read
+} net_bit_stream_t;
+
 /**
  * @brief Message writing and reading facilities.
  */
@@ -91,7 +105,17 @@ void Net_WriteAngles(mem_buf_t *msg, const vec3_t angles);
 void Net_WriteDir(mem_buf_t *msg, const vec3_t dir);
 void Net_WriteDeltaMoveCmd(mem_buf_t *msg, const pm_cmd_t *from, const pm_cmd_t *to);
 void Net_WriteDeltaPlayerState(mem_buf_t *msg, const player_state_t *from, const player_state_t *to);
-void Net_WriteDeltaEntity(mem_buf_t *msg, const entity_state_t *from, const entity_state_t *to, _Bool force);
+
+void Net_BeginBitStream(net_bit_stream_t *stream, mem_buf_t *msg);
+void Net_WriteBits(net_bit_stream_t *stream, const uint32_t value, const uint32_t num_bits);
+void Net_WriteBitsVar(net_bit_stream_t *stream, const uint32_t value);
+void Net_WriteBitsSigned(net_bit_stream_t *stream, const int32_t value);
+void Net_FlushBits(net_bit_stream_t *stream);
+void Net_WriteDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, const entity_state_t *to, _Bool force);
+void Net_WriteKnownDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, const entity_state_t *to,
+                               uint32_t age);
+void Net_WriteRemoveEntity(net_bit_stream_t *stream, uint16_t number);
+void Net_WriteEndOfEntities(net_bit_stream_t *stream);
 
 void Net_BeginReading(mem_buf_t *msg);
 void Net_ReadData(mem_buf_t *msg, void *data, size_t len);
@@ -108,5 +132,12 @@ void Net_ReadAngles(mem_buf_t *msg, vec3_t angles);
 void Net_ReadDir(mem_buf_t *msg, vec3_t vector);
 void Net_ReadDeltaMoveCmd(mem_buf_t *msg, const pm_cmd_t *from, pm_cmd_t *to);
 void Net_ReadDeltaPlayerState(mem_buf_t *msg, const player_state_t *from, player_state_t *to);
-void Net_ReadDeltaEntity(mem_buf_t *msg, const entity_state_t *from, entity_state_t *to,
+
+uint32_t Net_ReadBits(net_bit_stream_t *stream, const uint32_t num_bits);
+uint32_t Net_ReadBitsVar(net_bit_stream_t *stream);
+int32_t Net_ReadBitsSigned(net_bit_stream_t *stream);
+uint16_t Net_ReadEntityNumber(net_bit_stream_t *stream);
+uint16_t Net_ReadEntityBits(net_bit_stream_t *stream);
+uint32_t Net_ReadEntityAge(net_bit_stream_t *stream);
+void Net_ReadDeltaEntity(net_bit_stream_t *stream, const entity_state_t *from, entity_state_t *to,
                          uint16_t number, uint16_t bits);
@@ -0,0 +1,550 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "cmd.h"
+#include "cvar.h"
+#include "filesystem.h"
+#include "net_sim.h"
+
+/*
+ * The network simulator impairs the datagrams sent and received on a socket,
+ * so that netchan, delta compression and prediction changes can be evaluated
+ * against reproducible network conditions on a single host.
+ *
+ * Datagrams passing through an impaired socket are queued in each direction,
+ * and released once due. Loss follows a two-state (Gilbert-Elliott) model, so
+ * that losses may arrive in bursts. Latency and jitter are applied per
+ * direction, and a bandwidth cap serializes datagrams onto a virtual link with
+ * a one second buffer, beyond which they are dropped. Reordered datagrams are
+ * held back, and may be overtaken by those sent after them.
+ *
+ * Sessions may be captured to, and replayed from, pcap files. Captures record
+ * datagrams as seen by the application, so inbound datagrams are recorded after
+ * impairment. Each is wrapped in IPv4 and UDP headers for the benefit of other
+ * tools, with the local endpoint recorded as 0.0.0.0:0. Replaying a capture
+ * delivers its inbound datagrams with their original timing, in place of those
+ * arriving on the socket, and discards outbound datagrams.
+ */
+
+/**
+ * @brief The pcap magic number, with microsecond timestamps.
+ */
+#define NET_PCAP_MAGIC 0xa1b2c3d4
+
+/**
+ * @brief Captured datagrams begin with a raw IPv4 header.
+ */
+#define NET_PCAP_LINKTYPE_RAW 101
+
+/**
+ * @brief The size of the IPv4 and UDP headers preceding each captured datagram.
+ */
+#define NET_PCAP_HEADERS (20 + 8)
+
+/**
+ * @brief Datagrams queued for release by the simulator.
+ */
+typedef struct {
+	net_addr_t addr;
+	double due; // the time at which the datagram is released
+	size_t size;
+	byte data[];
+} net_sim_datagram_t;
+
+/**
+ * @brief The impairment state for one direction of a socket.
+ */
+typedef struct {
+	GQueue datagrams; // sorted by due time
+	double last_due; // datagrams are released in order, unless reordered
+	double link_time; // the time at which the virtual link is next idle
+	_Bool burst; // the loss model is in its lossy state
+	uint32_t seed; // the random number generator state
+} net_sim_queue_t;
+
+/**
+ * @brief A capture being replayed.
+ */
+typedef struct {
+	byte *buffer;
+	int64_t size;
+	int64_t offset; // the next record
+	uint32_t start; // the local time at which the replay began
+	uint32_t first; // the timestamp of the first record, in milliseconds
+	uint32_t count;
+} net_sim_replay_t;
+
+static struct {
+	net_sim_queue_t queues[NS_UDP_SERVER + 1][NET_SIM_OUT + 1];
+	file_t *captures[NS_UDP_SERVER + 1];
+	net_sim_replay_t replays[NS_UDP_SERVER + 1];
+} net_sim;
+
+static cvar_t *net_sim_sources;
+static cvar_t *net_sim_latency;
+static cvar_t *net_sim_jitter;
+static cvar_t *net_sim_loss;
+static cvar_t *net_sim_burst;
+static cvar_t *net_sim_reorder;
+static cvar_t *net_sim_bandwidth;
+static cvar_t *net_sim_seed;
+
+/**
+ * @return A pseudo-random number in [0, 1), from the given state. Each queue
+ * has its own state, so that impairment is reproducible for a given seed.
+ */
+static double Net_SimRandom(uint32_t *seed) {
+
+	uint32_t x = *seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	*seed = x;
+
+	return x / 4294967296.0;
+}
+
+/**
+ * @brief Resets the impairment queues, releasing any held datagrams.
+ */
+static void Net_SimReset(void) {
+
+	for (size_t i = 0; i < lengthof(net_sim.queues); i++) {
+		for (size_t j = 0; j < lengthof(net_sim.queues[i]); j++) {
+			net_sim_queue_t *q = &net_sim.queues[i][j];
+
+			net_sim_datagram_t *datagram;
+			while ((datagram = g_queue_pop_head(&q->datagrams))) {
+				Mem_Free(datagram);
+			}
+
+			q->last_due = q->link_time = 0.0;
+			q->burst = false;
+			q->seed = (uint32_t) net_sim_seed->integer * 2654435761u + (uint32_t) (i * 2 + j) * 40503u + 1;
+		}
+	}
+}
+
+/**
+ * @return True if the simulator impairs datagrams on the given source.
+ */
+_Bool Net_SimActive(net_src_t source) {
+
+	if (net_sim_sources == NULL) {
+		return false;
+	}
+
+	if (net_sim_sources->modified || net_sim_seed->modified) {
+		net_sim_sources->modified = net_sim_seed->modified = false;
+		Net_SimReset();
+	}
+
+	return (net_sim_sources->integer & (1 << source)) != 0;
+}
+
+/**
+ * @brief GCompareDataFunc for sorting datagrams by due time. Datagrams due at
+ * the same time are kept in the order in which they were queued.
+ */
+static gint Net_SimCompare(gconstpointer a, gconstpointer b, gpointer data) {
+
+	const double da = ((const net_sim_datagram_t *) a)->due;
+	const double db = ((const net_sim_datagram_t *) b)->due;
+
+	return da <= db ? -1 : 1;
+}
+
+/**
+ * @brief Subjects a datagram to the simulated network conditions, queueing it
+ * for release if it survives.
+ */
+void Net_SimEnqueue(net_src_t source, net_sim_direction_t dir, const net_addr_t *addr, const void *data, size_t len) {
+
+	net_sim_queue_t *q = &net_sim.queues[source][dir];
+	const double now = quetoo.ticks;
+
+	// loss, in bursts with a mean length of net_sim_burst: the datagram which begins a
+	// burst is lost, and each one after it is lost until the burst ends
+	if (q->burst) {
+		if (Net_SimRandom(&q->seed) * Max(net_sim_burst->value, 1.0) >= 1.0) {
+			return;
+		}
+		q->burst = false;
+	} else if (Net_SimRandom(&q->seed) < net_sim_loss->value) {
+		q->burst = net_sim_burst->value > 1.0;
+		return;
+	}
+
+	// latency and jitter, with half of each applied in each direction
+	double due = now + 0.5 * (net_sim_latency->value + net_sim_jitter->value * Net_SimRandom(&q->seed));
+
+	if (Net_SimRandom(&q->seed) < net_sim_reorder->value) {
+		due += 0.5 * net_sim_latency->value + net_sim_jitter->value + 1.0;
+	} else {
+		due = Max(due, q->last_due);
+		q->last_due = due;
+	}
+
+	// serialization onto a link of limited bandwidth, with a one second buffer
+	if (net_sim_bandwidth->value > 0.0) {
+		const double start = Max(now, q->link_time);
+		if (start - now > 1000.0) {
+			return;
+		}
+
+		q->link_time = start + len * 1000.0 / net_sim_bandwidth->value;
+		due = Max(due, q->link_time);
+	}
+
+	net_sim_datagram_t *datagram = Mem_Malloc(sizeof(*datagram) + len);
+
+	datagram->addr = *addr;
+	datagram->due = due;
+	datagram->size = len;
+
+	memcpy(datagram->data, data, len);
+
+	g_queue_insert_sorted(&q->datagrams, datagram, Net_SimCompare, NULL);
+}
+
+/**
+ * @brief Releases the next due datagram in the given direction, if any.
+ * @return True if a datagram was released, false otherwise.
+ */
+_Bool Net_SimDequeue(net_src_t source, net_sim_direction_t dir, net_addr_t *addr, mem_buf_t *buf) {
+
+	net_sim_queue_t *q = &net_sim.queues[source][dir];
+
+	const net_sim_datagram_t *datagram = g_queue_peek_head(&q->datagrams);
+	if (datagram == NULL || datagram->due > quetoo.ticks) {
+		return false;
+	}
+
+	g_queue_pop_head(&q->datagrams);
+
+	*addr = datagram->addr;
+
+	Mem_ClearBuffer(buf);
+	Mem_WriteBuffer(buf, datagram->data, datagram->size);
+
+	Mem_Free((void *) datagram);
+	return true;
+}
+
+/**
+ * @brief Writes a 32 bit value to a capture, in host byte order, as pcap expects.
+ */
+static void Net_SimWrite32(file_t *file, uint32_t value) {
+	Fs_Write(file, &value, sizeof(value), 1);
+}
+
+/**
+ * @brief Records a datagram to the capture for the given source, if any.
+ */
+void Net_SimCapture(net_src_t source, net_sim_direction_t dir, const net_addr_t *addr, const void *data, size_t len) {
+
+	file_t *file = net_sim.captures[source];
+	if (file == NULL) {
+		return;
+	}
+
+	const uint32_t size = (uint32_t) (NET_PCAP_HEADERS + len);
+
+	Net_SimWrite32(file, quetoo.ticks / 1000);
+	Net_SimWrite32(file, (quetoo.ticks % 1000) * 1000);
+	Net_SimWrite32(file, size);
+	Net_SimWrite32(file, size);
+
+	const in_addr_t remote = addr->type == NA_LOOP ? net_lo : addr->addr;
+
+	const in_addr_t src = dir == NET_SIM_IN ? remote : 0;
+	const in_addr_t dst = dir == NET_SIM_IN ? 0 : remote;
+	const in_port_t src_port = dir == NET_SIM_IN ? addr->port : 0;
+	const in_port_t dst_port = dir == NET_SIM_IN ? 0 : addr->port;
+
+	byte header[NET_PCAP_HEADERS] = {
+		0x45, 0x00, (byte) (size >> 8), (byte) size, // version, length
+		0x00, 0x00, 0x00, 0x00, // identification, fragmentation
+		0x40, 0x11, 0x00, 0x00 // time to live, UDP, checksum
+	};
+
+	memcpy(header + 12, &src, 4);
+	memcpy(header + 16, &dst, 4);
+
+	uint32_t checksum = 0;
+	for (size_t i = 0; i < 20; i += 2) {
+		checksum += (header[i] << 8) | header[i + 1];
+	}
+	while (checksum >> 16) {
+		checksum = (checksum & 0xffff) + (checksum >> 16);
+	}
+	checksum = ~checksum & 0xffff;
+
+	header[10] = (byte) (checksum >> 8);
+	header[11] = (byte) checksum;
+
+	const uint16_t udp_len = (uint16_t) (8 + len);
+
+	memcpy(header + 20, &src_port, 2);
+	memcpy(header + 22, &dst_port, 2);
+	header[24] = (byte) (udp_len >> 8);
+	header[25] = (byte) udp_len;
+
+	Fs_Write(file, header, sizeof(header), 1);
+	Fs_Write(file, data, len, 1);
+}
+
+/**
+ * @return True if a capture is being replayed on the given source.
+ */
+_Bool Net_SimReplaying(net_src_t source) {
+	return net_sim.replays[source].buffer != NULL;
+}
+
+/**
+ * @brief Stops the replay on the given source.
+ */
+static void Net_SimStopReplay(net_src_t source) {
+
+	net_sim_replay_t *replay = &net_sim.replays[source];
+
+	if (replay->buffer) {
+		Com_Print("Replayed %u datagrams\n", replay->count);
+
+		Fs_Free(replay->buffer);
+		memset(replay, 0, sizeof(*replay));
+	}
+}
+
+/**
+ * @brief Delivers the next inbound datagram of the capture being replayed on
+ * the given source, once its time has come.
+ * @return True if a datagram was delivered, false otherwise.
+ */
+_Bool Net_SimReplay(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
+
+	net_sim_replay_t *replay = &net_sim.replays[source];
+
+	while (replay->offset + 16 <= replay->size) {
+		const byte *record = replay->buffer + replay->offset;
+
+		uint32_t sec, usec, size;
+		memcpy(&sec, record, 4);
+		memcpy(&usec, record + 4, 4);
+		memcpy(&size, record + 8, 4);
+
+		if (replay->offset + 16 + size > replay->size || size < NET_PCAP_HEADERS) {
+			break;
+		}
+
+		const uint32_t time = sec * 1000 + usec / 1000;
+		if (replay->count == 0 && replay->offset == 24) {
+			replay->first = time;
+		}
+
+		if (time - replay->first > quetoo.ticks - replay->start) {
+			return false;
+		}
+
+		replay->offset += 16 + size;
+
+		const byte *ip = record + 16;
+
+		in_addr_t dst;
+		memcpy(&dst, ip + 16, 4);
+
+		if (dst != 0) { // outbound
+			continue;
+		}
+
+		const size_t len = size - NET_PCAP_HEADERS;
+		if (len >= buf->max_size) {
+			continue;
+		}
+
+		memset(from, 0, sizeof(*from));
+		from->type = NA_DATAGRAM;
+
+		memcpy(&from->addr, ip + 12, 4);
+		memcpy(&from->port, ip + 20, 2);
+
+		Mem_ClearBuffer(buf);
+		Mem_WriteBuffer(buf, ip + NET_PCAP_HEADERS, len);
+
+		replay->count++;
+		return true;
+	}
+
+	Net_SimStopReplay(source);
+	return false;
+}
+
+/**
+ * @return The net source named by the first argument of the current command.
+ */
+static _Bool Net_SimSource(net_src_t *source) {
+
+	if (!g_strcmp0(Cmd_Argv(1), "client")) {
+		*source = NS_UDP_CLIENT;
+	} else if (!g_strcmp0(Cmd_Argv(1), "server")) {
+		*source = NS_UDP_SERVER;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Starts or stops capturing datagrams on a source.
+ */
+static void Net_Capture_f(void) {
+	net_src_t source;
+
+	if (!Net_SimSource(&source)) {
+		Com_Print("Usage: %s <client|server> [file.pcap]\n", Cmd_Argv(0));
+		return;
+	}
+
+	if (net_sim.captures[source]) {
+		Fs_Close(net_sim.captures[source]);
+		net_sim.captures[source] = NULL;
+
+		Com_Print("Capture stopped\n");
+	}
+
+	if (Cmd_Argc() < 3) {
+		return;
+	}
+
+	file_t *file = Fs_OpenWrite(Cmd_Argv(2));
+	if (file == NULL) {
+		Com_Warn("Failed to open %s: %s\n", Cmd_Argv(2), Fs_LastError());
+		return;
+	}
+
+	Net_SimWrite32(file, NET_PCAP_MAGIC);
+	Net_SimWrite32(file, 2 | (4 << 16)); // version 2.4
+	Net_SimWrite32(file, 0); // time zone
+	Net_SimWrite32(file, 0); // timestamp accuracy
+	Net_SimWrite32(file, 0xffff); // snapshot length
+	Net_SimWrite32(file, NET_PCAP_LINKTYPE_RAW);
+
+	net_sim.captures[source] = file;
+
+	Com_Print("Capturing to %s\n", Cmd_Argv(2));
+}
+
+/**
+ * @brief Starts or stops replaying a capture on a source.
+ */
+static void Net_Replay_f(void) {
+	net_src_t source;
+
+	if (!Net_SimSource(&source)) {
+		Com_Print("Usage: %s <client|server> [file.pcap]\n", Cmd_Argv(0));
+		return;
+	}
+
+	Net_SimStopReplay(source);
+
+	if (Cmd_Argc() < 3) {
+		return;
+	}
+
+	net_sim_replay_t *replay = &net_sim.replays[source];
+
+	replay->size = Fs_Load(Cmd_Argv(2), (void **) &replay->buffer);
+	if (replay->size < 24) {
+		Com_Warn("Failed to load %s\n", Cmd_Argv(2));
+		if (replay->buffer) {
+			Fs_Free(replay->buffer);
+		}
+		memset(replay, 0, sizeof(*replay));
+		return;
+	}
+
+	uint32_t magic, linktype;
+	memcpy(&magic, replay->buffer, 4);
+	memcpy(&linktype, replay->buffer + 20, 4);
+
+	if (magic != NET_PCAP_MAGIC || linktype != NET_PCAP_LINKTYPE_RAW) {
+		Com_Warn("%s is not a raw IPv4 capture\n", Cmd_Argv(2));
+		Fs_Free(replay->buffer);
+		memset(replay, 0, sizeof(*replay));
+		return;
+	}
+
+	replay->offset = 24;
+	replay->start = quetoo.ticks;
+
+	Com_Print("Replaying %s\n", Cmd_Argv(2));
+}
+
+/**
+ * @brief
+ */
+void Net_InitSim(void) {
+
+	net_sim_sources = Cvar_Add("net_sim", "0", CVAR_DEVELOPER,
+			"Impair datagrams on real sockets: 1 for the client, 2 for the server, 3 for both (developer tool)");
+	net_sim_latency = Cvar_Add("net_sim_latency", "0", CVAR_DEVELOPER,
+			"Simulated round trip latency, in milliseconds (developer tool)");
+	net_sim_jitter = Cvar_Add("net_sim_jitter", "0", CVAR_DEVELOPER,
+			"Simulated round trip jitter, in milliseconds (developer tool)");
+	net_sim_loss = Cvar_Add("net_sim_loss", "0.0", CVAR_DEVELOPER,
+			"Simulated probability that a loss burst begins, per datagram (developer tool)");
+	net_sim_burst = Cvar_Add("net_sim_burst", "1", CVAR_DEVELOPER,
+			"Simulated mean loss burst length, in datagrams (developer tool)");
+	net_sim_reorder = Cvar_Add("net_sim_reorder", "0.0", CVAR_DEVELOPER,
+			"Simulated probability that a datagram is reordered (developer tool)");
+	net_sim_bandwidth = Cvar_Add("net_sim_bandwidth", "0", CVAR_DEVELOPER,
+			"Simulated bandwidth, in bytes per second, per direction (developer tool)");
+	net_sim_seed = Cvar_Add("net_sim_seed", "1", CVAR_DEVELOPER,
+			"Seed for reproducible simulated network conditions (developer tool)");
+
+	Cmd_Add("net_capture", Net_Capture_f, CMD_SYSTEM, "Capture datagrams to a pcap file");
+	Cmd_Add("net_replay", Net_Replay_f, CMD_SYSTEM, "Replay the inbound datagrams of a pcap file");
+
+	Net_SimReset();
+}
+
+/**
+ * @brief
+ */
+void Net_ShutdownSim(void) {
+
+	for (size_t i = 0; i < lengthof(net_sim.captures); i++) {
+		if (net_sim.captures[i]) {
+			Fs_Close(net_sim.captures[i]);
+			net_sim.captures[i] = NULL;
+		}
+
+		Net_SimStopReplay((net_src_t) i);
+	}
+
+	Net_SimReset();
+
+	Cmd_Remove("net_capture");
+	Cmd_Remove("net_replay");
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include "net.h"
+
+/**
+ * @brief The direction of a datagram, relative to the local host.
+ */
+typedef enum {
+	NET_SIM_IN,
+	NET_SIM_OUT
+} net_sim_direction_t;
+
+_Bool Net_SimActive(net_src_t source);
+void Net_SimEnqueue(net_src_t source, net_sim_direction_t dir, const net_addr_t *addr, const void *data, size_t len);
+_Bool Net_SimDequeue(net_src_t source, net_sim_direction_t dir, net_addr_t *addr, mem_buf_t *buf);
+void Net_SimCapture(net_src_t source, net_sim_direction_t dir, const net_addr_t *addr, const void *data, size_t len);
+_Bool Net_SimReplaying(net_src_t source);
+_Bool Net_SimReplay(net_src_t source, net_addr_t *from, mem_buf_t *buf);
+void Net_InitSim(void);
+void Net_ShutdownSim(void);
@@ -72,6 +72,41 @@ typedef enum {
 	NS_UDP_SERVER
 } net_src_t;
 
+/**
+ * @brief Reliable messages are split into fragments of up to this many bytes.
+ */
+#define NET_FRAGMENT_SIZE 1024
+
+/**
+ * @brief The number of reliable fragments that may be in flight at once. This
+ * must be a power of two, and large enough to hold a full reliable message.
+ */
+#define NET_WINDOW_SIZE 32
+
+/**
+ * @brief The maximum number of reliable fragments sent in a single packet.
+ */
+#define NET_PACKET_FRAGMENTS 8
+
+/**
+ * @brief Flags the final fragment of a reliable message, in its size field.
+ */
+#define NET_FRAGMENT_LAST 0x8000
+
+/**
+ * @brief A fragment of a reliable message, in either the send or the receive
+ * window of a channel.
+ */
+typedef struct {
+	uint32_t sequence; // the reliable sequence number of this fragment
+	uint16_t size;
+	_Bool last; // the final fragment of its message
+	_Bool acknowledged; // sent fragments only, the remote side has received it
+	_Bool received; // received fragments only, it awaits delivery
+	uint32_t sent_sequence; // the packet that last carried it, or 0 to (re)send it
+	byte data[NET_FRAGMENT_SIZE];
+} net_fragment_t;
+
 /**
  * @brief The network channel provides a conduit for packet sequencing and
  * optional reliable message delivery. The client and server speak explicitly
@@ -94,16 +129,24 @@ typedef struct {
 	uint32_t incoming_acknowledged;
 	uint32_t outgoing_sequence;
 
-	uint32_t reliable_sequence; // single bit
-	uint32_t reliable_acknowledged; // single bit
-	uint32_t reliable_incoming; // single bit
-	uint32_t reliable_outgoing; // outgoing sequence number of last reliable
+	// reliable fragment sequencing
+	uint32_t reliable_outgoing; // the next fragment to be queued
+	uint32_t reliable_acknowledged; // the oldest fragment not yet acknowledged
+	uint32_t reliable_incoming; // the next fragment to be delivered
+	_Bool reliable_ack_pending; // fragments have arrived since we last sent a packet
 
-	// reliable staging and holding areas
+	// reliable staging area
 	mem_buf_t message; // writing buffer to send to server
 	byte message_buffer[MAX_MSG_SIZE - 10]; // leave space for header
 
-	// message is copied to this buffer when it is first transfered
-	size_t reliable_size;
-	byte reliable_buffer[MAX_MSG_SIZE - 10]; // un-acked reliable message
+	// message is fragmented into the send window when there is room for it
+	net_fragment_t reliable_out[NET_WINDOW_SIZE];
+	net_fragment_t reliable_in[NET_WINDOW_SIZE];
+
+	_Bool compress; // payloads may be deflated, as negotiated at connect
+
+	// compression statistics for outgoing payloads
+	uint32_t compress_packets;
+	uint64_t compress_bytes_in, compress_bytes_out;
+	uint64_t compress_time; // performance counter ticks spent deflating
 } net_chan_t;
@@ -22,13 +22,42 @@
 #if defined(_WIN32)
 	#include <winsock2.h>
 	#include <ws2tcpip.h>
-#elif !defined(_MSC_VER)
-	#include <sys/time.h>
+
+	#include <SDL2/SDL_timer.h>
 #endif
 
 #include "cvar.h"
+#include "net_sim.h"
 #include "net_udp.h"
 
+#if !defined(_WIN32) && !defined(_MSC_VER)
+	#include <sys/socket.h>
+	#include <sys/time.h>
+#endif
+
+#if !defined(_WIN32)
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <time.h>
+	#include <unistd.h>
+
+	#include <SDL2/SDL_atomic.h>
+	#include <SDL2/SDL_thread.h>
+
+	#define NET_UDP_THREAD 1
+#endif
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+	#define NET_UDP_BATCH 1
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+	#include <sys/epoll.h>
+	#include <sys/timerfd.h>
+
+	#define NET_UDP_EPOLL 1
+#endif
+
 #define MAX_NET_UDP_LOOPS 64
 
 typedef struct {
@@ -42,9 +71,122 @@ typedef struct {
 	int32_t send, recv;
 } net_udp_loop_t;
 
+#if defined(NET_UDP_BATCH)
+
+/**
+ * @brief The number of datagrams received or sent per system call.
+ */
+#define MAX_NET_UDP_BATCH 32
+
+/**
+ * @brief The size of the arena in which outgoing datagrams are queued.
+ */
+#define NET_UDP_SEND_ARENA (MAX_MSG_SIZE * 4)
+
+/**
+ * @brief Datagrams drained from the socket with a single recvmmsg, and
+ * delivered one at a time by Net_ReceiveDatagram.
+ */
+typedef struct {
+	mem_buf_t buffers[MAX_NET_UDP_BATCH];
+	net_sockaddr addrs[MAX_NET_UDP_BATCH];
+	struct iovec iovecs[MAX_NET_UDP_BATCH];
+	struct mmsghdr headers[MAX_NET_UDP_BATCH];
+	int32_t count, index;
+	byte data[MAX_NET_UDP_BATCH][MAX_MSG_SIZE];
+} net_udp_recv_batch_t;
+
+/**
+ * @brief Datagrams queued by Net_SendDatagram between Net_BeginBatch and
+ * Net_EndBatch, and flushed with a single sendmmsg.
+ */
+typedef struct {
+	_Bool active;
+	net_sockaddr addrs[MAX_NET_UDP_BATCH];
+	struct iovec iovecs[MAX_NET_UDP_BATCH];
+	struct mmsghdr headers[MAX_NET_UDP_BATCH];
+	int32_t count;
+	size_t size;
+	byte data[NET_UDP_SEND_ARENA];
+} net_udp_send_batch_t;
+
+#endif
+
+#if defined(NET_UDP_THREAD)
+
+/**
+ * @brief The size, in bytes, of each of the network thread's queues.
+ */
+#define NET_UDP_RING_SIZE (1 << 20)
+
+/**
+ * @brief Queued datagrams are aligned to this many bytes.
+ */
+#define NET_UDP_RING_ALIGN 32
+
+/**
+ * @brief The space a queued datagram of the given size occupies in a ring.
+ */
+#define NET_UDP_RING_RECORD(size) \
+	((uint32_t) ((sizeof(net_udp_datagram_t) + (size) + NET_UDP_RING_ALIGN - 1) & ~(NET_UDP_RING_ALIGN - 1)))
+
+/**
+ * @brief Marks the remainder of a ring as unused, so that the next datagram is
+ * contiguous at its start.
+ */
+#define NET_UDP_RING_WRAP UINT32_MAX
+
+/**
+ * @brief A datagram queued to or from the network thread. Its payload follows.
+ */
+typedef struct {
+	net_addr_t addr;
+	uint32_t timestamp;
+	uint32_t size;
+} net_udp_datagram_t;
+
+/**
+ * @brief A lock-free, single-producer single-consumer queue of datagrams. The
+ * producer advances head once a datagram has been written, and the consumer
+ * advances tail once it has been read. Both are free-running byte offsets.
+ */
+typedef struct {
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	byte data[NET_UDP_RING_SIZE];
+} net_udp_ring_t;
+
+/**
+ * @brief The network thread owns a socket, timestamping and queueing received
+ * datagrams for the main thread, and sending those the main thread has queued.
+ */
+typedef struct {
+	SDL_Thread *thread;
+	SDL_atomic_t running;
+	int32_t wake[2]; // a pipe through which the main thread wakes the network thread
+	_Bool batch; // the main thread is between Net_BeginBatch and Net_EndBatch
+	net_udp_ring_t recv;
+	net_udp_ring_t send;
+	SDL_atomic_t dropped; // datagrams dropped because a queue was full
+	SDL_atomic_t errors; // socket errors encountered by the network thread
+} net_udp_thread_t;
+
+#endif
+
 typedef struct {
 	net_udp_loop_t loops[2];
 	int32_t sockets[2];
+#if defined(NET_UDP_BATCH)
+	net_udp_recv_batch_t *recv[2];
+	net_udp_send_batch_t *send[2];
+#endif
+#if defined(NET_UDP_THREAD)
+	net_udp_thread_t *threads[2];
+#endif
+#if defined(NET_UDP_EPOLL)
+	int32_t epolls[2]; // the socket and a timer, for Net_Wait
+	int32_t timers[2];
+#endif
 } net_udp_state_t;
 
 static net_udp_state_t net_udp_state;
@@ -53,6 +195,17 @@ static cvar_t *net_loop_latency;
 static cvar_t *net_loop_jitter;
 static cvar_t *net_loop_loss;
 
+#if defined(NET_UDP_THREAD)
+static cvar_t *net_thread;
+#endif
+
+/**
+ * @brief The time at which the most recent datagram was received. When the
+ * network thread is running, this is the time it was read from the socket,
+ * rather than the time it was dequeued.
+ */
+uint32_t net_receive_time;
+
 /**
  * @brief Reads a pending message, if available, from the loop buffer.
  * @return True if a message was read, false otherwise.
@@ -96,20 +249,416 @@ static _Bool Net_ReceiveDatagram_Loop(net_src_t source, net_addr_t *from, mem_bu
 	return true;
 }
 
+#if defined(NET_UDP_BATCH)
+
 /**
- * @brief Receive a datagram on the specified socket, populating the from
- * address with the sender.
+ * @brief Delivers the next datagram from the receive batch, draining the socket
+ * with recvmmsg when the batch is exhausted.
+ * @return True if a datagram was read, false otherwise.
  */
-_Bool Net_ReceiveDatagram(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
+static _Bool Net_ReceiveDatagram_Batch(int32_t sock, net_udp_recv_batch_t *batch, net_addr_t *from, mem_buf_t *buf) {
 
-	buf->read = buf->size = 0;
+	while (true) {
 
-	memset(from, 0, sizeof(*from));
-	from->type = NA_DATAGRAM;
+		if (batch->index == batch->count) {
+
+			for (int32_t i = 0; i < MAX_NET_UDP_BATCH; i++) {
+				batch->iovecs[i] = (struct iovec) {
+					.iov_base = batch->data[i],
+					.iov_len = sizeof(batch->data[i])
+				};
+				batch->headers[i].msg_hdr = (struct msghdr) {
+					.msg_name = &batch->addrs[i],
+					.msg_namelen = sizeof(batch->addrs[i]),
+					.msg_iov = &batch->iovecs[i],
+					.msg_iovlen = 1
+				};
+			}
+
+			batch->index = batch->count = 0;
+
+			const int32_t received = recvmmsg(sock, batch->headers, MAX_NET_UDP_BATCH, MSG_DONTWAIT, NULL);
+			if (received == -1) {
+				const int32_t err = Net_GetError();
+
+				if (err == EWOULDBLOCK || err == ECONNREFUSED) {
+					return false;    // not terribly abnormal
+				}
+
+				Com_Warn("%s\n", Net_GetErrorString());
+				return false;
+			}
+
+			batch->count = received;
+			if (batch->count == 0) {
+				return false;
+			}
+
+			for (int32_t i = 0; i < batch->count; i++) {
+				Mem_InitBuffer(&batch->buffers[i], batch->data[i], sizeof(batch->data[i]));
+				batch->buffers[i].size = batch->headers[i].msg_len;
+			}
+		}
+
+		const int32_t i = batch->index++;
+		const mem_buf_t *in = &batch->buffers[i];
+
+		from->addr = batch->addrs[i].sin_addr.s_addr;
+		from->port = batch->addrs[i].sin_port;
+
+		if ((batch->headers[i].msg_hdr.msg_flags & MSG_TRUNC) || in->size >= buf->max_size) {
+			Com_Warn("Oversized packet from %s\n", Net_NetaddrToString(from));
+			continue;
+		}
+
+		memcpy(buf->data, in->data, in->size);
+		buf->size = in->size;
 
-	if (Net_ReceiveDatagram_Loop(source, from, buf)) {
 		return true;
 	}
+}
+
+#endif
+
+#if defined(NET_UDP_THREAD)
+
+/**
+ * @brief Reserves contiguous space in the ring for a datagram of up to size bytes.
+ * @return The datagram, followed by space for its payload, or NULL if the ring is full.
+ */
+static net_udp_datagram_t *Net_RingReserve(net_udp_ring_t *ring, size_t size) {
+
+	const uint32_t head = SDL_AtomicGet(&ring->head);
+	const uint32_t tail = SDL_AtomicGet(&ring->tail);
+
+	const uint32_t offset = head & (NET_UDP_RING_SIZE - 1);
+	const uint32_t len = NET_UDP_RING_RECORD(size);
+
+	const uint32_t skip = offset + len > NET_UDP_RING_SIZE ? NET_UDP_RING_SIZE - offset : 0;
+
+	if (NET_UDP_RING_SIZE - (head - tail) < skip + len) {
+		return NULL;
+	}
+
+	if (skip) {
+		((net_udp_datagram_t *) (ring->data + offset))->size = NET_UDP_RING_WRAP;
+		SDL_AtomicSet(&ring->head, head + skip);
+		return (net_udp_datagram_t *) ring->data;
+	}
+
+	return (net_udp_datagram_t *) (ring->data + offset);
+}
+
+/**
+ * @brief Publishes a datagram, previously reserved, to the consumer.
+ */
+static void Net_RingCommit(net_udp_ring_t *ring, const net_udp_datagram_t *datagram) {
+	SDL_AtomicAdd(&ring->head, NET_UDP_RING_RECORD(datagram->size));
+}
+
+/**
+ * @return The oldest datagram in the ring, or NULL if the ring is empty.
+ */
+static net_udp_datagram_t *Net_RingPeek(net_udp_ring_t *ring) {
+
+	while (true) {
+		const uint32_t tail = SDL_AtomicGet(&ring->tail);
+
+		if (tail == (uint32_t) SDL_AtomicGet(&ring->head)) {
+			return NULL;
+		}
+
+		const uint32_t offset = tail & (NET_UDP_RING_SIZE - 1);
+		net_udp_datagram_t *datagram = (net_udp_datagram_t *) (ring->data + offset);
+
+		if (datagram->size == NET_UDP_RING_WRAP) {
+			SDL_AtomicSet(&ring->tail, tail + (NET_UDP_RING_SIZE - offset));
+			continue;
+		}
+
+		return datagram;
+	}
+}
+
+/**
+ * @brief Releases the oldest datagram in the ring back to the producer.
+ */
+static void Net_RingPop(net_udp_ring_t *ring, const net_udp_datagram_t *datagram) {
+	SDL_AtomicAdd(&ring->tail, NET_UDP_RING_RECORD(datagram->size));
+}
+
+/**
+ * @brief Wakes the network thread, so that it sends any queued datagrams.
+ */
+static void Net_WakeThread(net_udp_thread_t *t) {
+	const byte b = 0;
+
+	if (write(t->wake[1], &b, sizeof(b)) == -1) {
+		// the pipe is full, so the thread is awake already
+	}
+}
+
+/**
+ * @brief Reads all pending datagrams from the socket into the receive queue.
+ * This runs on the network thread.
+ */
+static void Net_ThreadReceive(int32_t sock, net_udp_thread_t *t) {
+	byte overflow[MAX_MSG_SIZE];
+
+	while (true) {
+		net_udp_datagram_t *datagram = Net_RingReserve(&t->recv, MAX_MSG_SIZE);
+		byte *data = datagram ? (byte *) (datagram + 1) : overflow;
+
+		net_sockaddr addr;
+		socklen_t addr_len = sizeof(addr);
+
+		const ssize_t received = recvfrom(sock, (void *) data, MAX_MSG_SIZE, MSG_DONTWAIT,
+		                                  (struct sockaddr *) &addr, &addr_len);
+
+		if (received == -1) {
+			const int32_t err = Net_GetError();
+
+			if (err == EINTR || err == ECONNREFUSED) {
+				continue;
+			}
+
+			if (err != EWOULDBLOCK) {
+				SDL_AtomicAdd(&t->errors, 1);
+			}
+
+			return;
+		}
+
+		if (received == MAX_MSG_SIZE) { // oversized
+			SDL_AtomicAdd(&t->errors, 1);
+			continue;
+		}
+
+		if (datagram == NULL) { // the main thread has fallen behind
+			SDL_AtomicAdd(&t->dropped, 1);
+			continue;
+		}
+
+		datagram->addr = (net_addr_t) {
+			.type = NA_DATAGRAM,
+			.addr = addr.sin_addr.s_addr,
+			.port = addr.sin_port
+		};
+
+		datagram->timestamp = SDL_GetTicks();
+		datagram->size = (uint32_t) received;
+
+		Net_RingCommit(&t->recv, datagram);
+	}
+}
+
+/**
+ * @brief Sends all datagrams in the send queue. This runs on the network thread.
+ */
+static void Net_ThreadSend(int32_t sock, net_udp_thread_t *t) {
+	const net_udp_datagram_t *datagram;
+
+	while ((datagram = Net_RingPeek(&t->send))) {
+
+		net_sockaddr to;
+		Net_NetAddrToSockaddr(&datagram->addr, &to);
+
+		if (sendto(sock, (const void *) (datagram + 1), datagram->size, 0,
+		           (const struct sockaddr *) &to, sizeof(to)) == -1) {
+
+			if (Net_GetError() == EINTR) {
+				continue;
+			}
+
+			SDL_AtomicAdd(&t->errors, 1);
+		}
+
+		Net_RingPop(&t->send, datagram);
+	}
+}
+
+/**
+ * @brief The network thread, which waits on its socket and the wake pipe.
+ */
+static int32_t Net_Thread(void *data) {
+
+	const net_src_t source = (net_src_t) (intptr_t) data;
+
+	net_udp_thread_t *t = net_udp_state.threads[source];
+	const int32_t sock = net_udp_state.sockets[source];
+
+	struct pollfd fds[] = {
+		{ .fd = sock, .events = POLLIN },
+		{ .fd = t->wake[0], .events = POLLIN }
+	};
+
+	while (SDL_AtomicGet(&t->running)) {
+
+		if (poll(fds, lengthof(fds), 100) == -1) {
+			if (Net_GetError() != EINTR) {
+				SDL_AtomicAdd(&t->errors, 1);
+			}
+			continue;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			byte b[64];
+			while (read(t->wake[0], b, sizeof(b)) > 0) {
+			}
+		}
+
+		Net_ThreadSend(sock, t);
+
+		if (fds[0].revents & POLLIN) {
+			Net_ThreadReceive(sock, t);
+		}
+	}
+
+	Net_ThreadSend(sock, t);
+	return 0;
+}
+
+/**
+ * @brief Reports any datagrams dropped, or errors encountered, by the network thread.
+ */
+static void Net_CheckThread(net_udp_thread_t *t) {
+
+	const int32_t dropped = SDL_AtomicSet(&t->dropped, 0);
+	if (dropped) {
+		Com_Warn("Network thread dropped %d datagrams\n", dropped);
+	}
+
+	const int32_t errors = SDL_AtomicSet(&t->errors, 0);
+	if (errors) {
+		Com_Warn("Network thread encountered %d socket errors\n", errors);
+	}
+}
+
+/**
+ * @brief Starts a network thread to service the socket for the given source.
+ */
+static void Net_StartThread(net_src_t source) {
+
+	net_udp_thread_t *t = Mem_Malloc(sizeof(net_udp_thread_t));
+
+	if (pipe(t->wake) == -1) {
+		Com_Warn("Failed to create network thread: %s\n", strerror(errno));
+		Mem_Free(t);
+		return;
+	}
+
+	fcntl(t->wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(t->wake[1], F_SETFL, O_NONBLOCK);
+
+	SDL_AtomicSet(&t->running, 1);
+	net_udp_state.threads[source] = t;
+
+	t->thread = SDL_CreateThread(Net_Thread, "Net_Thread", (void *) (intptr_t) source);
+	if (t->thread == NULL) {
+		Com_Warn("Failed to create network thread: %s\n", SDL_GetError());
+
+		net_udp_state.threads[source] = NULL;
+
+		close(t->wake[0]);
+		close(t->wake[1]);
+		Mem_Free(t);
+		return;
+	}
+
+	Com_Debug(DEBUG_NET, "Network thread started\n");
+}
+
+/**
+ * @brief Stops the network thread for the given source, after it has sent any
+ * queued datagrams. Received datagrams not yet dequeued are discarded.
+ */
+static void Net_StopThread(net_src_t source) {
+
+	net_udp_thread_t *t = net_udp_state.threads[source];
+
+	SDL_AtomicSet(&t->running, 0);
+	Net_WakeThread(t);
+
+	SDL_WaitThread(t->thread, NULL);
+
+	Net_CheckThread(t);
+
+	close(t->wake[0]);
+	close(t->wake[1]);
+
+	Mem_Free(t);
+	net_udp_state.threads[source] = NULL;
+
+	Com_Debug(DEBUG_NET, "Network thread stopped\n");
+}
+
+/**
+ * @brief Delivers the next datagram queued by the network thread.
+ * @return True if a datagram was read, false otherwise.
+ */
+static _Bool Net_ReceiveDatagram_Thread(net_udp_thread_t *t, net_addr_t *from, mem_buf_t *buf) {
+	const net_udp_datagram_t *datagram;
+
+	while ((datagram = Net_RingPeek(&t->recv))) {
+
+		*from = datagram->addr;
+
+		if (datagram->size >= buf->max_size) {
+			Com_Warn("Oversized packet from %s\n", Net_NetaddrToString(from));
+			Net_RingPop(&t->recv, datagram);
+			continue;
+		}
+
+		memcpy(buf->data, datagram + 1, datagram->size);
+		buf->size = datagram->size;
+
+		net_receive_time = datagram->timestamp;
+
+		Net_RingPop(&t->recv, datagram);
+		return true;
+	}
+
+	Net_CheckThread(t);
+	return false;
+}
+
+/**
+ * @brief Queues a datagram to be sent by the network thread.
+ */
+static _Bool Net_SendDatagram_Thread(net_udp_thread_t *t, const net_addr_t *to, const void *data, size_t len) {
+
+	net_udp_datagram_t *datagram = Net_RingReserve(&t->send, len);
+	if (datagram == NULL) {
+		Com_Warn("Network thread send queue full, dropping datagram to %s\n", Net_NetaddrToString(to));
+		return false;
+	}
+
+	datagram->addr = *to;
+	datagram->timestamp = quetoo.ticks;
+	datagram->size = (uint32_t) len;
+
+	memcpy(datagram + 1, data, len);
+
+	Net_RingCommit(&t->send, datagram);
+
+	if (!t->batch) {
+		Net_WakeThread(t);
+	}
+
+	return true;
+}
+
+#endif
+
+/**
+ * @brief Receive a datagram on the specified socket itself.
+ */
+static _Bool Net_ReceiveDatagram_(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
+
+	buf->read = buf->size = 0;
+
+	memset(from, 0, sizeof(*from));
+	from->type = NA_DATAGRAM;
 
 	const int32_t sock = net_udp_state.sockets[source];
 
@@ -117,6 +666,18 @@ _Bool Net_ReceiveDatagram(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
 		return false;
 	}
 
+#if defined(NET_UDP_THREAD)
+	if (net_udp_state.threads[source]) {
+		return Net_ReceiveDatagram_Thread(net_udp_state.threads[source], from, buf);
+	}
+#endif
+
+#if defined(NET_UDP_BATCH)
+	if (net_udp_state.recv[source]) {
+		return Net_ReceiveDatagram_Batch(sock, net_udp_state.recv[source], from, buf);
+	}
+#endif
+
 	net_sockaddr addr;
 	socklen_t addr_len = sizeof(addr);
 
@@ -150,6 +711,76 @@ _Bool Net_ReceiveDatagram(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
 	return true;
 }
 
+static _Bool Net_SendDatagram_(net_src_t source, const net_addr_t *to, const void *data, size_t len);
+
+/**
+ * @brief Sends the datagrams held by the network simulator that are now due.
+ */
+static void Net_SendSimulatedDatagrams(net_src_t source) {
+	static byte buffer[MAX_MSG_SIZE];
+	mem_buf_t buf;
+	net_addr_t to;
+
+	Mem_InitBuffer(&buf, buffer, sizeof(buffer));
+
+	while (Net_SimDequeue(source, NET_SIM_OUT, &to, &buf)) {
+		Net_SendDatagram_(source, &to, buf.data, buf.size);
+	}
+}
+
+/**
+ * @brief Receive a datagram on the specified socket, populating the from
+ * address with the sender.
+ */
+_Bool Net_ReceiveDatagram(net_src_t source, net_addr_t *from, mem_buf_t *buf) {
+
+	buf->read = buf->size = 0;
+
+	memset(from, 0, sizeof(*from));
+	from->type = NA_DATAGRAM;
+
+	net_receive_time = quetoo.ticks;
+
+	if (Net_ReceiveDatagram_Loop(source, from, buf)) {
+		return true;
+	}
+
+	if (!net_udp_state.sockets[source]) {
+		return false;
+	}
+
+	Net_SendSimulatedDatagrams(source);
+
+	_Bool received;
+
+	if (Net_SimReplaying(source)) {
+
+		// the capture stands in for the socket, so discard what arrives on it, lest
+		// it remain readable and Net_Wait return immediately until the replay ends
+		while (Net_ReceiveDatagram_(source, from, buf)) {
+		}
+
+		buf->read = buf->size = 0;
+
+		received = Net_SimReplay(source, from, buf);
+	} else if (Net_SimActive(source)) {
+		while (Net_ReceiveDatagram_(source, from, buf)) {
+			Net_SimEnqueue(source, NET_SIM_IN, from, buf->data, buf->size);
+		}
+
+		received = Net_SimDequeue(source, NET_SIM_IN, from, buf);
+		net_receive_time = quetoo.ticks;
+	} else {
+		received = Net_ReceiveDatagram_(source, from, buf);
+	}
+
+	if (received) {
+		Net_SimCapture(source, NET_SIM_IN, from, buf->data, buf->size);
+	}
+
+	return received;
+}
+
 /**
  * @brief
  */
@@ -166,27 +797,145 @@ static _Bool Net_SendDatagram_Loop(net_src_t source, const void *data, size_t le
 	return true;
 }
 
+#if defined(NET_UDP_BATCH)
+
 /**
- * @brief Send a datagram to the specified address.
+ * @brief Sends all queued datagrams with as few sendmmsg calls as possible.
  */
-_Bool Net_SendDatagram(net_src_t source, const net_addr_t *to, const void *data, size_t len) {
+static void Net_FlushDatagrams(net_src_t source) {
 
-	if (to->type == NA_LOOP) {
-		return Net_SendDatagram_Loop(source, data, len);
-	}
+	net_udp_send_batch_t *batch = net_udp_state.send[source];
+	const int32_t sock = net_udp_state.sockets[source];
+
+	int32_t sent = 0;
+	while (sent < batch->count) {
+
+		const int32_t count = sendmmsg(sock, batch->headers + sent, batch->count - sent, 0);
+		if (count == -1) {
+			if (Net_GetError() == EINTR) {
+				continue;
+			}
 
-	int32_t sock;
-	if (to->type == NA_BROADCAST || to->type == NA_DATAGRAM) {
-		if (!(sock = net_udp_state.sockets[source])) {
-			return false;
+			const net_sockaddr *addr = &batch->addrs[sent];
+			const net_addr_t to = {
+				.type = NA_DATAGRAM,
+				.addr = addr->sin_addr.s_addr,
+				.port = addr->sin_port
+			};
+
+			Com_Warn("%s to %s\n", Net_GetErrorString(), Net_NetaddrToString(&to));
+			sent++; // skip the offending datagram
+			continue;
 		}
-	} else {
-		Com_Error(ERROR_DROP, "Bad address type\n");
+
+		sent += count;
+	}
+
+	batch->count = 0;
+	batch->size = 0;
+}
+
+/**
+ * @brief Queues a datagram to be sent by Net_FlushDatagrams.
+ */
+static void Net_QueueDatagram(net_src_t source, const net_sockaddr *to, const void *data, size_t len) {
+
+	net_udp_send_batch_t *batch = net_udp_state.send[source];
+
+	if (batch->count == MAX_NET_UDP_BATCH || batch->size + len > sizeof(batch->data)) {
+		Net_FlushDatagrams(source);
+	}
+
+	const int32_t i = batch->count++;
+	byte *out = batch->data + batch->size;
+
+	memcpy(out, data, len);
+	batch->size += len;
+
+	batch->addrs[i] = *to;
+	batch->iovecs[i] = (struct iovec) {
+		.iov_base = out,
+		.iov_len = len
+	};
+	batch->headers[i].msg_hdr = (struct msghdr) {
+		.msg_name = &batch->addrs[i],
+		.msg_namelen = sizeof(batch->addrs[i]),
+		.msg_iov = &batch->iovecs[i],
+		.msg_iovlen = 1
+	};
+}
+
+#endif
+
+/**
+ * @brief Begins queueing datagrams sent on the specified socket, so that they
+ * may be sent together by Net_EndBatch. Where batched system calls are not
+ * available, datagrams continue to be sent immediately.
+ */
+void Net_BeginBatch(net_src_t source) {
+
+#if defined(NET_UDP_THREAD)
+	if (net_udp_state.threads[source]) {
+		net_udp_state.threads[source]->batch = true;
+		return;
+	}
+#endif
+
+#if defined(NET_UDP_BATCH)
+	if (net_udp_state.send[source]) {
+		net_udp_state.send[source]->active = true;
+	}
+#endif
+}
+
+/**
+ * @brief Sends all datagrams queued since Net_BeginBatch.
+ */
+void Net_EndBatch(net_src_t source) {
+
+#if defined(NET_UDP_THREAD)
+	if (net_udp_state.threads[source]) {
+		net_udp_state.threads[source]->batch = false;
+		Net_WakeThread(net_udp_state.threads[source]);
+		return;
+	}
+#endif
+
+#if defined(NET_UDP_BATCH)
+	if (net_udp_state.send[source]) {
+		Net_FlushDatagrams(source);
+		net_udp_state.send[source]->active = false;
+	}
+#endif
+}
+
+/**
+ * @brief Send a datagram on the specified socket itself.
+ */
+static _Bool Net_SendDatagram_(net_src_t source, const net_addr_t *to, const void *data, size_t len) {
+
+	const int32_t sock = net_udp_state.sockets[source];
+	if (!sock) {
+		return false;
+	}
+
+#if defined(NET_UDP_THREAD)
+	if (net_udp_state.threads[source]) {
+		return Net_SendDatagram_Thread(net_udp_state.threads[source], to, data, len);
 	}
+#endif
 
 	net_sockaddr to_addr;
 	Net_NetAddrToSockaddr(to, &to_addr);
 
+#if defined(NET_UDP_BATCH)
+	const net_udp_send_batch_t *batch = net_udp_state.send[source];
+	if (batch && batch->active && len <= sizeof(batch->data)) {
+		Net_QueueDatagram(source, &to_addr, data, len);
+		return true;
+	}
+#endif
+
 	ssize_t sent = sendto(sock, data, len, 0, (const struct sockaddr *) &to_addr, sizeof(to_addr));
 
 	if (sent == -1) {
@@ -198,22 +947,203 @@ _Bool Net_SendDatagram(net_src_t source, const net_addr_t *to, const void *data,
 }
 
 /**
- * @brief Sleeps for msec or until the server socket is ready.
+ * @brief Send a datagram to the specified address.
  */
-void Net_Sleep(uint32_t msec) {
-	struct timeval timeout;
-	fd_set fdset;
+_Bool Net_SendDatagram(net_src_t source, const net_addr_t *to, const void *data, size_t len) {
+
+	if (to->type == NA_LOOP) {
+		return Net_SendDatagram_Loop(source, data, len);
+	}
+
+	if (to->type != NA_BROADCAST && to->type != NA_DATAGRAM) {
+		Com_Error(ERROR_DROP, "Bad address type\n");
+	}
+
+	if (!net_udp_state.sockets[source]) {
+		return false;
+	}
+
+	Net_SimCapture(source, NET_SIM_OUT, to, data, len);
+
+	if (Net_SimReplaying(source)) {
+		return true;
+	}
+
+	if (Net_SimActive(source)) {
+		Net_SimEnqueue(source, NET_SIM_OUT, to, data, len);
+		Net_SendSimulatedDatagrams(source);
+		return true;
+	}
+
+	return Net_SendDatagram_(source, to, data, len);
+}
+
+/**
+ * @return The monotonic time, in nanoseconds, against which Net_Wait deadlines
+ * are expressed.
+ */
+uint64_t Net_Nanoseconds(void) {
+
+#if defined(_WIN32)
+	static uint64_t frequency;
+	if (!frequency) {
+		frequency = SDL_GetPerformanceFrequency();
+	}
+
+	const uint64_t counter = SDL_GetPerformanceCounter();
+	return (counter / frequency) * 1000000000 + (counter % frequency) * 1000000000 / frequency;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+#if defined(NET_UDP_EPOLL)
+
+/**
+ * @brief Releases the epoll and timer descriptors of the specified socket.
+ */
+static void Net_CloseWait(net_src_t source) {
+
+	if (net_udp_state.epolls[source]) {
+		close(net_udp_state.epolls[source]);
+		close(net_udp_state.timers[source]);
+
+		net_udp_state.epolls[source] = net_udp_state.timers[source] = 0;
+	}
+}
+
+/**
+ * @brief Creates the epoll and timer descriptors of the specified socket. When
+ * the network thread services the socket, only the timer is watched.
+ * @return True on success, false otherwise.
+ */
+static _Bool Net_OpenWait(net_src_t source) {
+
+	const int32_t epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd == -1) {
+		Com_Warn("epoll_create1: %s\n", strerror(errno));
+		return false;
+	}
+
+	const int32_t tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (tfd == -1) {
+		Com_Warn("timerfd_create: %s\n", strerror(errno));
+		close(epfd);
+		return false;
+	}
 
-	const uint32_t sock = net_udp_state.sockets[NS_UDP_SERVER];
+	struct epoll_event event = { .events = EPOLLIN, .data.fd = tfd };
+	epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event);
+
+#if defined(NET_UDP_THREAD)
+	const _Bool threaded = net_udp_state.threads[source] != NULL;
+#else
+	const _Bool threaded = false;
+#endif
+
+	if (!threaded) {
+		const int32_t sock = net_udp_state.sockets[source];
+
+		event = (struct epoll_event) { .events = EPOLLIN, .data.fd = sock };
+		epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &event);
+	}
+
+	net_udp_state.epolls[source] = epfd;
+	net_udp_state.timers[source] = tfd;
+
+	return true;
+}
+
+#endif
+
+/**
+ * @brief Blocks until a datagram arrives on the specified socket, or until the
+ * deadline, an absolute time as returned by Net_Nanoseconds, has passed.
+ * @return True if a datagram may be read before the deadline, false otherwise.
+ */
+_Bool Net_Wait(net_src_t source, uint64_t deadline) {
+
+	const int32_t sock = net_udp_state.sockets[source];
 	assert(sock);
 
+	uint64_t now = Net_Nanoseconds();
+	if (now >= deadline) {
+		return false;
+	}
+
+#if defined(NET_UDP_EPOLL)
+	if (net_udp_state.epolls[source] || Net_OpenWait(source)) {
+
+		const struct itimerspec timer = {
+			.it_value = {
+				.tv_sec = deadline / 1000000000,
+				.tv_nsec = deadline % 1000000000
+			}
+		};
+
+		timerfd_settime(net_udp_state.timers[source], TFD_TIMER_ABSTIME, &timer, NULL);
+
+		struct epoll_event events[2];
+		const int32_t count = epoll_wait(net_udp_state.epolls[source], events, lengthof(events), -1);
+
+		_Bool readable = false;
+		for (int32_t i = 0; i < count; i++) {
+			if (events[i].data.fd == sock) {
+				readable = true;
+			} else {
+				uint64_t expirations;
+				if (read(events[i].data.fd, &expirations, sizeof(expirations)) == -1) {
+					// the timer was rearmed, or has not yet expired
+				}
+			}
+		}
+
+		return readable;
+	}
+#endif
+
+#if defined(_WIN32)
+	fd_set fdset;
+
 	FD_ZERO(&fdset);
-	FD_SET(sock, &fdset); // server socket
+	FD_SET(sock, &fdset);
+
+	const uint64_t usec = (deadline - now + 999) / 1000;
+
+	struct timeval timeout = {
+		.tv_sec = (long) (usec / 1000000),
+		.tv_usec = (long) (usec % 1000000)
+	};
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
+	return select(sock + 1, &fdset, NULL, NULL, &timeout) > 0;
+#else
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
 
-	select(sock + 1, &fdset, NULL, NULL, &timeout);
+#if defined(NET_UDP_THREAD)
+	const nfds_t nfds = net_udp_state.threads[source] ? 0 : 1;
+#else
+	const nfds_t nfds = 1;
+#endif
+
+	// poll for whole milliseconds, and sleep precisely for the remainder
+	if (poll(&pfd, nfds, (int32_t) ((deadline - now) / 1000000)) > 0) {
+		return true;
+	}
+
+	now = Net_Nanoseconds();
+	if (now < deadline) {
+		const struct timespec ts = {
+			.tv_sec = (deadline - now) / 1000000000,
+			.tv_nsec = (deadline - now) % 1000000000
+		};
+		nanosleep(&ts, NULL);
+	}
+
+	return false;
+#endif
 }
 
 /**
@@ -224,6 +1154,10 @@ void Net_Sleep(uint32_t msec) {
 void Net_Config(net_src_t source, _Bool up) {
 	int32_t *sock = &net_udp_state.sockets[source];
 
+#if defined(NET_UDP_EPOLL)
+	Net_CloseWait(source);
+#endif
+
 	if (up) {
 
 		net_loop_latency = Cvar_Add("net_loop_latency", "0", CVAR_DEVELOPER,
@@ -244,7 +1178,47 @@ void Net_Config(net_src_t source, _Bool up) {
 
 			*sock = Net_Socket(NA_DATAGRAM, iface, port);
 		}
+
+#if defined(NET_UDP_BATCH)
+		if (!net_udp_state.recv[source]) {
+			net_udp_state.recv[source] = Mem_Malloc(sizeof(net_udp_recv_batch_t));
+			net_udp_state.send[source] = Mem_Malloc(sizeof(net_udp_send_batch_t));
+		}
+#endif
+
+#if defined(NET_UDP_THREAD)
+		net_thread = Cvar_Add("net_thread", "0", CVAR_ARCHIVE,
+				"Service the server socket on a dedicated network thread");
+
+		if (source == NS_UDP_SERVER && *sock != 0) {
+			if (net_thread->integer && !net_udp_state.threads[source]) {
+				Net_StartThread(source);
+			} else if (!net_thread->integer && net_udp_state.threads[source]) {
+				Net_StopThread(source);
+			}
+		}
+#endif
 	} else {
+#if defined(NET_UDP_THREAD)
+		if (net_udp_state.threads[source]) {
+			Net_StopThread(source);
+		}
+#endif
+
+#if defined(NET_UDP_BATCH)
+		if (net_udp_state.recv[source]) {
+			if (*sock != 0) {
+				Net_FlushDatagrams(source);
+			}
+
+			Mem_Free(net_udp_state.recv[source]);
+			Mem_Free(net_udp_state.send[source]);
+
+			net_udp_state.recv[source] = NULL;
+			net_udp_state.send[source] = NULL;
+		}
+#endif
+
 		if (*sock != 0) {
 			Net_CloseSocket(*sock);
 			*sock = 0;
@@ -23,8 +23,14 @@
 
 #include "net.h"
 
+extern uint32_t net_receive_time;
+
 _Bool Net_ReceiveDatagram(net_src_t source, net_addr_t *from, mem_buf_t *buf);
 _Bool Net_SendDatagram(net_src_t source, const net_addr_t *to, const void *data, size_t len);
 
+void Net_BeginBatch(net_src_t source);
+void Net_EndBatch(net_src_t source);
+
 void Net_Config(net_src_t source, _Bool up);
-void Net_Sleep(uint32_t msec);
+uint64_t Net_Nanoseconds(void);
+_Bool Net_Wait(net_src_t source, uint64_t deadline);
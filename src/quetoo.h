@@ -212,6 +212,7 @@ typedef enum {
 	MEM_TAG_CMODEL,
 	MEM_TAG_BSP,
 	MEM_TAG_FS,
+	MEM_TAG_FRAME,
 
 	MEM_TAG_TOTAL,
 	MEM_TAG_ALL = -1
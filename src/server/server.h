@@ -31,11 +31,13 @@
 #include "sv_admin.h"
 #include "sv_console.h"
 #include "sv_client.h"
+#include "sv_download.h"
 #include "sv_entity.h"
 #include "sv_game.h"
 #include "sv_init.h"
 #include "sv_main.h"
 #include "sv_master.h"
+#include "sv_profile.h"
 #include "sv_send.h"
 #include "sv_types.h"
 #include "sv_world.h"
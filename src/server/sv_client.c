@@ -143,8 +143,13 @@ static void Sv_Baselines_f(void) {
 	while (sv_client->net_chan.message.size < (MAX_MSG_SIZE >> 1) && start < MAX_ENTITIES) {
 		base = &sv.baselines[start];
 		if (base->model1 || base->sound || base->effects) {
+			net_bit_stream_t stream;
+
 			Net_WriteByte(&sv_client->net_chan.message, SV_CMD_BASELINE);
-			Net_WriteDeltaEntity(&sv_client->net_chan.message, &null_state, base, true);
+
+			Net_BeginBitStream(&stream, &sv_client->net_chan.message);
+			Net_WriteDeltaEntity(&stream, &null_state, base, true);
+			Net_FlushBits(&stream);
 		}
 		start++;
 	}
@@ -192,42 +197,6 @@ static void Sv_Begin_f(void) {
 	Cbuf_InsertFromDefer();
 }
 
-/**
- * @brief
- */
-static void Sv_NextDownload_f(void) {
-	byte buf[MAX_MSG_SIZE];
-	mem_buf_t msg;
-
-	sv_client_download_t *download = &sv_client->download;
-
-	if (!download->buffer) {
-		return;
-	}
-
-	Mem_InitBuffer(&msg, buf, sizeof(buf));
-
-	int32_t len = Clamp(download->size - download->count, 0, 1024);
-
-	Net_WriteByte(&msg, SV_CMD_DOWNLOAD);
-	Net_WriteShort(&msg, len);
-
-	int32_t percent = download->count * 100 / (Clamp(download->size, 1, download->size));
-	Net_WriteByte(&msg, percent);
-
-	Mem_WriteBuffer(&msg, download->buffer + download->count, len);
-	Mem_WriteBuffer(&sv_client->net_chan.message, msg.data, msg.size);
-
-	download->count += len;
-
-	if (download->count == download->size) {
-		Com_Debug(DEBUG_SERVER, "Finished download to %s\n", Sv_NetaddrToString(sv_client));
-
-		Fs_Free(download->buffer);
-		download->buffer = NULL;
-	}
-}
-
 /**
  * @brief
  */
@@ -274,16 +243,16 @@ static void Sv_Download_f(void) {
 
 	sv_client_download_t *download = &sv_client->download;
 
-	if (download->buffer) { // free last download
-		Fs_Free(download->buffer);
+	if (download->file) { // release the last download
+		Sv_CloseDownload(download->file);
 	}
 
 	memset(download, 0, sizeof(*download));
 
-	// try to load the file
-	download->size = (int32_t) Fs_Load(filename, (void *) &download->buffer);
+	// open the file, or share it with other clients already downloading it
+	download->file = Sv_OpenDownload(filename);
 
-	if (download->size == -1) {
+	if (download->file == NULL) {
 		Com_Warn("Couldn't download %s to %s\n", filename, Sv_NetaddrToString(sv_client));
 		Net_WriteByte(&sv_client->net_chan.message, SV_CMD_DOWNLOAD);
 		Net_WriteShort(&sv_client->net_chan.message, -1);
@@ -292,16 +261,23 @@ static void Sv_Download_f(void) {
 	}
 
 	if (Cmd_Argc() > 2) {
-		download->count = (int32_t) strtol(Cmd_Argv(2), NULL, 0);
-		if (download->count < 0 || download->count > download->size) {
-			Com_Warn("Invalid offset (%d) from %s\n", download->count,
+		download->count = strtoll(Cmd_Argv(2), NULL, 0);
+		if (download->count < 0 || download->count > download->file->size) {
+			Com_Warn("Invalid offset (%" PRId64 ") from %s\n", download->count,
 			         Sv_NetaddrToString(sv_client));
-			download->count = download->size;
+			download->count = download->file->size;
 		}
 	}
 
-	Sv_NextDownload_f();
-	Com_Debug(DEBUG_SERVER, "Downloading %s to %s\n", filename, sv_client->name);
+	// send a chunk each frame, sized so that downloads respect the client's rate
+	if (sv_client->rate) {
+		download->chunk_size = Clamp(sv_client->rate / QUETOO_TICK_RATE, SV_DOWNLOAD_CHUNK_MIN, SV_DOWNLOAD_CHUNK_MAX);
+	} else {
+		download->chunk_size = SV_DOWNLOAD_CHUNK_MAX;
+	}
+
+	Com_Debug(DEBUG_SERVER, "Downloading %s to %s in %d byte chunks\n", filename, sv_client->name,
+	          download->chunk_size);
 }
 
 /**
@@ -348,7 +324,6 @@ static sv_user_string_cmd_t sv_user_string_cmds[] = { // mapping command names t
 	{ "disconnect", Sv_Disconnect_f },
 	{ "info", Sv_Info_f },
 	{ "download", Sv_Download_f },
-	{ "next_download", Sv_NextDownload_f },
 	{ NULL, NULL }
 };
 
@@ -438,7 +413,11 @@ void Sv_ParseClientMessage(sv_client_t *cl) {
 					cl->last_frame = last_frame;
 					if (cl->last_frame > -1) {
 						cl->frame_latency[cl->last_frame & (SV_CLIENT_LATENCY_COUNT - 1)] =
-						    quetoo.ticks - cl->frames[cl->last_frame & PACKET_MASK].sent_time;
+						    net_receive_time - cl->frames[cl->last_frame & PACKET_MASK].sent_time;
+
+						if (cl->state == SV_CLIENT_ACTIVE) {
+							Sv_AcknowledgeFrame(cl, cl->last_frame);
+						}
 					}
 				}
 
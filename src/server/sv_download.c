@@ -0,0 +1,209 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "sv_local.h"
+
+/**
+ * @brief Files being downloaded, by name. Clients downloading the same file
+ * share a single handle and block cache.
+ */
+static GHashTable *sv_downloads;
+
+/**
+ * @brief Opens the specified file for download, or acquires a reference to it
+ * if it is already being downloaded.
+ *
+ * @return The shared download, or NULL if the file could not be opened.
+ */
+sv_download_t *Sv_OpenDownload(const char *filename) {
+
+	if (sv_downloads == NULL) {
+		sv_downloads = g_hash_table_new(g_str_hash, g_str_equal);
+	}
+
+	sv_download_t *download = g_hash_table_lookup(sv_downloads, filename);
+	if (download) {
+		download->refs++;
+		return download;
+	}
+
+	file_t *file = Fs_OpenRead(filename);
+	if (file == NULL) {
+		return NULL;
+	}
+
+	download = Mem_TagMalloc(sizeof(sv_download_t), MEM_TAG_SERVER);
+
+	g_strlcpy(download->name, filename, sizeof(download->name));
+	download->file = file;
+	download->size = Fs_FileLength(file);
+	download->refs = 1;
+
+	for (size_t i = 0; i < lengthof(download->blocks); i++) {
+		download->blocks[i].offset = -1;
+	}
+
+	g_hash_table_insert(sv_downloads, download->name, download);
+
+	Com_Debug(DEBUG_SERVER, "Opened %s for download\n", download->name);
+	return download;
+}
+
+/**
+ * @brief Resolves a chunk of the specified download from its block cache,
+ * reading the containing block from the file if necessary. Chunks never span
+ * blocks, so len is clamped to the end of the containing block.
+ *
+ * @return A pointer to the chunk, valid until the next read of this download,
+ * or NULL on error.
+ */
+const byte *Sv_ReadDownload(sv_download_t *download, int64_t offset, int32_t *len) {
+
+	const int64_t block_offset = offset & ~((int64_t) SV_DOWNLOAD_BLOCK_SIZE - 1);
+
+	sv_download_block_t *block = NULL, *victim = download->blocks;
+
+	for (size_t i = 0; i < lengthof(download->blocks); i++) {
+		sv_download_block_t *b = &download->blocks[i];
+
+		if (b->offset == block_offset) {
+			block = b;
+			break;
+		}
+
+		if (b->last_used < victim->last_used) {
+			victim = b;
+		}
+	}
+
+	if (block == NULL) {
+		block = victim;
+
+		if (!Fs_Seek(download->file, block_offset)) {
+			Com_Warn("Failed to seek %s: %s\n", download->name, Fs_LastError());
+			return NULL;
+		}
+
+		const int64_t size = Fs_Read(download->file, block->data, 1, sizeof(block->data));
+		if (size <= 0) {
+			Com_Warn("Failed to read %s: %s\n", download->name, Fs_LastError());
+			block->offset = -1;
+			return NULL;
+		}
+
+		block->offset = block_offset;
+		block->size = (int32_t) size;
+	}
+
+	block->last_used = ++download->clock;
+
+	const int32_t start = (int32_t) (offset - block_offset);
+	*len = Clamp(*len, 0, block->size - start);
+
+	return block->data + start;
+}
+
+/**
+ * @brief Releases a reference to the specified download, closing it when no
+ * clients remain.
+ */
+void Sv_CloseDownload(sv_download_t *download) {
+
+	if (--download->refs > 0) {
+		return;
+	}
+
+	Com_Debug(DEBUG_SERVER, "Closed %s\n", download->name);
+
+	g_hash_table_remove(sv_downloads, download->name);
+
+	Fs_Close(download->file);
+	Mem_Free(download);
+}
+
+/**
+ * @brief Frees the download table. All clients' downloads must have been closed.
+ */
+void Sv_ShutdownDownloads(void) {
+
+	if (sv_downloads == NULL) {
+		return;
+	}
+
+	assert(g_hash_table_size(sv_downloads) == 0);
+
+	g_hash_table_destroy(sv_downloads);
+	sv_downloads = NULL;
+}
+
+/**
+ * @brief Writes the next chunk of the client's download, if any, to its
+ * reliable message. Chunks are sized against the client's rate when the
+ * download begins, and are only written while the reliable window has room.
+ */
+void Sv_SendDownload(sv_client_t *cl) {
+
+	sv_client_download_t *download = &cl->download;
+
+	if (download->file == NULL) {
+		return;
+	}
+
+	int32_t len = (int32_t) Min(download->file->size - download->count, (int64_t) download->chunk_size);
+
+	if (Netchan_ReliableSpace(&cl->net_chan) < (size_t) len + 4) {
+		return;
+	}
+
+	const byte *data = NULL;
+	if (len && (data = Sv_ReadDownload(download->file, download->count, &len)) == NULL) {
+		Net_WriteByte(&cl->net_chan.message, SV_CMD_DOWNLOAD);
+		Net_WriteShort(&cl->net_chan.message, -1);
+		Net_WriteByte(&cl->net_chan.message, 0);
+
+		Sv_CloseDownload(download->file);
+		download->file = NULL;
+		return;
+	}
+
+	download->count += len;
+
+	// the client finishes the download when it receives the final chunk at 100%
+	int32_t percent = 100;
+	if (download->count < download->file->size) {
+		percent = (int32_t) (download->count * 100 / download->file->size);
+	}
+
+	Net_WriteByte(&cl->net_chan.message, SV_CMD_DOWNLOAD);
+	Net_WriteShort(&cl->net_chan.message, len);
+	Net_WriteByte(&cl->net_chan.message, percent);
+
+	if (len) {
+		Mem_WriteBuffer(&cl->net_chan.message, data, len);
+	}
+
+	if (download->count == download->file->size) {
+		Com_Debug(DEBUG_SERVER, "Finished download to %s\n", Sv_NetaddrToString(cl));
+
+		Sv_CloseDownload(download->file);
+		download->file = NULL;
+	}
+}
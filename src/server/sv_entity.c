@@ -22,9 +22,55 @@
 #include "sv_local.h"
 
 /**
- * @brief Writes a delta update of an entity_state_t list to the message.
+ * @brief Forgets all known entity states for the specified client. This is
+ * done whenever an uncompressed frame is sent, so that states received before
+ * it (e.g. before a demo began recording) are never referenced.
  */
-static void Sv_WriteEntities(sv_frame_t *from, sv_frame_t *to, mem_buf_t *msg) {
+static void Sv_ResetKnownEntities(sv_client_t *client) {
+
+	for (size_t i = 0; i < lengthof(client->known_entities); i++) {
+		client->known_entities[i].frame_num = -1;
+		client->known_entities[i].sent_frame = -1;
+	}
+
+	client->known_frame_floor = sv.frame_num;
+}
+
+/**
+ * @brief Records the states of the entities in the specified frame, which the
+ * client has acknowledged, as known to the client.
+ */
+void Sv_AcknowledgeFrame(sv_client_t *client, int32_t frame_num) {
+
+	if (frame_num < client->known_frame_floor || frame_num > (int32_t) sv.frame_num) {
+		return;
+	}
+
+	if (sv.frame_num - frame_num >= PACKET_BACKUP) {
+		return;
+	}
+
+	const sv_frame_t *frame = &client->frames[frame_num & PACKET_MASK];
+
+	for (uint16_t i = 0; i < frame->num_entities; i++) {
+		const entity_state_t *state = &svs.entity_states[(frame->entity_state + i) % svs.num_entity_states];
+
+		sv_known_entity_t *known = &client->known_entities[state->number];
+		if (frame_num > known->frame_num) {
+			known->state = *state;
+			known->frame_num = frame_num;
+		}
+	}
+}
+
+/**
+ * @brief Writes a delta update of an entity_state_t list to the message. The
+ * entities are bit packed, in ascending order. Entities that were not present
+ * in the delta frame are compressed from their last known state, if the client
+ * still retains it, or else from their baseline.
+ */
+static void Sv_WriteEntities(sv_client_t *client, sv_frame_t *from, sv_frame_t *to, mem_buf_t *msg) {
+	net_bit_stream_t stream;
 	entity_state_t *old_state = NULL, *new_state = NULL;
 	uint32_t old_index, new_index;
 	uint16_t old_num, new_num;
@@ -36,6 +82,8 @@ static void Sv_WriteEntities(sv_frame_t *from, sv_frame_t *to, mem_buf_t *msg) {
 		from_num_entities = from->num_entities;
 	}
 
+	Net_BeginBitStream(&stream, msg);
+
 	new_index = 0;
 	old_index = 0;
 	while (new_index < to->num_entities || old_index < from_num_entities) {
@@ -55,30 +103,36 @@ static void Sv_WriteEntities(sv_frame_t *from, sv_frame_t *to, mem_buf_t *msg) {
 		}
 
 		if (new_num == old_num) { // delta update from old position
-			Net_WriteDeltaEntity(msg, old_state, new_state, false);
+			Net_WriteDeltaEntity(&stream, old_state, new_state, false);
+			client->known_entities[new_num].sent_frame = sv.frame_num;
 			old_index++;
 			new_index++;
 			continue;
 		}
 
-		if (new_num < old_num) { // this is a new entity, send it from the baseline
-			Net_WriteDeltaEntity(msg, &sv.baselines[new_num], new_state, true);
+		if (new_num < old_num) { // this is a new entity, send it from its last known state
+			sv_known_entity_t *known = &client->known_entities[new_num];
+
+			if (known->frame_num >= 0 && known->sent_frame - known->frame_num < ENTITY_STATE_HISTORY) {
+				Net_WriteKnownDeltaEntity(&stream, &known->state, new_state, sv.frame_num - known->frame_num);
+			} else { // or from the baseline
+				Net_WriteDeltaEntity(&stream, &sv.baselines[new_num], new_state, true);
+			}
+
+			known->sent_frame = sv.frame_num;
 			new_index++;
 			continue;
 		}
 
 		if (new_num > old_num) { // the old entity isn't present in the new message
-			const int16_t bits = U_REMOVE;
-
-			Net_WriteShort(msg, old_num);
-			Net_WriteShort(msg, bits);
-
+			Net_WriteRemoveEntity(&stream, old_num);
 			old_index++;
 			continue;
 		}
 	}
 
-	Net_WriteShort(msg, 0); // end of entities
+	Net_WriteEndOfEntities(&stream);
+	Net_FlushBits(&stream);
 }
 
 /**
@@ -118,6 +172,10 @@ void Sv_WriteClientFrame(sv_client_t *client, mem_buf_t *msg) {
 		delta_frame_num = client->last_frame;
 	}
 
+	if (delta_frame == NULL) {
+		Sv_ResetKnownEntities(client);
+	}
+
 	Net_WriteByte(msg, SV_CMD_FRAME);
 	Net_WriteLong(msg, sv.frame_num);
 	Net_WriteLong(msg, delta_frame_num); // what we are delta'ing from
@@ -132,7 +190,7 @@ void Sv_WriteClientFrame(sv_client_t *client, mem_buf_t *msg) {
 	Sv_WritePlayerState(delta_frame, frame, msg);
 
 	// delta encode the entities
-	Sv_WriteEntities(delta_frame, frame, msg);
+	Sv_WriteEntities(client, delta_frame, frame, msg);
 }
 
 /**
@@ -152,16 +210,20 @@ static void Sv_ClientVisibility(const vec3_t org, byte *pvs, byte *phs) {
 		maxs[i] = org[i] + 16.0;
 	}
 
+	const size_t row_size = Cm_VisRowSize();
+
+	memset(pvs, 0, row_size);
+	memset(phs, 0, row_size);
+
+	// this may run on a worker thread, so we must not raise an error here
 	const size_t len = Cm_BoxLeafnums(mins, maxs, leafs, lengthof(leafs), NULL, 0);
 	if (len == 0) {
-		Com_Error(ERROR_DROP, "Bad leaf count for client @ %s\n", vtos(org));
+		Com_Warn("Bad leaf count for client @ %s\n", vtos(org));
+		return;
 	} else if (len == lengthof(leafs)) {
 		Com_Warn("MAX_ENT_LEAFS for client @ %s\n", vtos(org));
 	}
 
-	memset(pvs, 0, MAX_BSP_LEAFS >> 3);
-	memset(phs, 0, MAX_BSP_LEAFS >> 3);
-
 	// convert leafs to clusters and combine their visibility data
 	for (size_t i = 0; i < len; i++) {
 
@@ -180,16 +242,10 @@ static void Sv_ClientVisibility(const vec3_t org, byte *pvs, byte *phs) {
 
 		clusters[num_clusters++] = cluster;
 
-		byte cluster_pvs[MAX_BSP_LEAFS >> 3];
-		byte cluster_phs[MAX_BSP_LEAFS >> 3];
+		byte scratch[MAX_BSP_LEAFS >> 3];
 
-		Cm_ClusterPVS(cluster, cluster_pvs);
-		Cm_ClusterPHS(cluster, cluster_phs);
-
-		for (size_t n = 0; n < sizeof(cluster_pvs); n++) {
-			pvs[n] |= cluster_pvs[n];
-			phs[n] |= cluster_phs[n];
-		}
+		Cm_UnionVis(pvs, Cm_ClusterPVSRow(cluster, scratch), row_size);
+		Cm_UnionVis(phs, Cm_ClusterPHSRow(cluster, scratch), row_size);
 
 		if (num_clusters == lengthof(clusters)) {
 			Com_Warn("MAX_ENT_CLUSTERS for client @ %s\n", vtos(org));
@@ -198,9 +254,27 @@ static void Sv_ClientVisibility(const vec3_t org, byte *pvs, byte *phs) {
 	}
 }
 
+/**
+ * @brief Ensures that each entity's state is numbered correctly. This is done
+ * once per frame, before client frames are built in parallel.
+ */
+void Sv_FixEntityNumbers(void) {
+
+	for (uint16_t e = 1; e < svs.game->num_entities; e++) {
+		g_entity_t *ent = ENTITY_FOR_NUM(e);
+
+		if (ent->s.number != e) {
+			Com_Warn("Fixing entity number: %d -> %d\n", ent->s.number, e);
+			ent->s.number = e;
+		}
+	}
+}
+
 /**
  * @brief Decides which entities are going to be visible to the client, and
- * copies off the player state and area_bits.
+ * copies off the player state and area_bits. Each client frame writes only to
+ * its own reserved range of svs.entity_states, so frames for different
+ * clients may be built concurrently.
  */
 void Sv_BuildClientFrame(sv_client_t *client) {
 	vec3_t org, off;
@@ -232,11 +306,37 @@ void Sv_BuildClientFrame(sv_client_t *client) {
 	byte pvs[MAX_BSP_LEAFS >> 3], phs[MAX_BSP_LEAFS >> 3];
 	Sv_ClientVisibility(org, pvs, phs);
 
+	// gather the entities occupying any cluster the client can see or hear
+	const size_t row_size = Cm_VisRowSize();
+
+	byte vis[MAX_BSP_LEAFS >> 3];
+	memcpy(vis, pvs, row_size);
+	Cm_UnionVis(vis, phs, row_size);
+
+	uint32_t candidates[MAX_ENTITIES >> 5];
+	memset(candidates, 0, sizeof(candidates));
+
+	Sv_ClusterEntities(vis, row_size, candidates);
+
+	const uint16_t c = (uint16_t) NUM_FOR_ENTITY(cent);
+	candidates[c >> 5] |= 1u << (c & 31);
+
 	// build up the list of relevant entities
 	frame->num_entities = 0;
-	frame->entity_state = svs.next_entity_state;
+	frame->entity_state = ((uint32_t) (client - svs.clients) * PACKET_BACKUP +
+	                       (sv.frame_num & PACKET_MASK)) * MAX_PACKET_ENTITIES;
 
 	for (uint16_t e = 1; e < svs.game->num_entities; e++) {
+
+		if (candidates[e >> 5] == 0) {
+			e |= 31;
+			continue;
+		}
+
+		if (!(candidates[e >> 5] & (1u << (e & 31)))) {
+			continue;
+		}
+
 		g_entity_t *ent = ENTITY_FOR_NUM(e);
 
 		// ignore entities that are local to the server
@@ -280,12 +380,13 @@ void Sv_BuildClientFrame(sv_client_t *client) {
 			}
 		}
 
-		// copy it to the circular entity_state_t array
-		entity_state_t *s = &svs.entity_states[svs.next_entity_state % svs.num_entity_states];
-		if (ent->s.number != e) {
-			Com_Warn("Fixing entity number: %d -> %d\n", ent->s.number, e);
-			ent->s.number = e;
+		if (frame->num_entities == MAX_PACKET_ENTITIES) {
+			Com_Warn("MAX_PACKET_ENTITIES for %s\n", client->name);
+			break;
 		}
+
+		// copy it to the client's range of the entity_state_t array
+		entity_state_t *s = &svs.entity_states[frame->entity_state + frame->num_entities];
 		*s = ent->s;
 
 		// don't mark our own missiles as solid for prediction
@@ -293,7 +394,6 @@ void Sv_BuildClientFrame(sv_client_t *client) {
 			s->solid = SOLID_NOT;
 		}
 
-		svs.next_entity_state++;
 		frame->num_entities++;
 	}
 }
@@ -25,5 +25,7 @@
 
 #ifdef __SV_LOCAL_H__
 void Sv_WriteClientFrame(sv_client_t *client, mem_buf_t *msg);
+void Sv_FixEntityNumbers(void);
 void Sv_BuildClientFrame(sv_client_t *client);
+void Sv_AcknowledgeFrame(sv_client_t *client, int32_t frame_num);
 #endif /* __SV_LOCAL_H__ */
@@ -159,6 +159,7 @@ static void Sv_UpdateLatchedVars(void) {
 	sv_max_clients->integer = Clamp(sv_max_clients->integer, MIN_CLIENTS, MAX_CLIENTS);
 
 	cm_no_areas = sv_no_areas->integer;
+	cm_vis_cache_size = (size_t) Max(sv_vis_cache->integer, 0) * 1024 * 1024;
 }
 
 /**
@@ -174,14 +175,16 @@ static void Sv_ShutdownClients(void) {
 
 	for (i = 0, cl = svs.clients; i < sv_max_clients->integer; i++, cl++) {
 
-		if (cl->download.buffer) {
-			Fs_Free(cl->download.buffer);
+		if (cl->download.file) {
+			Sv_CloseDownload(cl->download.file);
 		}
 	}
 
 	Mem_Free(svs.clients);
 	svs.clients = NULL;
 
+	memset(svs.client_hash, 0, sizeof(svs.client_hash));
+
 	Mem_Free(svs.entity_states);
 	svs.entity_states = NULL;
 }
@@ -376,6 +379,8 @@ void Sv_ShutdownServer(const char *msg) {
 
 	Sv_ShutdownClients();
 
+	Sv_ShutdownDownloads();
+
 	Sv_ShutdownMasters();
 
 	Sv_ClearState();
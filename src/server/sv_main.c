@@ -29,6 +29,7 @@ sv_server_t sv; // per-level server info
 
 sv_client_t *sv_client; // current client
 
+cvar_t *sv_connectionless_rate;
 cvar_t *sv_demo_list;
 cvar_t *sv_download_url;
 cvar_t *sv_enforce_time;
@@ -39,6 +40,95 @@ cvar_t *sv_public;
 cvar_t *sv_rcon_password; // password for remote server commands
 cvar_t *sv_timeout;
 cvar_t *sv_udp_download;
+cvar_t *sv_vis_cache;
+
+/**
+ * @brief Hashes the specified address and qport into the client index.
+ */
+static uint32_t Sv_HashClient(const net_addr_t *addr, uint8_t qport) {
+
+	uint32_t hash = (uint32_t) addr->addr * 2654435761u;
+	hash ^= (((uint32_t) addr->type << 8) | qport) * 40503u;
+
+	return (hash ^ (hash >> 16)) & (SV_CLIENT_HASH_SIZE - 1);
+}
+
+/**
+ * @return The client connected from the specified address and qport, or NULL.
+ */
+static sv_client_t *Sv_FindClient(const net_addr_t *addr, uint8_t qport) {
+
+	uint32_t h = Sv_HashClient(addr, qport);
+
+	for (int32_t i = 0; i < SV_CLIENT_HASH_SIZE; i++, h = (h + 1) & (SV_CLIENT_HASH_SIZE - 1)) {
+
+		const uint8_t slot = svs.client_hash[h];
+		if (slot == 0) {
+			break;
+		}
+
+		sv_client_t *cl = &svs.clients[slot - 1];
+
+		if (cl->state == SV_CLIENT_FREE) {
+			continue;
+		}
+
+		if (cl->net_chan.qport == qport && Net_CompareClientNetaddr(addr, &cl->net_chan.remote_address)) {
+			return cl;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Adds the specified client to the client index by its current address
+ * and qport. The client must not already be indexed.
+ */
+static void Sv_HashClientSlot(const sv_client_t *cl) {
+
+	uint32_t h = Sv_HashClient(&cl->net_chan.remote_address, cl->net_chan.qport);
+
+	while (svs.client_hash[h]) {
+		h = (h + 1) & (SV_CLIENT_HASH_SIZE - 1);
+	}
+
+	svs.client_hash[h] = (uint8_t) (cl - svs.clients) + 1;
+}
+
+/**
+ * @brief Removes the specified client from the client index, shifting any
+ * displaced entries back so that probe sequences remain unbroken. This must
+ * be called before the client's address or qport are changed.
+ */
+static void Sv_UnhashClientSlot(const sv_client_t *cl) {
+
+	const uint8_t slot = (uint8_t) (cl - svs.clients) + 1;
+	const uint32_t mask = SV_CLIENT_HASH_SIZE - 1;
+
+	uint32_t i = Sv_HashClient(&cl->net_chan.remote_address, cl->net_chan.qport);
+
+	while (svs.client_hash[i] != slot) {
+		if (svs.client_hash[i] == 0) {
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	for (uint32_t j = (i + 1) & mask; svs.client_hash[j]; j = (j + 1) & mask) {
+
+		const sv_client_t *other = &svs.clients[svs.client_hash[j] - 1];
+		const uint32_t home = Sv_HashClient(&other->net_chan.remote_address, other->net_chan.qport);
+
+		// entries whose home lies cyclically within (i, j] stay put
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			svs.client_hash[i] = svs.client_hash[j];
+			i = j;
+		}
+	}
+
+	svs.client_hash[i] = 0;
+}
 
 /**
  * @brief Called when the player is totally leaving the server, either willingly
@@ -57,6 +147,8 @@ void Sv_DropClient(sv_client_t *cl) {
 
 	if (cl->state > SV_CLIENT_FREE) { // send the disconnect
 
+		Sv_UnhashClientSlot(cl);
+
 		if (cl->state == SV_CLIENT_ACTIVE) { // after informing the game module
 			svs.game->ClientDisconnect(cl->entity);
 		}
@@ -65,8 +157,8 @@ void Sv_DropClient(sv_client_t *cl) {
 		Netchan_Transmit(&cl->net_chan, cl->net_chan.message.data, cl->net_chan.message.size);
 	}
 
-	if (cl->download.buffer) {
-		Fs_Free(cl->download.buffer);
+	if (cl->download.file) {
+		Sv_CloseDownload(cl->download.file);
 	}
 
 	ent = cl->entity;
@@ -339,11 +431,23 @@ static void Sv_Connect_f(void) {
 	g_strlcpy(client->user_info, user_info, sizeof(client->user_info));
 	Sv_UserInfoChanged(client);
 
+	// negotiate payload compression, which is pointless over loopback
+	const _Bool compress = net_compression->integer && addr->type != NA_LOOP &&
+	                       strtol(Cmd_Argv(5), NULL, 0) > 0;
+
 	// send the connect packet to the client
-	Netchan_OutOfBandPrint(NS_UDP_SERVER, addr, "client_connect %s", sv_download_url->string);
+	Netchan_OutOfBandPrint(NS_UDP_SERVER, addr, "client_connect %d %s", compress, sv_download_url->string);
+
+	if (client->state > SV_CLIENT_FREE) { // reconnecting, perhaps with a new qport
+		Sv_UnhashClientSlot(client);
+	}
 
 	Netchan_Setup(NS_UDP_SERVER, &client->net_chan, addr, qport);
 
+	client->net_chan.compress = compress;
+
+	Sv_HashClientSlot(client);
+
 	Mem_InitBuffer(&client->datagram.buffer, client->datagram.data, sizeof(client->datagram.data));
 	client->datagram.buffer.allow_overflow = true;
 
@@ -461,6 +565,42 @@ static void Sv_ConnectionlessPacket(void) {
 	}
 }
 
+/**
+ * @brief Applies a per-address rate limit to connectionless packets, so that a
+ * flood of challenge or info requests can not consume the server frame. Each
+ * address may send a burst of SV_RATE_LIMIT_BURST packets, and is then held to
+ * sv_connectionless_rate packets per second.
+ *
+ * @return True if the packet should be processed, false if it should be dropped.
+ */
+static _Bool Sv_AllowConnectionlessPacket(const net_addr_t *addr) {
+
+	if (addr->type == NA_LOOP || sv_connectionless_rate->value <= 0.0) {
+		return true;
+	}
+
+	const uint32_t interval = Max(1000.0 / sv_connectionless_rate->value, 1.0);
+	const uint32_t burst = interval * (SV_RATE_LIMIT_BURST - 1);
+
+	uint32_t hash = (uint32_t) addr->addr * 2654435761u;
+	hash = (hash ^ (hash >> 16)) & (SV_RATE_LIMIT_BUCKETS - 1);
+
+	sv_rate_limit_t *limit = &svs.rate_limits[hash];
+
+	// colliding addresses share the bucket, so that they can not evict one another
+	if ((int32_t) (limit->arrival_time - quetoo.ticks) < 0) {
+		limit->arrival_time = quetoo.ticks;
+	}
+
+	if (limit->arrival_time - quetoo.ticks > burst) {
+		Com_Debug(DEBUG_SERVER, "Rate limited connectionless packet from %s\n", Net_NetaddrToString(addr));
+		return false;
+	}
+
+	limit->arrival_time += interval;
+	return true;
+}
+
 /**
  * @brief Updates the "ping" times for all spawned clients.
  */
@@ -547,7 +687,9 @@ static void Sv_ReadPackets(void) {
 
 		// check for connectionless packet (0xffffffff) first
 		if (*(uint32_t *) net_message.data == 0xffffffff) {
-			Sv_ConnectionlessPacket();
+			if (Sv_AllowConnectionlessPacket(&net_from)) {
+				Sv_ConnectionlessPacket();
+			}
 			continue;
 		}
 
@@ -561,34 +703,20 @@ static void Sv_ReadPackets(void) {
 		const byte qport = Net_ReadByte(&net_message) & 0xff;
 
 		// check for packets from connected clients
-		sv_client_t *cl = svs.clients;
-		for (int32_t i = 0; i < sv_max_clients->integer; i++, cl++) {
-
-			if (cl->state == SV_CLIENT_FREE) {
-				continue;
-			}
-
-			if (!Net_CompareClientNetaddr(&net_from, &cl->net_chan.remote_address)) {
-				continue;
-			}
-
-			if (cl->net_chan.qport != qport) {
-				continue;
-			}
-
-			if (cl->net_chan.remote_address.port != net_from.port) {
-				cl->net_chan.remote_address.port = net_from.port;
-				Com_Warn("Fixed translated port for %s\n", Net_NetaddrToString(&net_from));
-			}
+		sv_client_t *cl = Sv_FindClient(&net_from, qport);
+		if (cl == NULL) {
+			continue;
+		}
 
-			// this is a valid, sequenced packet, so process it
-			if (Netchan_Process(&cl->net_chan, &net_message)) {
-				cl->last_message = quetoo.ticks; // nudge timeout
-				Sv_ParseClientMessage(cl);
-			}
+		if (cl->net_chan.remote_address.port != net_from.port) {
+			cl->net_chan.remote_address.port = net_from.port;
+			Com_Warn("Fixed translated port for %s\n", Net_NetaddrToString(&net_from));
+		}
 
-			// we've processed the packet for the correct client, so break
-			break;
+		// this is a valid, sequenced packet, so process it
+		if (Netchan_Process(&cl->net_chan, &net_message)) {
+			cl->last_message = quetoo.ticks; // nudge timeout
+			Sv_ParseClientMessage(cl);
 		}
 	}
 }
@@ -741,11 +869,66 @@ void Sv_UserInfoChanged(sv_client_t *cl) {
 	}
 }
 
+/**
+ * @brief Blocks the dedicated server until the next tick boundary, reading
+ * packets as they arrive so that client input is processed promptly. Tick
+ * boundaries are absolute, so that scheduling latency does not accumulate.
+ * Their interval is scaled by time_scale, as is `msec` for listen servers.
+ *
+ * @param read_packets Receives the time, in performance counter units, spent
+ * reading packets while waiting, so that it may be profiled with the tick.
+ *
+ * @return The simulation time, in milliseconds, that has elapsed.
+ */
+static uint32_t Sv_WaitForTick(uint64_t *read_packets) {
+	static uint64_t deadline;
+
+	const uint64_t tick = (uint64_t) (QUETOO_TICK_MILLIS * 1000000.0 / time_scale->value);
+
+	uint64_t now = Net_Nanoseconds();
+	if (deadline == 0) {
+		deadline = now + tick;
+	}
+
+	uint32_t wakeups = 0;
+
+	while (now < deadline) {
+		if (Net_Wait(NS_UDP_SERVER, deadline)) {
+			quetoo.ticks = SDL_GetTicks();
+
+			const uint64_t start = Sv_ProfileBegin();
+
+			Sv_ReadPackets();
+
+			*read_packets += Sv_ProfileBegin() - start;
+			wakeups++;
+		}
+
+		now = Net_Nanoseconds();
+	}
+
+	quetoo.ticks = SDL_GetTicks();
+
+	Sv_ProfileSample(SV_PROFILE_TICK_JITTER, (uint32_t) Min((now - deadline) / 1000, (uint64_t) UINT32_MAX));
+	Sv_ProfileCount(SV_PROFILE_WAKEUPS, wakeups);
+
+	// if ticks were missed, run them now, and resume on the original schedule
+	const uint64_t ticks = Min(1 + (now - deadline) / tick, (uint64_t) QUETOO_TICK_RATE);
+
+	deadline += ticks * tick;
+	if (deadline <= now) {
+		deadline = now + tick;
+	}
+
+	return (uint32_t) ticks * QUETOO_TICK_MILLIS;
+}
+
 /**
  * @brief
  */
 void Sv_Frame(const uint32_t msec) {
 	static uint32_t frame_delta;
+	uint64_t read_packets = 0;
 
 	// if server is not active, do nothing
 	if (!svs.initialized) {
@@ -754,15 +937,13 @@ void Sv_Frame(const uint32_t msec) {
 
 	if (time_demo->value) { // always run a frame
 		frame_delta = QUETOO_TICK_MILLIS;
+	} else if (dedicated->value) { // wait for the next tick boundary
+		frame_delta = Sv_WaitForTick(&read_packets);
 	} else { // keep simulation time in sync with reality
 
 		frame_delta += msec;
 
 		if (frame_delta < QUETOO_TICK_MILLIS) {
-			if (dedicated->value) {
-				SDL_Delay(QUETOO_TICK_MILLIS - frame_delta);
-			}
-
 			return;
 		}
 	}
@@ -770,9 +951,19 @@ void Sv_Frame(const uint32_t msec) {
 	// clamp the frame interval to 1 second of simulation
 	frame_delta = Min(frame_delta, (uint32_t) (QUETOO_TICK_MILLIS * QUETOO_TICK_RATE));
 
+	const uint64_t frame_start = Sv_ProfileBegin();
+
+	// queue outgoing datagrams so that they are sent together
+	Net_BeginBatch(NS_UDP_SERVER);
+
 	// read any pending packets from clients
 	Sv_ReadPackets();
 
+	// including those read while waiting for the tick, as a single sample
+	Sv_ProfileEnd(SV_PROFILE_READ_PACKETS, frame_start - read_packets);
+
+	const uint64_t housekeeping_start = Sv_ProfileBegin();
+
 	// check timeouts
 	Sv_CheckTimeouts();
 
@@ -785,15 +976,25 @@ void Sv_Frame(const uint32_t msec) {
 	// send a heartbeat to the master if needed
 	Sv_HeartbeatMasters();
 
+	Sv_ProfileEnd(SV_PROFILE_HOUSEKEEPING, housekeeping_start);
+
 	// let everything in the world think and move
 	while (frame_delta >= QUETOO_TICK_MILLIS) {
 
 		// run the simulation
+		const uint64_t game_start = Sv_ProfileBegin();
+
 		Sv_RunGameFrame();
 
+		Sv_ProfileEnd(SV_PROFILE_GAME, game_start);
+
 		// send the resulting frame to connected clients
+		const uint64_t send_start = Sv_ProfileBegin();
+
 		Sv_SendClientPackets();
 
+		Sv_ProfileEnd(SV_PROFILE_SEND, send_start);
+
 		// decrement the simulation time
 		frame_delta -= QUETOO_TICK_MILLIS;
 	}
@@ -801,6 +1002,12 @@ void Sv_Frame(const uint32_t msec) {
 	// clear entity flags, etc for next frame
 	Sv_ResetEntities();
 
+	// and send this frame's datagrams
+	Net_EndBatch(NS_UDP_SERVER);
+
+	Sv_ProfileEnd(SV_PROFILE_FRAME, frame_start);
+	Sv_ProfileFrame();
+
 	// redraw the console
 	Sv_DrawConsole();
 }
@@ -810,6 +1017,8 @@ void Sv_Frame(const uint32_t msec) {
  */
 static void Sv_InitLocal(void) {
 
+	sv_connectionless_rate = Cvar_Add("sv_connectionless_rate", "10", 0,
+	                                  "The connectionless packets per second accepted from a single address, 0 to disable");
 	sv_demo_list = Cvar_Add("sv_demo_list", "", CVAR_SERVER_INFO,
 	                        "A list of demo names to cycle through");
 	sv_download_url = Cvar_Add("sv_download_url", "", CVAR_SERVER_INFO,
@@ -829,6 +1038,8 @@ static void Sv_InitLocal(void) {
 	sv_timeout = Cvar_Add("sv_timeout", va("%d", SV_TIMEOUT), 0, NULL);
 	sv_udp_download = Cvar_Add("sv_udp_download", "1", CVAR_ARCHIVE,
 	                           "If set, in-game UDP downloads will be allowed when HTTP downloads fail");
+	sv_vis_cache = Cvar_Add("sv_vis_cache", "64", CVAR_LATCH,
+	                        "The memory budget in megabytes for decompressed visibility, 0 to disable");
 
 	if (dedicated->value) {
 		Cvar_SetInteger(sv_public->name, 1);
@@ -853,6 +1064,8 @@ void Sv_Init(void) {
 
 	Sv_InitAdmin();
 
+	Sv_InitProfile();
+
 	Sv_InitMasters();
 }
 
@@ -31,6 +31,7 @@ void Sv_Frame(const uint32_t msec);
 // cvars
 extern cvar_t *sv_demo_list;
 extern cvar_t *sv_download_url;
+extern cvar_t *sv_connectionless_rate;
 extern cvar_t *sv_enforce_time;
 extern cvar_t *sv_hostname;
 extern cvar_t *sv_max_clients;
@@ -39,6 +40,7 @@ extern cvar_t *sv_public;
 extern cvar_t *sv_rcon_password;
 extern cvar_t *sv_timeout;
 extern cvar_t *sv_udp_download;
+extern cvar_t *sv_vis_cache;
 
 // per-level and static server structures
 extern sv_server_t sv;
@@ -0,0 +1,343 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "sv_local.h"
+
+/**
+ * @brief The number of samples retained per series, about 25 seconds of ticks.
+ */
+#define SV_PROFILE_SAMPLES 1024
+
+/**
+ * @brief Sample units, for reporting.
+ */
+typedef enum {
+	SV_PROFILE_USEC,
+	SV_PROFILE_COUNT,
+	SV_PROFILE_BYTES
+} sv_profile_unit_t;
+
+/**
+ * @brief A profiled series retains a ring of recent samples, from which its
+ * percentiles are computed on demand. Timers and counters accumulate over the
+ * course of a tick, and are sampled once per tick by Sv_ProfileFrame.
+ */
+typedef struct {
+	char name[32];
+	sv_profile_unit_t unit;
+	_Bool per_frame; // accumulate and sample once per tick
+
+	uint32_t accum;
+	uint32_t samples[SV_PROFILE_SAMPLES];
+	uint32_t num_samples;
+	uint32_t max;
+} sv_profile_t;
+
+/**
+ * @brief The server tick profiler.
+ */
+static struct {
+	sv_profile_t series[SV_PROFILE_MAX_SERIES];
+	int32_t num_series;
+
+	uint64_t frequency;
+	uint32_t over_budget;
+} sv_profile;
+
+/**
+ * @return A timestamp for Sv_ProfileEnd.
+ */
+uint64_t Sv_ProfileBegin(void) {
+	return SDL_GetPerformanceCounter();
+}
+
+/**
+ * @brief Appends a sample to the series ring.
+ */
+static void Sv_ProfileAppend(sv_profile_t *p, const uint32_t value) {
+
+	p->samples[p->num_samples % SV_PROFILE_SAMPLES] = value;
+	p->num_samples++;
+
+	if (value > p->max) {
+		p->max = value;
+	}
+}
+
+/**
+ * @brief Accumulates the time elapsed since `start` into the series.
+ */
+void Sv_ProfileEnd(const sv_profile_series_t series, const uint64_t start) {
+
+	const uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+	sv_profile.series[series].accum += (uint32_t) (elapsed * 1000000 / sv_profile.frequency);
+}
+
+/**
+ * @brief Accumulates a count into the series.
+ */
+void Sv_ProfileCount(const sv_profile_series_t series, const uint32_t count) {
+	sv_profile.series[series].accum += count;
+}
+
+/**
+ * @brief Records an individual sample, such as a client's encoded frame size.
+ */
+void Sv_ProfileSample(const sv_profile_series_t series, const uint32_t value) {
+	Sv_ProfileAppend(&sv_profile.series[series], value);
+}
+
+/**
+ * @brief Accumulates the time elapsed since `start` into the series of the
+ * given name, allocating it if necessary. This is exposed to the game module.
+ */
+void Sv_ProfileEndNamed(const char *name, const uint64_t start) {
+
+	int32_t i;
+	for (i = SV_PROFILE_GAME_SERIES; i < sv_profile.num_series; i++) {
+		if (!g_strcmp0(sv_profile.series[i].name, name)) {
+			break;
+		}
+	}
+
+	if (i == sv_profile.num_series) {
+		if (i == SV_PROFILE_MAX_SERIES) {
+			return;
+		}
+
+		sv_profile_t *p = &sv_profile.series[i];
+		memset(p, 0, sizeof(*p));
+
+		g_strlcpy(p->name, name, sizeof(p->name));
+		p->unit = SV_PROFILE_USEC;
+		p->per_frame = true;
+
+		sv_profile.num_series++;
+	}
+
+	Sv_ProfileEnd(i, start);
+}
+
+/**
+ * @brief Samples the per-tick series. Called once at the end of each tick.
+ */
+void Sv_ProfileFrame(void) {
+
+	for (int32_t i = 0; i < sv_profile.num_series; i++) {
+		sv_profile_t *p = &sv_profile.series[i];
+
+		if (p->per_frame) {
+			Sv_ProfileAppend(p, p->accum);
+			p->accum = 0;
+		}
+	}
+
+	const sv_profile_t *frame = &sv_profile.series[SV_PROFILE_FRAME];
+	if (frame->samples[(frame->num_samples - 1) % SV_PROFILE_SAMPLES] > QUETOO_TICK_MILLIS * 1000) {
+		sv_profile.over_budget++;
+	}
+}
+
+/**
+ * @brief qsort comparator for samples.
+ */
+static int32_t Sv_ProfileCompare(const void *a, const void *b) {
+
+	const uint32_t x = *(const uint32_t *) a;
+	const uint32_t y = *(const uint32_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Resolves the median and 99th percentile of the retained samples.
+ *
+ * @return The number of retained samples.
+ */
+static uint32_t Sv_ProfilePercentiles(const sv_profile_t *p, uint32_t *p50, uint32_t *p99) {
+	uint32_t sorted[SV_PROFILE_SAMPLES];
+
+	const uint32_t n = p->num_samples < SV_PROFILE_SAMPLES ? p->num_samples : SV_PROFILE_SAMPLES;
+	if (n == 0) {
+		*p50 = *p99 = 0;
+		return 0;
+	}
+
+	memcpy(sorted, p->samples, n * sizeof(uint32_t));
+	qsort(sorted, n, sizeof(uint32_t), Sv_ProfileCompare);
+
+	*p50 = sorted[n / 2];
+	*p99 = sorted[(n * 99) / 100];
+
+	return n;
+}
+
+/**
+ * @brief Resets all series.
+ */
+static void Sv_ProfileReset(void) {
+
+	for (int32_t i = 0; i < sv_profile.num_series; i++) {
+		sv_profile_t *p = &sv_profile.series[i];
+
+		p->accum = 0;
+		p->num_samples = 0;
+		p->max = 0;
+	}
+
+	sv_profile.over_budget = 0;
+}
+
+/**
+ * @brief Writes every retained sample to the specified file, one series per
+ * line, for offline analysis.
+ */
+static void Sv_ProfileDump(const char *filename) {
+
+	file_t *file = Fs_OpenWrite(filename);
+	if (!file) {
+		Com_Warn("Couldn't open %s\n", filename);
+		return;
+	}
+
+	static const char *units[] = { "usec", "count", "bytes" };
+
+	for (int32_t i = 0; i < sv_profile.num_series; i++) {
+		const sv_profile_t *p = &sv_profile.series[i];
+
+		Fs_Print(file, "%s,%s", p->name, units[p->unit]);
+
+		const uint32_t n = p->num_samples < SV_PROFILE_SAMPLES ? p->num_samples : SV_PROFILE_SAMPLES;
+		for (uint32_t j = p->num_samples - n; j < p->num_samples; j++) {
+			Fs_Print(file, ",%u", p->samples[j % SV_PROFILE_SAMPLES]);
+		}
+
+		Fs_Print(file, "\n");
+	}
+
+	Fs_Close(file);
+
+	Com_Print("Wrote %s\n", filename);
+}
+
+/**
+ * @brief Prints the profiler summary, or resets or dumps it.
+ */
+static void Sv_Profile_f(void) {
+
+	if (Cmd_Argc() > 1) {
+		if (!g_strcmp0(Cmd_Argv(1), "reset")) {
+			Sv_ProfileReset();
+			return;
+		}
+
+		if (!g_strcmp0(Cmd_Argv(1), "dump")) {
+			Sv_ProfileDump(Cmd_Argc() > 2 ? Cmd_Argv(2) : "profile.csv");
+			return;
+		}
+
+		Com_Print("Usage: %s [reset | dump [filename]]\n", Cmd_Argv(0));
+		return;
+	}
+
+	static const char *units[] = { "us", "", "b" };
+
+	Com_Print("series               p50     p99     max\n");
+	Com_Print("---------------- ------- ------- -------\n");
+
+	for (int32_t i = 0; i < sv_profile.num_series; i++) {
+		const sv_profile_t *p = &sv_profile.series[i];
+
+		uint32_t p50, p99;
+		if (Sv_ProfilePercentiles(p, &p50, &p99) == 0) {
+			continue;
+		}
+
+		const char *u = units[p->unit];
+		Com_Print("%-16s %5u%-2s %5u%-2s %5u%-2s\n", p->name, p50, u, p99, u, p->max, u);
+	}
+
+	Com_Print("%u ticks over %ums budget\n", sv_profile.over_budget, QUETOO_TICK_MILLIS);
+
+	if (!svs.initialized) {
+		return;
+	}
+
+	const sv_client_t *cl = svs.clients;
+	for (int32_t i = 0; i < sv_max_clients->integer; i++, cl++) {
+
+		if (cl->state != SV_CLIENT_ACTIVE) {
+			continue;
+		}
+
+		size_t bytes = 0;
+		for (size_t j = 0; j < lengthof(cl->frame_size); j++) {
+			bytes += cl->frame_size[j];
+		}
+
+		const net_chan_t *chan = &cl->net_chan;
+
+		if (chan->compress && chan->compress_packets) {
+			Com_Print("%3d %-16s %6u b/s %5.1f%% deflated %6.1fusec/packet\n", i, cl->name, (uint32_t) bytes,
+			          100.0 * chan->compress_bytes_out / Max(chan->compress_bytes_in, 1),
+			          1000000.0 * chan->compress_time / sv_profile.frequency / chan->compress_packets);
+		} else {
+			Com_Print("%3d %-16s %6u b/s\n", i, cl->name, (uint32_t) bytes);
+		}
+	}
+}
+
+/**
+ * @brief
+ */
+void Sv_InitProfile(void) {
+
+	memset(&sv_profile, 0, sizeof(sv_profile));
+
+	sv_profile.frequency = SDL_GetPerformanceFrequency();
+
+	const struct {
+		const char *name;
+		sv_profile_unit_t unit;
+		_Bool per_frame;
+	} series[] = {
+		[SV_PROFILE_FRAME] = { "frame", SV_PROFILE_USEC, true },
+		[SV_PROFILE_READ_PACKETS] = { "read_packets", SV_PROFILE_USEC, true },
+		[SV_PROFILE_HOUSEKEEPING] = { "housekeeping", SV_PROFILE_USEC, true },
+		[SV_PROFILE_GAME] = { "game", SV_PROFILE_USEC, true },
+		[SV_PROFILE_SEND] = { "send", SV_PROFILE_USEC, true },
+		[SV_PROFILE_TRACES] = { "traces", SV_PROFILE_COUNT, true },
+		[SV_PROFILE_CLIENT_BYTES] = { "client_bytes", SV_PROFILE_BYTES, false },
+		[SV_PROFILE_TICK_JITTER] = { "tick_jitter", SV_PROFILE_USEC, false },
+		[SV_PROFILE_WAKEUPS] = { "wakeups", SV_PROFILE_COUNT, true },
+	};
+
+	for (size_t i = 0; i < lengthof(series); i++) {
+		g_strlcpy(sv_profile.series[i].name, series[i].name, sizeof(sv_profile.series[i].name));
+		sv_profile.series[i].unit = series[i].unit;
+		sv_profile.series[i].per_frame = series[i].per_frame;
+	}
+
+	sv_profile.num_series = SV_PROFILE_GAME_SERIES;
+
+	Cmd_Add("sv_profile", Sv_Profile_f, CMD_SERVER,
+	        "Print server tick timings, or reset or dump them to a file");
+}
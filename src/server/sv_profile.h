@@ -0,0 +1,54 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include "sv_types.h"
+
+#ifdef __SV_LOCAL_H__
+
+/**
+ * @brief The series recorded by the server tick profiler. Series named by the
+ * game module are allocated from SV_PROFILE_GAME_SERIES onward.
+ */
+typedef enum {
+	SV_PROFILE_FRAME,
+	SV_PROFILE_READ_PACKETS,
+	SV_PROFILE_HOUSEKEEPING,
+	SV_PROFILE_GAME,
+	SV_PROFILE_SEND,
+	SV_PROFILE_TRACES,
+	SV_PROFILE_CLIENT_BYTES,
+	SV_PROFILE_TICK_JITTER,
+	SV_PROFILE_WAKEUPS,
+	SV_PROFILE_GAME_SERIES,
+	SV_PROFILE_MAX_SERIES = 32
+} sv_profile_series_t;
+
+uint64_t Sv_ProfileBegin(void);
+void Sv_ProfileEnd(const sv_profile_series_t series, const uint64_t start);
+void Sv_ProfileCount(const sv_profile_series_t series, const uint32_t count);
+void Sv_ProfileSample(const sv_profile_series_t series, const uint32_t value);
+void Sv_ProfileEndNamed(const char *name, const uint64_t start);
+void Sv_ProfileFrame(void);
+void Sv_InitProfile(void);
+
+#endif /* __SV_LOCAL_H__ */
@@ -178,7 +178,8 @@ void Sv_Unicast(const g_entity_t *ent, const _Bool reliable) {
  * then clears sv.multicast.
  */
 void Sv_Multicast(const vec3_t origin, multicast_t to, EntityFilterFunc filter) {
-	byte vis[MAX_BSP_LEAFS >> 3];
+	byte scratch[MAX_BSP_LEAFS >> 3];
+	const byte *vis = NULL;
 	int32_t area;
 
 	if (!origin) {
@@ -192,7 +193,6 @@ void Sv_Multicast(const vec3_t origin, multicast_t to, EntityFilterFunc filter)
 			reliable = true;
                         /* FALLTHRU */
 		case MULTICAST_ALL:
-			memset(vis, 1, sizeof(vis));
 			area = 0;
 			break;
 
@@ -202,7 +202,7 @@ void Sv_Multicast(const vec3_t origin, multicast_t to, EntityFilterFunc filter)
 		case MULTICAST_PHS: {
 				const int32_t leaf = Cm_PointLeafnum(origin, 0);
 				const int32_t cluster = Cm_LeafCluster(leaf);
-				Cm_ClusterPHS(cluster, vis);
+				vis = Cm_ClusterPHSRow(cluster, scratch);
 				area = Cm_LeafArea(leaf);
 			}
 
@@ -214,7 +214,7 @@ void Sv_Multicast(const vec3_t origin, multicast_t to, EntityFilterFunc filter)
 		case MULTICAST_PVS: {
 				const int32_t leaf = Cm_PointLeafnum(origin, 0);
 				const int32_t cluster = Cm_LeafCluster(leaf);
-				Cm_ClusterPVS(cluster, vis);
+				vis = Cm_ClusterPVSRow(cluster, scratch);
 				area = Cm_LeafArea(leaf);
 			}
 			break;
@@ -349,6 +349,27 @@ void Sv_PositionedSound(const vec3_t origin, const g_entity_t *ent, const uint16
 	}
 }
 
+/**
+ * @brief Builds and delta compresses the frames for a range of clients. This is
+ * called from Thread_ParallelFor, and must only touch per-client state.
+ */
+static void Sv_WriteClientFrames(int32_t begin, int32_t end, void *data) {
+
+	sv_client_t **clients = (sv_client_t **) data;
+
+	for (int32_t i = begin; i < end; i++) {
+		sv_client_t *cl = clients[i];
+
+		Sv_BuildClientFrame(cl);
+
+		Mem_InitBuffer(&cl->frame_message, cl->frame_message_buffer, sizeof(cl->frame_message_buffer));
+		cl->frame_message.allow_overflow = true;
+
+		// send over all the relevant entity_state_t and the player_state_t
+		Sv_WriteClientFrame(cl, &cl->frame_message);
+	}
+}
+
 /**
  * @brief
  */
@@ -356,23 +377,20 @@ static void Sv_SendClientDatagram(sv_client_t *cl) {
 	byte buffer[MAX_MSG_SIZE];
 	mem_buf_t buf;
 
-	Sv_BuildClientFrame(cl);
+	// the frame itself (player state and delta entities) must fit into a single message,
+	// since it is parsed as a single command by the client
+	if (cl->frame_message.overflowed || cl->frame_message.size > MAX_MSG_SIZE - 16) {
+		Com_Error(ERROR_DROP, "Frame exceeds MAX_MSG_SIZE (%u)\n", (uint32_t) cl->frame_message.size);
+	}
 
 	Mem_InitBuffer(&buf, buffer, sizeof(buffer));
 	buf.allow_overflow = true;
 
+	Mem_WriteBuffer(&buf, cl->frame_message.data, cl->frame_message.size);
+
 	// accumulate the total size for rate throttling
 	size_t frame_size = 0;
 
-	// send over all the relevant entity_state_t and the player_state_t
-	Sv_WriteClientFrame(cl, &buf);
-
-	// the frame itself (player state and delta entities) must fit into a single message,
-	// since it is parsed as a single command by the client
-	if (buf.overflowed || buf.size > MAX_MSG_SIZE - 16) {
-		Com_Error(ERROR_DROP, "Frame exceeds MAX_MSG_SIZE (%u)\n", (uint32_t) buf.size);
-	}
-
 	// but we can packetize the remaining datagram messages, which are parsed individually
 	const GList *e = cl->datagram.messages;
 	while (e) {
@@ -382,8 +400,7 @@ static void Sv_SendClientDatagram(sv_client_t *cl) {
 		if (buf.size + msg->len > (MAX_MSG_SIZE - 16)) {
 			Com_Debug(DEBUG_SERVER, "Fragmenting datagram @ %u bytes\n", (uint32_t) buf.size);
 
-			Netchan_Transmit(&cl->net_chan, buf.data, buf.size);
-			frame_size += buf.size;
+			frame_size += Netchan_Transmit(&cl->net_chan, buf.data, buf.size);
 
 			Mem_ClearBuffer(&buf);
 		}
@@ -393,11 +410,12 @@ static void Sv_SendClientDatagram(sv_client_t *cl) {
 	}
 
 	// send the pending packet, which may include reliable messages
-	Netchan_Transmit(&cl->net_chan, buf.data, buf.size);
-	frame_size += buf.size;
+	frame_size += Netchan_Transmit(&cl->net_chan, buf.data, buf.size);
 
-	// record the total size for rate estimation
+	// record the total size, as sent, for rate estimation
 	cl->frame_size[sv.frame_num % QUETOO_TICK_RATE] = frame_size;
+
+	Sv_ProfileSample(SV_PROFILE_CLIENT_BYTES, (uint32_t) frame_size);
 }
 
 /**
@@ -527,6 +545,36 @@ void Sv_SendClientPackets(void) {
 		return;
 	}
 
+	// resolve which clients will receive a frame, enforcing rate throttle
+	sv_client_t *pending[MAX_CLIENTS];
+	int32_t num_pending = 0;
+
+	for (i = 0, cl = svs.clients; i < sv_max_clients->integer; i++, cl++) {
+
+		cl->frame_pending = false;
+
+		if (sv.state == SV_ACTIVE_DEMO || cl->state != SV_CLIENT_ACTIVE) {
+			continue;
+		}
+
+		if (cl->net_chan.message.overflowed) {
+			continue;
+		}
+
+		if (Sv_RateDrop(cl)) {
+			cl->frame_size[sv.frame_num % lengthof(cl->frame_size)] = 0;
+		} else {
+			cl->frame_pending = true;
+			pending[num_pending++] = cl;
+		}
+	}
+
+	// build and delta compress the pending frames across the thread pool
+	if (num_pending) {
+		Sv_FixEntityNumbers();
+		Thread_ParallelFor(0, num_pending, 1, Sv_WriteClientFrames, pending);
+	}
+
 	// send a message to each connected client
 	for (i = 0, cl = svs.clients; i < sv_max_clients->integer; i++, cl++) {
 
@@ -541,6 +589,9 @@ void Sv_SendClientPackets(void) {
 			continue;
 		}
 
+		// stream the next chunk of any download
+		Sv_SendDownload(cl);
+
 		if (sv.state == SV_ACTIVE_DEMO) { // send the demo packet
 			byte buffer[MAX_MSG_SIZE];
 			size_t size;
@@ -552,9 +603,7 @@ void Sv_SendClientPackets(void) {
 			}
 		} else if (cl->state == SV_CLIENT_ACTIVE) { // send the game packet
 
-			if (Sv_RateDrop(cl)) { // enforce rate throttle
-				cl->frame_size[sv.frame_num % lengthof(cl->frame_size)] = 0;
-			} else {
+			if (cl->frame_pending) {
 				Sv_SendClientDatagram(cl);
 			}
 
@@ -567,7 +616,7 @@ void Sv_SendClientPackets(void) {
 
 			cl->datagram.messages = NULL;
 
-		} else if (cl->net_chan.message.size) { // update reliable
+		} else if (Netchan_Pending(&cl->net_chan)) { // update reliable
 			Netchan_Transmit(&cl->net_chan, NULL, 0);
 		} else if (quetoo.ticks - cl->net_chan.last_sent > 1000) { // or just don't timeout
 			Netchan_Transmit(&cl->net_chan, NULL, 0);
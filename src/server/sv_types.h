@@ -52,8 +52,12 @@ typedef struct {
 	int32_t clusters[MAX_ENT_CLUSTERS];
 	int32_t num_clusters; // if -1, use top_node
 
+	uint16_t cluster_slots[MAX_ENT_CLUSTERS]; // positions within the cluster index
+	_Bool cluster_indexed;
+
 	int32_t areas[2];
 	struct sv_sector_s *sector;
+	uint16_t sector_slot;
 
 	matrix4x4_t matrix;
 	matrix4x4_t inverse_matrix;
@@ -158,17 +162,68 @@ typedef struct {
 	GList *messages; // message segmentation
 } sv_client_datagram_t;
 
+/**
+ * @brief Downloads are streamed from their files in blocks of this size.
+ */
+#define SV_DOWNLOAD_BLOCK_SIZE 0x10000
+
+/**
+ * @brief The number of blocks cached per download. Clients downloading the
+ * same file at roughly the same offset will share reads.
+ */
+#define SV_DOWNLOAD_BLOCKS 4
+
+/**
+ * @brief The minimum and maximum download chunk sizes, in bytes.
+ */
+#define SV_DOWNLOAD_CHUNK_MIN 512
+#define SV_DOWNLOAD_CHUNK_MAX 8192
+
+/**
+ * @brief A cached block of a download.
+ */
+typedef struct {
+	int64_t offset; // the file offset of the block, or -1
+	int32_t size;
+	uint32_t last_used;
+	byte data[SV_DOWNLOAD_BLOCK_SIZE];
+} sv_download_block_t;
+
+/**
+ * @brief A file being downloaded via UDP. The file is opened once and shared,
+ * by reference count, by all clients downloading it.
+ */
+typedef struct {
+	char name[MAX_QPATH];
+	file_t *file;
+	int64_t size;
+	int32_t refs;
+	uint32_t clock; // for least recently used block replacement
+	sv_download_block_t blocks[SV_DOWNLOAD_BLOCKS];
+} sv_download_t;
+
 /**
  * @brief Each client my download a single file at a time via the game's UDP
  * protocol. This only serves as a fallback for when HTTP downloading is not
  * configured or unavailable.
  */
 typedef struct {
-	byte *buffer;
-	int32_t size;
-	int32_t count;
+	sv_download_t *file; // the shared download, or NULL
+	int64_t count; // the number of bytes sent
+	int32_t chunk_size; // the number of bytes sent per frame
 } sv_client_download_t;
 
+/**
+ * @brief The last state of an entity known to have been received by a client.
+ * Entities re-entering the client's frame are delta compressed from this state
+ * rather than from their baseline.
+ */
+typedef struct {
+	entity_state_t state; // the entity's state in the acknowledged frame
+	int32_t frame_num; // the acknowledged frame, or -1
+	int32_t sent_frame; // the last frame in which the entity was sent
+} sv_known_entity_t;
+
 /**
  * @brief Per-client accounting for protocol flow control and low-level
  * connection state management.
@@ -201,6 +256,14 @@ typedef struct {
 
 	sv_frame_t frames[PACKET_BACKUP]; // updates can be delta'd from here
 
+	sv_known_entity_t known_entities[MAX_ENTITIES]; // re-entering entities are delta'd from here
+	int32_t known_frame_floor; // acknowledgements of frames before this are ignored
+
+	// the current frame, delta compressed, awaiting transmission
+	mem_buf_t frame_message;
+	byte frame_message_buffer[MAX_MSG_SIZE];
+	_Bool frame_pending;
+
 	sv_client_download_t download; // UDP file downloads
 
 	uint32_t last_message; // quetoo.ticks when packet was last received
@@ -230,6 +293,34 @@ typedef struct {
  */
 #define MAX_CHALLENGES 1024
 
+/**
+ * @brief Client slots are indexed by (address, qport) so that sequenced packets
+ * can be routed to their client without scanning every slot. The port is not
+ * part of the key, so translated ports may be fixed up without rehashing.
+ */
+#define SV_CLIENT_HASH_SIZE (MAX_CLIENTS * 4)
+
+/**
+ * @brief Connectionless packets are rate limited per source address. Each
+ * bucket tracks the theoretical arrival time of the next packet it will
+ * accept from the addresses hashed to it.
+ */
+typedef struct {
+	uint32_t arrival_time;
+} sv_rate_limit_t;
+
+/**
+ * @brief The number of connectionless rate limit buckets. Addresses that
+ * collide simply share a bucket.
+ */
+#define SV_RATE_LIMIT_BUCKETS 1024
+
+/**
+ * @brief The number of connectionless packets a single address may send in a
+ * burst before being held to sv_connectionless_rate.
+ */
+#define SV_RATE_LIMIT_BURST 10
+
 /**
  * @brief The sv_static_t structure is persistent for the execution of the
  * game. It is only cleared when Sv_Init is called. It is not exposed to the
@@ -248,8 +339,10 @@ typedef struct {
 	// the size of this array is based on the number of clients we might be
 	// asked to support at any point in time during the current game
 
+	// each client frame owns a reserved range of MAX_PACKET_ENTITIES states,
+	// so that client frames may be built concurrently
+
 	uint32_t num_entity_states; // sv_max_clients->integer * UPDATE_BACKUP * MAX_PACKET_ENTITIES
-	uint32_t next_entity_state; // next entity_state to use for newly spawned entities
 	entity_state_t *entity_states; // entity states array used for delta compression
 
 	net_addr_t masters[MAX_MASTERS];
@@ -257,6 +350,9 @@ typedef struct {
 
 	sv_challenge_t challenges[MAX_CHALLENGES]; // to prevent invalid IPs from connecting
 
+	uint8_t client_hash[SV_CLIENT_HASH_SIZE]; // client slot + 1 by (address, qport), 0 is empty
+	sv_rate_limit_t rate_limits[SV_RATE_LIMIT_BUCKETS]; // connectionless packet rate limits
+
 	g_export_t *game;
 	ai_export_t *ai;
 } sv_static_t;
@@ -22,19 +22,48 @@
 #include "sv_local.h"
 
 /**
- * @brief The world is divided into evenly sized sectors to aid in entity
- * management. This works like a meta-BSP tree, providing fast searches via
- * recursion to find entities within an arbitrary box.
+ * @brief A contiguous list of entity numbers. Entities record their slot in
+ * each list they occupy, so that removal is a constant-time swap.
+ */
+typedef struct {
+	uint16_t *entities;
+	uint16_t num_entities, max_entities;
+} sv_entity_list_t;
+
+/**
+ * @brief The world is divided into sectors to aid in entity management. This
+ * works like a meta-BSP tree, providing fast searches via recursion to find
+ * entities within an arbitrary box. The tree is seeded with a uniform split
+ * proportional to the world size, and crowded leafs are split further as
+ * entities are linked.
  */
 typedef struct sv_sector_s {
 	int32_t axis; // -1 = leaf
 	vec_t dist;
+	vec3_t mins, maxs;
 	struct sv_sector_s *children[2];
-	GList *entities;
+	sv_entity_list_t entities;
 } sv_sector_t;
 
-#define SECTOR_DEPTH	4
-#define SECTOR_NODES	32
+/**
+ * @brief The maximum number of sectors, including the seeded ones.
+ */
+#define SECTOR_NODES			1024
+
+/**
+ * @brief Seeded sectors are split until they are no larger than this.
+ */
+#define SECTOR_SEED_SIZE		2048.0
+
+/**
+ * @brief A leaf sector is split once it holds more than this many entities.
+ */
+#define SECTOR_SPLIT_ENTITIES	16
+
+/**
+ * @brief Sectors are never split below this size.
+ */
+#define SECTOR_MIN_SIZE			128.0
 
 /**
  * @brief The world structure contains all sectors and also the current query
@@ -50,44 +79,124 @@ typedef struct {
 	size_t num_box_entities, max_box_entities;
 
 	uint32_t box_type; // BOX_SOLID, BOX_TRIGGER, ..
+
+	sv_entity_list_t *clusters;
+	int32_t num_clusters;
+
+	sv_entity_list_t top_node_entities; // entities exceeding MAX_ENT_CLUSTERS
 } sv_world_t;
 
 static sv_world_t sv_world;
 
 /**
- * @brief Builds a uniformly subdivided tree for the given world size.
+ * @brief Appends the entity to the list, returning its slot.
+ */
+static uint16_t Sv_EntityListAppend(sv_entity_list_t *list, const uint16_t e) {
+
+	if (list->num_entities == list->max_entities) {
+		list->max_entities = list->max_entities ? list->max_entities * 2 : 8;
+		if (list->entities) {
+			list->entities = Mem_Realloc(list->entities, list->max_entities * sizeof(uint16_t));
+		} else {
+			list->entities = Mem_TagMalloc(list->max_entities * sizeof(uint16_t), MEM_TAG_SERVER);
+		}
+	}
+
+	list->entities[list->num_entities] = e;
+	return list->num_entities++;
+}
+
+/**
+ * @brief Removes the entity at the given slot by moving the list's last entity
+ * into its place.
+ *
+ * @return The number of the entity that now occupies `slot`, or 0 if none.
+ */
+static uint16_t Sv_EntityListRemove(sv_entity_list_t *list, const uint16_t slot) {
+
+	const uint16_t last = list->entities[--list->num_entities];
+	if (slot == list->num_entities) {
+		return 0;
+	}
+
+	list->entities[slot] = last;
+	return last;
+}
+
+/**
+ * @brief Creates a sector spanning the given bounds.
  */
-static sv_sector_t *Sv_CreateSector(int32_t depth, vec3_t mins, vec3_t maxs) {
-	vec3_t size, mins1, maxs1, mins2, maxs2;
+static sv_sector_t *Sv_AllocSector(const vec3_t mins, const vec3_t maxs) {
 
 	sv_sector_t *sector = &sv_world.sectors[sv_world.num_sectors];
 	sv_world.num_sectors++;
 
-	if (depth == SECTOR_DEPTH) {
-		sector->axis = -1;
-		sector->children[0] = sector->children[1] = NULL;
-		return sector;
+	sector->axis = -1;
+	sector->children[0] = sector->children[1] = NULL;
+
+	VectorCopy(mins, sector->mins);
+	VectorCopy(maxs, sector->maxs);
+
+	return sector;
+}
+
+/**
+ * @brief Splits the sector in half along its longest axis, creating two leafs.
+ *
+ * @return True if the sector was split, false if it is too small or the
+ * sectors are exhausted.
+ */
+static _Bool Sv_SplitSector(sv_sector_t *sector, const vec_t min_size) {
+	vec3_t size, mins, maxs;
+
+	if (sv_world.num_sectors + 2 > SECTOR_NODES) {
+		return false;
 	}
 
-	VectorSubtract(maxs, mins, size);
-	if (size[0] > size[1]) {
-		sector->axis = 0;
-	} else {
-		sector->axis = 1;
+	VectorSubtract(sector->maxs, sector->mins, size);
+
+	int32_t axis = 0;
+	if (size[1] > size[axis]) {
+		axis = 1;
+	}
+	if (size[2] > size[axis]) {
+		axis = 2;
 	}
 
-	sector->dist = 0.5 * (maxs[sector->axis] + mins[sector->axis]);
-	VectorCopy(mins, mins1);
-	VectorCopy(mins, mins2);
-	VectorCopy(maxs, maxs1);
-	VectorCopy(maxs, maxs2);
+	if (size[axis] * 0.5 < min_size) {
+		return false;
+	}
 
-	maxs1[sector->axis] = mins2[sector->axis] = sector->dist;
+	sector->axis = axis;
+	sector->dist = 0.5 * (sector->maxs[axis] + sector->mins[axis]);
 
-	sector->children[0] = Sv_CreateSector(depth + 1, mins2, maxs2);
-	sector->children[1] = Sv_CreateSector(depth + 1, mins1, maxs1);
+	VectorCopy(sector->mins, mins);
+	VectorCopy(sector->maxs, maxs);
 
-	return sector;
+	mins[axis] = sector->dist;
+	sector->children[0] = Sv_AllocSector(mins, sector->maxs);
+
+	maxs[axis] = sector->dist;
+	sector->children[1] = Sv_AllocSector(sector->mins, maxs);
+
+	return true;
+}
+
+/**
+ * @brief Seeds the sector tree by splitting uniformly until the sectors are no
+ * larger than SECTOR_SEED_SIZE, so that the initial depth scales with the
+ * world size.
+ */
+static void Sv_SeedSector(sv_sector_t *sector) {
+
+	if (sv_world.num_sectors >= SECTOR_NODES / 2) {
+		return; // reserve the remainder for refinement
+	}
+
+	if (Sv_SplitSector(sector, SECTOR_SEED_SIZE * 0.5)) {
+		Sv_SeedSector(sector->children[0]);
+		Sv_SeedSector(sector->children[1]);
+	}
 }
 
 /**
@@ -97,12 +206,215 @@ static sv_sector_t *Sv_CreateSector(int32_t depth, vec3_t mins, vec3_t maxs) {
 void Sv_InitWorld(void) {
 
 	for (uint16_t i = 0; i < sv_world.num_sectors; i++) {
-		g_list_free(sv_world.sectors[i].entities);
+		Mem_Free(sv_world.sectors[i].entities.entities);
 	}
 
+	for (int32_t i = 0; i < sv_world.num_clusters; i++) {
+		Mem_Free(sv_world.clusters[i].entities);
+	}
+
+	Mem_Free(sv_world.clusters);
+	Mem_Free(sv_world.top_node_entities.entities);
+
 	memset(&sv_world, 0, sizeof(sv_world));
 
-	Sv_CreateSector(0, sv.cm_models[0]->mins, sv.cm_models[0]->maxs);
+	Sv_SeedSector(Sv_AllocSector(sv.cm_models[0]->mins, sv.cm_models[0]->maxs));
+
+	sv_world.num_clusters = Cm_NumClusters();
+	sv_world.clusters = Mem_TagMalloc(sv_world.num_clusters * sizeof(sv_entity_list_t), MEM_TAG_SERVER);
+}
+
+/**
+ * @return The cluster index for the given cluster number, where -1 refers to
+ * the entities that must be resolved via their top_node.
+ */
+static sv_entity_list_t *Sv_Cluster(const int32_t cluster) {
+	return cluster == -1 ? &sv_world.top_node_entities : &sv_world.clusters[cluster];
+}
+
+/**
+ * @brief Appends the entity to the specified cluster, returning its slot.
+ */
+static uint16_t Sv_AddClusterEntity(const int32_t cluster, const uint16_t e) {
+	return Sv_EntityListAppend(Sv_Cluster(cluster), e);
+}
+
+/**
+ * @brief Removes the entity at the given slot of the specified cluster.
+ */
+static void Sv_RemoveClusterEntity(const int32_t cluster, const uint16_t slot) {
+
+	const uint16_t e = Sv_EntityListRemove(Sv_Cluster(cluster), slot);
+	if (e == 0) {
+		return;
+	}
+
+	sv_entity_t *moved = &sv.entities[e];
+	if (cluster == -1) {
+		moved->cluster_slots[0] = slot;
+	} else {
+		for (int32_t i = 0; i < moved->num_clusters; i++) {
+			if (moved->clusters[i] == cluster) {
+				moved->cluster_slots[i] = slot;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Adds the entity to the specified sector.
+ */
+static void Sv_AddSectorEntity(sv_sector_t *sector, const uint16_t e) {
+
+	sv_entity_t *sent = &sv.entities[e];
+
+	sent->sector = sector;
+	sent->sector_slot = Sv_EntityListAppend(&sector->entities, e);
+}
+
+/**
+ * @brief Removes the entity from its sector.
+ */
+static void Sv_RemoveSectorEntity(const uint16_t e) {
+
+	sv_entity_t *sent = &sv.entities[e];
+	sv_sector_t *sector = sent->sector;
+
+	const uint16_t moved = Sv_EntityListRemove(&sector->entities, sent->sector_slot);
+	if (moved) {
+		sv.entities[moved].sector_slot = sent->sector_slot;
+	}
+
+	sent->sector = NULL;
+}
+
+/**
+ * @return The deepest sector that entirely contains the given bounds.
+ */
+static sv_sector_t *Sv_SectorForBounds(sv_sector_t *sector, const vec3_t mins, const vec3_t maxs) {
+
+	while (sector->axis != -1) {
+
+		if (mins[sector->axis] > sector->dist) {
+			sector = sector->children[0];
+		} else if (maxs[sector->axis] < sector->dist) {
+			sector = sector->children[1];
+		} else {
+			break;    // crosses the node
+		}
+	}
+
+	return sector;
+}
+
+/**
+ * @brief Splits a crowded leaf sector, pushing the entities that fit entirely
+ * within either half down into it.
+ */
+static void Sv_RefineSector(sv_sector_t *sector) {
+
+	if (sector->axis != -1 || sector->entities.num_entities <= SECTOR_SPLIT_ENTITIES) {
+		return;
+	}
+
+	if (!Sv_SplitSector(sector, SECTOR_MIN_SIZE)) {
+		return;
+	}
+
+	for (uint16_t i = 0; i < sector->entities.num_entities;) {
+		const uint16_t e = sector->entities.entities[i];
+		const g_entity_t *ent = ENTITY_FOR_NUM(e);
+
+		sv_sector_t *child = Sv_SectorForBounds(sector, ent->abs_mins, ent->abs_maxs);
+		if (child == sector) {
+			i++;
+			continue;
+		}
+
+		Sv_RemoveSectorEntity(e);
+		Sv_AddSectorEntity(child, e);
+	}
+
+	Sv_RefineSector(sector->children[0]);
+	Sv_RefineSector(sector->children[1]);
+}
+
+/**
+ * @brief Adds the entity to the index of each cluster it occupies.
+ */
+static void Sv_IndexEntity(const uint16_t e) {
+
+	sv_entity_t *sent = &sv.entities[e];
+
+	if (sent->num_clusters == -1) {
+		sent->cluster_slots[0] = Sv_AddClusterEntity(-1, e);
+	} else {
+		for (int32_t i = 0; i < sent->num_clusters; i++) {
+			sent->cluster_slots[i] = Sv_AddClusterEntity(sent->clusters[i], e);
+		}
+	}
+
+	sent->cluster_indexed = true;
+}
+
+/**
+ * @brief Removes the entity from the cluster index.
+ */
+static void Sv_UnindexEntity(const uint16_t e) {
+
+	sv_entity_t *sent = &sv.entities[e];
+
+	if (!sent->cluster_indexed) {
+		return;
+	}
+
+	if (sent->num_clusters == -1) {
+		Sv_RemoveClusterEntity(-1, sent->cluster_slots[0]);
+	} else {
+		for (int32_t i = 0; i < sent->num_clusters; i++) {
+			Sv_RemoveClusterEntity(sent->clusters[i], sent->cluster_slots[i]);
+		}
+	}
+
+	sent->cluster_indexed = false;
+}
+
+/**
+ * @brief Marks in `entities` every entity occupying a cluster set in `vis`,
+ * along with every entity that must be resolved via its top_node. Entities
+ * are marked by number in a bit vector of `MAX_ENTITIES` bits.
+ */
+void Sv_ClusterEntities(const byte *vis, const size_t len, uint32_t *entities) {
+
+	const sv_entity_list_t *c = &sv_world.top_node_entities;
+	for (uint16_t i = 0; i < c->num_entities; i++) {
+		entities[c->entities[i] >> 5] |= 1u << (c->entities[i] & 31);
+	}
+
+	for (size_t i = 0; i < len; i++) {
+
+		if (vis[i] == 0) {
+			continue;
+		}
+
+		for (int32_t j = 0; j < 8; j++) {
+
+			if (!(vis[i] & (1 << j))) {
+				continue;
+			}
+
+			const int32_t cluster = (int32_t) (i << 3) + j;
+			if (cluster >= sv_world.num_clusters) {
+				break;
+			}
+
+			c = &sv_world.clusters[cluster];
+			for (uint16_t k = 0; k < c->num_entities; k++) {
+				entities[c->entities[k] >> 5] |= 1u << (c->entities[k] & 31);
+			}
+		}
+	}
 }
 
 /**
@@ -113,9 +425,10 @@ void Sv_UnlinkEntity(g_entity_t *ent) {
 
 	sv_entity_t *sent = &sv.entities[NUM_FOR_ENTITY(ent)];
 
+	Sv_UnindexEntity(NUM_FOR_ENTITY(ent));
+
 	if (sent->sector) {
-		sv_sector_t *sector = (sv_sector_t *) sent->sector;
-		sector->entities = g_list_remove(sector->entities, ent);
+		Sv_RemoveSectorEntity(NUM_FOR_ENTITY(ent));
 
 		memset(sent, 0, sizeof(*sent));
 	}
@@ -215,30 +528,18 @@ void Sv_LinkEntity(g_entity_t *ent) {
 		}
 	}
 
+	Sv_IndexEntity(NUM_FOR_ENTITY(ent));
+
 	if (ent->solid == SOLID_NOT) {
 		return;
 	}
 
 	// find the first sector that the ent's box crosses
-	sv_sector_t *sector = sv_world.sectors;
-	while (true) {
+	sv_sector_t *sector = Sv_SectorForBounds(sv_world.sectors, ent->abs_mins, ent->abs_maxs);
 
-		if (sector->axis == -1) {
-			break;
-		}
-
-		if (ent->abs_mins[sector->axis] > sector->dist) {
-			sector = sector->children[0];
-		} else if (ent->abs_maxs[sector->axis] < sector->dist) {
-			sector = sector->children[1];
-		} else {
-			break;    // crosses the node
-		}
-	}
-
-	// add it to the sector
-	sent->sector = sector;
-	sector->entities = g_list_prepend(sector->entities, ent);
+	// add it to the sector, splitting the sector if it has become crowded
+	Sv_AddSectorEntity(sector, NUM_FOR_ENTITY(ent));
+	Sv_RefineSector(sector);
 
 	// and update its clipping matrices
 	const vec_t *angles = ent->solid == SOLID_BSP ? ent->s.angles : vec3_origin;
@@ -280,9 +581,8 @@ static _Bool Sv_BoxEntities_Filter(const g_entity_t *ent) {
  */
 static void Sv_BoxEntities_r(sv_sector_t *sector) {
 
-	GList *e = sector->entities;
-	while (e) {
-		g_entity_t *ent = (g_entity_t *) e->data;
+	for (uint16_t i = 0; i < sector->entities.num_entities; i++) {
+		g_entity_t *ent = ENTITY_FOR_NUM(sector->entities.entities[i]);
 
 		if (Sv_BoxEntities_Filter(ent)) {
 
@@ -297,8 +597,6 @@ static void Sv_BoxEntities_r(sv_sector_t *sector) {
 				}
 			}
 		}
-
-		e = e->next;
 	}
 
 	if (sector->axis == -1) {
@@ -487,6 +785,8 @@ cm_trace_t Sv_Trace(const vec3_t start, const vec3_t end, const vec3_t mins, con
 
 	sv_trace_t trace;
 
+	Sv_ProfileCount(SV_PROFILE_TRACES, 1);
+
 	memset(&trace, 0, sizeof(trace));
 
 	if (!mins) {
@@ -0,0 +1,128 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <SDL2/SDL_timer.h>
+
+#include "tests.h"
+#include "cmodel.h"
+
+/*
+ * Compares the throughput of Cm_BoxTraceBatch against that of Cm_BoxTrace.
+ * This is not part of the check suite; run it by hand, optionally with the
+ * name of the map to trace against:
+ *
+ * ./bench_cm_trace [maps/torn.bsp]
+ */
+
+#define NUM_TRACES 0x40000
+#define NUM_RUNS 5
+
+static vec3_t starts[NUM_TRACES], ends[NUM_TRACES];
+static cm_trace_t traces[NUM_TRACES];
+
+/**
+ * @brief Generates coherent segments: fans of rays cast from random points in
+ * the world, as shotgun pellets or light samples would be.
+ */
+static void Bench_Generate(void) {
+
+	const cm_bsp_model_t *world = Cm_Model("*0");
+
+	for (int32_t i = 0; i < NUM_TRACES; i++) {
+
+		if ((i & 63) == 0) {
+			for (int32_t j = 0; j < 3; j++) {
+				starts[i][j] = world->mins[j] + Randomf() * (world->maxs[j] - world->mins[j]);
+			}
+		} else {
+			VectorCopy(starts[i - 1], starts[i]);
+		}
+
+		vec3_t dir;
+		VectorSet(dir, Randomc(), Randomc(), Randomc() * 0.25);
+		VectorNormalize(dir);
+
+		VectorMA(starts[i], 1024.0, dir, ends[i]);
+	}
+}
+
+/**
+ * @brief Traces all segments with both paths, printing the best throughput of each.
+ */
+static void Bench_Trace(const char *name, const vec3_t mins, const vec3_t maxs) {
+	uint64_t scalar = UINT64_MAX, batch = UINT64_MAX;
+
+	for (int32_t run = 0; run < NUM_RUNS; run++) {
+
+		uint64_t start = SDL_GetPerformanceCounter();
+
+		for (int32_t i = 0; i < NUM_TRACES; i++) {
+			traces[i] = Cm_BoxTrace(starts[i], ends[i], mins, maxs, 0, MASK_SOLID);
+		}
+
+		scalar = Min(scalar, SDL_GetPerformanceCounter() - start);
+
+		start = SDL_GetPerformanceCounter();
+
+		Cm_BoxTraceBatch((const vec3_t *) starts, (const vec3_t *) ends, NUM_TRACES, mins, maxs, 0,
+		                 MASK_SOLID, traces);
+
+		batch = Min(batch, SDL_GetPerformanceCounter() - start);
+	}
+
+	const double freq = (double) SDL_GetPerformanceFrequency();
+
+	const double scalar_rate = NUM_TRACES * freq / Max(scalar, (uint64_t) 1);
+	const double batch_rate = NUM_TRACES * freq / Max(batch, (uint64_t) 1);
+
+	printf("%-6s Cm_BoxTrace: %10.0f rays/sec, Cm_BoxTraceBatch: %10.0f rays/sec (%.2fx)\n",
+	       name, scalar_rate, batch_rate, batch_rate / scalar_rate);
+}
+
+/**
+ * @brief Program entry point.
+ */
+int32_t main(int32_t argc, char **argv) {
+
+	Test_Init(argc, argv);
+
+	Mem_Init();
+
+	Fs_Init(FS_AUTO_LOAD_ARCHIVES);
+
+	const char *map = argc > 1 ? argv[1] : "maps/torn.bsp";
+
+	Cm_LoadBspModel(map, NULL);
+
+	Bench_Generate();
+
+	Bench_Trace("point", vec3_origin, vec3_origin);
+	Bench_Trace("box", (const vec3_t) { -16.0, -16.0, -24.0 }, (const vec3_t) { 16.0, 16.0, 32.0 });
+
+	Cm_LoadBspModel(NULL, NULL);
+
+	Fs_Shutdown();
+
+	Mem_Shutdown();
+
+	Test_Shutdown();
+	return 0;
+}
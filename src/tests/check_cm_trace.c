@@ -0,0 +1,187 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tests.h"
+#include "cmodel.h"
+
+#define NUM_TRACES 0x10000
+
+static vec3_t starts[NUM_TRACES], ends[NUM_TRACES];
+static cm_trace_t traces[NUM_TRACES], batch_traces[NUM_TRACES];
+
+/**
+ * @brief Setup fixture.
+ */
+void setup(void) {
+
+	Mem_Init();
+
+	Fs_Init(FS_AUTO_LOAD_ARCHIVES);
+
+	Cm_LoadBspModel("maps/torn.bsp", NULL);
+}
+
+/**
+ * @brief Teardown fixture.
+ */
+void teardown(void) {
+
+	Cm_LoadBspModel(NULL, NULL);
+
+	Fs_Shutdown();
+
+	Mem_Shutdown();
+}
+
+/**
+ * @brief Generates coherent segments: fans of rays cast from random points in
+ * the world, as shotgun pellets or light samples would be.
+ */
+static void generate(void) {
+
+	const cm_bsp_model_t *world = Cm_Model("*0");
+
+	for (int32_t i = 0; i < NUM_TRACES; i++) {
+
+		if ((i & 63) == 0) {
+			for (int32_t j = 0; j < 3; j++) {
+				starts[i][j] = world->mins[j] + Randomf() * (world->maxs[j] - world->mins[j]);
+			}
+		} else {
+			VectorCopy(starts[i - 1], starts[i]);
+		}
+
+		vec3_t dir;
+		VectorSet(dir, Randomc(), Randomc(), Randomc() * 0.25);
+		VectorNormalize(dir);
+
+		VectorMA(starts[i], 1024.0, dir, ends[i]);
+	}
+}
+
+/**
+ * @brief Generates segments lying exactly on axial node planes, as hitscan
+ * traces along floors and walls would, which must be classified front only.
+ */
+static void generate_on_plane(void) {
+
+	const cm_bsp_t *bsp = Cm_Bsp();
+	const cm_bsp_model_t *world = Cm_Model("*0");
+
+	int32_t num_axial = 0;
+	for (int32_t i = 0; i < bsp->bsp.num_nodes; i++) {
+		if (AXIAL(bsp->nodes[i].plane)) {
+			num_axial++;
+		}
+	}
+
+	ck_assert_int_gt(num_axial, 0);
+
+	for (int32_t i = 0; i < NUM_TRACES; i++) {
+
+		int32_t n = Random() % num_axial;
+
+		const cm_bsp_plane_t *plane = NULL;
+		for (int32_t j = 0; j < bsp->bsp.num_nodes; j++) {
+			if (AXIAL(bsp->nodes[j].plane) && n-- == 0) {
+				plane = bsp->nodes[j].plane;
+				break;
+			}
+		}
+
+		for (int32_t j = 0; j < 3; j++) {
+			starts[i][j] = world->mins[j] + Randomf() * (world->maxs[j] - world->mins[j]);
+		}
+
+		vec3_t dir;
+		VectorSet(dir, Randomc(), Randomc(), Randomc());
+
+		starts[i][plane->type] = plane->dist;
+		dir[plane->type] = 0.0;
+
+		VectorNormalize(dir);
+		VectorMA(starts[i], 1024.0, dir, ends[i]);
+
+		ends[i][plane->type] = plane->dist;
+	}
+}
+
+/**
+ * @brief Traces all segments with both paths, asserting that they agree.
+ */
+static void trace(const vec3_t mins, const vec3_t maxs) {
+
+	for (int32_t i = 0; i < NUM_TRACES; i++) {
+		traces[i] = Cm_BoxTrace(starts[i], ends[i], mins, maxs, 0, MASK_SOLID);
+	}
+
+	Cm_BoxTraceBatch((const vec3_t *) starts, (const vec3_t *) ends, NUM_TRACES, mins, maxs, 0,
+	                 MASK_SOLID, batch_traces);
+
+	for (int32_t i = 0; i < NUM_TRACES; i++) {
+		ck_assert_msg(memcmp(&traces[i], &batch_traces[i], sizeof(cm_trace_t)) == 0,
+		              "Trace %d differs", i);
+	}
+}
+
+START_TEST(check_Cm_BoxTraceBatch_point) {
+	generate();
+
+	trace(vec3_origin, vec3_origin);
+}
+END_TEST
+
+START_TEST(check_Cm_BoxTraceBatch_on_plane) {
+	generate_on_plane();
+
+	trace(vec3_origin, vec3_origin);
+}
+END_TEST
+
+START_TEST(check_Cm_BoxTraceBatch_box) {
+	generate();
+
+	trace((const vec3_t) { -16.0, -16.0, -24.0 }, (const vec3_t) { 16.0, 16.0, 32.0 });
+}
+END_TEST
+
+/**
+ * @brief Test entry point.
+ */
+int32_t main(int32_t argc, char **argv) {
+
+	Test_Init(argc, argv);
+
+	TCase *tcase = tcase_create("check_cm_trace");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+
+	tcase_add_test(tcase, check_Cm_BoxTraceBatch_point);
+	tcase_add_test(tcase, check_Cm_BoxTraceBatch_on_plane);
+	tcase_add_test(tcase, check_Cm_BoxTraceBatch_box);
+
+	Suite *suite = suite_create("check_cm_trace");
+	suite_add_tcase(suite, tcase);
+
+	int32_t failed = Test_Run(suite);
+
+	Test_Shutdown();
+	return failed;
+}
@@ -72,6 +72,50 @@ START_TEST(check_Mem_CopyString) {
 }
 END_TEST
 
+START_TEST(check_Mem_Arena) {
+	mem_arena_t *arena = Mem_ArenaCreate(64, MEM_TAG_DEFAULT);
+
+	const size_t size = Mem_Size();
+
+	byte *a = Mem_ArenaAlloc(arena, 1);
+	byte *b = Mem_ArenaAlloc(arena, 1);
+
+	ck_assert(a != b);
+	ck_assert((((uintptr_t) a) & 15) == 0);
+	ck_assert((((uintptr_t) b) & 15) == 0);
+
+	const size_t chunk_size = Mem_Size();
+	ck_assert(chunk_size > size);
+
+	Mem_ArenaAlloc(arena, 1024);
+	ck_assert(Mem_Size() > chunk_size);
+
+	const size_t total_size = Mem_Size();
+
+	Mem_ArenaReset(arena);
+
+	ck_assert(Mem_ArenaAlloc(arena, 1) == a);
+	ck_assert_str_eq(Mem_ArenaCopyString(arena, "test"), "test");
+	ck_assert(Mem_Size() == total_size);
+
+	Mem_Free(arena);
+
+	ck_assert(Mem_Size() == 0);
+}
+END_TEST
+
+START_TEST(check_Mem_FrameMalloc) {
+	byte *a = Mem_FrameMalloc(1);
+
+	ck_assert(Mem_FrameMalloc(1) != a);
+
+	Mem_ResetFrame();
+
+	ck_assert(Mem_FrameMalloc(1) == a);
+	ck_assert_str_eq(Mem_FrameCopyString("test"), "test");
+}
+END_TEST
+
 /**
  * @brief Test entry point.
  */
@@ -84,6 +128,8 @@ int32_t main(int32_t argc, char **argv) {
 
 	tcase_add_test(tcase, check_Mem_LinkMalloc);
 	tcase_add_test(tcase, check_Mem_CopyString);
+	tcase_add_test(tcase, check_Mem_Arena);
+	tcase_add_test(tcase, check_Mem_FrameMalloc);
 
 	Suite *suite = suite_create("check_mem");
 	suite_add_tcase(suite, tcase);
@@ -0,0 +1,308 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tests.h"
+#include "net.h"
+#include "net_message.h"
+
+#define NUM_FRAMES 400
+#define NUM_ENTITIES 160
+
+static byte buffer[MAX_MSG_SIZE];
+static mem_buf_t msg;
+
+/**
+ * @brief Setup fixture.
+ */
+void setup(void) {
+
+	Mem_Init();
+
+	Mem_InitBuffer(&msg, buffer, sizeof(buffer));
+}
+
+/**
+ * @brief Teardown fixture.
+ */
+void teardown(void) {
+
+	Mem_Shutdown();
+}
+
+/**
+ * @return The size of the specified delta in the byte-aligned encoding of
+ * protocol 1023, for comparison.
+ */
+static size_t legacy_size(const entity_state_t *from, const entity_state_t *to) {
+	size_t size = 4;
+
+	if (!VectorCompare(from->origin, to->origin)) {
+		size += 12;
+	}
+	if (!VectorCompare(from->termination, to->termination)) {
+		size += 12;
+	}
+	if (!VectorCompare(from->angles, to->angles)) {
+		size += 6;
+	}
+	if (from->animation1 != to->animation1 || from->animation2 != to->animation2) {
+		size += 2;
+	}
+	if (to->event) {
+		size += 1;
+	}
+	if (from->effects != to->effects) {
+		size += 2;
+	}
+	if (from->model1 != to->model1 || from->model2 != to->model2 ||
+	        from->model3 != to->model3 || from->model4 != to->model4) {
+		size += 4;
+	}
+
+	return size;
+}
+
+START_TEST(check_Net_WriteBits) {
+	net_bit_stream_t stream;
+
+	Net_BeginBitStream(&stream, &msg);
+
+	for (uint32_t i = 0; i < 1000; i++) {
+		Net_WriteBits(&stream, i * 2654435761u, (i % 32) + 1);
+		Net_WriteBitsVar(&stream, i * i * i);
+		Net_WriteBitsSigned(&stream, (int32_t) (i * 7919) - 4000000);
+	}
+
+	Net_WriteBits(&stream, 1, 1);
+	Net_FlushBits(&stream);
+
+	Net_WriteByte(&msg, 0xaa);
+
+	Net_BeginReading(&msg);
+	Net_BeginBitStream(&stream, &msg);
+
+	for (uint32_t i = 0; i < 1000; i++) {
+		const uint32_t n = (i % 32) + 1;
+		const uint32_t mask = n == 32 ? 0xffffffff : (1u << n) - 1;
+
+		ck_assert_uint_eq(Net_ReadBits(&stream, n), (i * 2654435761u) & mask);
+		ck_assert_uint_eq(Net_ReadBitsVar(&stream), i * i * i);
+		ck_assert_int_eq(Net_ReadBitsSigned(&stream), (int32_t) (i * 7919) - 4000000);
+	}
+
+	ck_assert_uint_eq(Net_ReadBits(&stream, 1), 1);
+
+	ck_assert_int_eq(Net_ReadByte(&msg), 0xaa);
+	ck_assert_uint_eq(msg.read, msg.size);
+}
+END_TEST
+
+START_TEST(check_Net_WriteDeltaEntity) {
+	static entity_state_t baselines[NUM_ENTITIES], server[2][NUM_ENTITIES], client[NUM_ENTITIES];
+	static vec3_t velocities[NUM_ENTITIES];
+	size_t bytes = 0, legacy = 0;
+
+	for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+		entity_state_t *e = &baselines[i];
+
+		e->number = i;
+		VectorSet(e->origin, Randomc() * MAX_WORLD_COORD, Randomc() * MAX_WORLD_COORD, Randomc() * 1024.0);
+		e->model1 = Random() & 0xff;
+
+		VectorSet(velocities[i], Randomc() * 400.0, Randomc() * 400.0, Randomc() * 100.0);
+
+		server[0][i] = *e;
+	}
+
+	// the client receives the baselines through the protocol, just as it would from the server
+	for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+		static entity_state_t null_state;
+		net_bit_stream_t stream;
+
+		Mem_ClearBuffer(&msg);
+
+		Net_BeginBitStream(&stream, &msg);
+		Net_WriteDeltaEntity(&stream, &null_state, &baselines[i], true);
+		Net_FlushBits(&stream);
+
+		Net_BeginReading(&msg);
+		Net_BeginBitStream(&stream, &msg);
+
+		const uint16_t number = Net_ReadEntityNumber(&stream);
+		ck_assert_int_eq(number, i);
+
+		Net_ReadDeltaEntity(&stream, &null_state, &client[i], number, Net_ReadEntityBits(&stream));
+	}
+
+	for (int32_t frame = 1; frame <= NUM_FRAMES; frame++) {
+		entity_state_t *from = server[(frame - 1) & 1], *to = server[frame & 1];
+
+		// move everything, as players, projectiles and items in a busy game would
+		for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+			to[i] = from[i];
+
+			if (i & 3) {
+				VectorMA(from[i].origin, QUETOO_TICK_SECONDS, velocities[i], to[i].origin);
+				to[i].angles[YAW] = ClampAngle(from[i].angles[YAW] + Randomc() * 10.0);
+				to[i].angles[PITCH] = Randomc() * 45.0;
+			}
+
+			if ((Random() & 15) == 0) {
+				to[i].animation1 = Random() & 0xff;
+				to[i].event = Random() & 0xff;
+			} else {
+				to[i].event = 0;
+			}
+		}
+
+		Mem_ClearBuffer(&msg);
+
+		net_bit_stream_t stream;
+		Net_BeginBitStream(&stream, &msg);
+
+		for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+			Net_WriteDeltaEntity(&stream, &from[i], &to[i], false);
+			legacy += legacy_size(&from[i], &to[i]);
+		}
+
+		Net_WriteEndOfEntities(&stream);
+		Net_FlushBits(&stream);
+
+		legacy += 2;
+		bytes += msg.size;
+
+		// events are not delta compressed, so unchanged entities have none
+		for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+			client[i].event = 0;
+		}
+
+		Net_BeginReading(&msg);
+		Net_BeginBitStream(&stream, &msg);
+
+		uint16_t number;
+		while ((number = Net_ReadEntityNumber(&stream))) {
+			const uint16_t bits = Net_ReadEntityBits(&stream);
+
+			entity_state_t state;
+			Net_ReadDeltaEntity(&stream, &client[number], &state, number, bits);
+
+			client[number] = state;
+		}
+
+		ck_assert_uint_eq(msg.read, msg.size);
+
+		for (uint16_t i = 1; i < NUM_ENTITIES; i++) {
+			for (int32_t j = 0; j < 3; j++) {
+				ck_assert_msg(fabs(client[i].origin[j] - to[i].origin[j]) <= 1.0 / 16.0,
+				              "Entity %d origin drifted on frame %d", i, frame);
+
+				const vec_t angle = fabs(ClampAngle(client[i].angles[j]) - ClampAngle(to[i].angles[j]));
+				ck_assert_msg(Min(angle, 360.0 - angle) <= 360.0 / 4096.0,
+				              "Entity %d angles drifted on frame %d", i, frame);
+			}
+
+			ck_assert_int_eq(client[i].animation1, to[i].animation1);
+			ck_assert_int_eq(client[i].event, to[i].event);
+			ck_assert_int_eq(client[i].model1, to[i].model1);
+		}
+	}
+
+	// the bit-packed encoding is smaller than that of protocol 1023
+	ck_assert(bytes < legacy);
+}
+END_TEST
+
+START_TEST(check_Net_WriteKnownDeltaEntity) {
+	static entity_state_t null_state;
+	entity_state_t baseline = null_state, known, to, state;
+	net_bit_stream_t stream;
+
+	baseline.number = 42;
+	VectorSet(baseline.origin, 1024.0, -512.0, 64.0);
+	baseline.model1 = 7;
+
+	known = baseline;
+	VectorSet(known.origin, 1280.5, -700.25, 96.0);
+	known.angles[YAW] = 90.0;
+
+	to = known;
+	to.origin[0] += 4.0;
+
+	Mem_ClearBuffer(&msg);
+
+	Net_BeginBitStream(&stream, &msg);
+	Net_WriteKnownDeltaEntity(&stream, &known, &to, 12);
+	Net_WriteEndOfEntities(&stream);
+	Net_FlushBits(&stream);
+
+	const size_t known_size = msg.size;
+
+	Net_BeginReading(&msg);
+	Net_BeginBitStream(&stream, &msg);
+
+	ck_assert_int_eq(Net_ReadEntityNumber(&stream), 42);
+
+	const uint16_t bits = Net_ReadEntityBits(&stream);
+	ck_assert(bits & U_KNOWN);
+	ck_assert_uint_eq(Net_ReadEntityAge(&stream), 12);
+
+	Net_ReadDeltaEntity(&stream, &known, &state, 42, bits);
+	ck_assert_int_eq(Net_ReadEntityNumber(&stream), 0);
+	ck_assert_uint_eq(msg.read, msg.size);
+
+	ck_assert(VectorCompare(state.origin, to.origin));
+	ck_assert(VectorCompare(state.angles, to.angles));
+	ck_assert_int_eq(state.model1, to.model1);
+
+	// the same update from the baseline is larger
+	Mem_ClearBuffer(&msg);
+
+	Net_BeginBitStream(&stream, &msg);
+	Net_WriteDeltaEntity(&stream, &baseline, &to, true);
+	Net_WriteEndOfEntities(&stream);
+	Net_FlushBits(&stream);
+
+	ck_assert(known_size < msg.size);
+}
+END_TEST
+
+/**
+ * @brief Test entry point.
+ */
+int32_t main(int32_t argc, char **argv) {
+
+	Test_Init(argc, argv);
+
+	TCase *tcase = tcase_create("check_net_message");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+
+	tcase_add_test(tcase, check_Net_WriteBits);
+	tcase_add_test(tcase, check_Net_WriteDeltaEntity);
+	tcase_add_test(tcase, check_Net_WriteKnownDeltaEntity);
+
+	Suite *suite = suite_create("check_net_message");
+	suite_add_tcase(suite, tcase);
+
+	int32_t failed = Test_Run(suite);
+
+	Test_Shutdown();
+	return failed;
+}
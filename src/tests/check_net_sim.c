@@ -0,0 +1,308 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tests.h"
+#include "cmd.h"
+#include "cvar.h"
+#include "net_sim.h"
+
+#define NUM_DATAGRAMS 400
+
+static byte buffer[MAX_MSG_SIZE];
+static mem_buf_t buf;
+
+static net_addr_t from, to;
+
+/**
+ * @brief Setup fixture.
+ */
+void setup(void) {
+
+	Mem_Init();
+
+	Fs_Init(FS_NONE);
+
+	Cmd_Init();
+
+	Cvar_Init();
+
+	Net_InitSim();
+
+	Mem_InitBuffer(&buf, buffer, sizeof(buffer));
+
+	memset(&to, 0, sizeof(to));
+
+	to.type = NA_DATAGRAM;
+	to.addr = htonl(INADDR_LOOPBACK);
+	to.port = htons(PORT_SERVER);
+
+	quetoo.ticks = 0;
+
+	// the simulator variables are developer tools, and must be forced
+	Cvar_ForceSetInteger("net_sim", 1 << NS_UDP_CLIENT);
+}
+
+/**
+ * @brief Teardown fixture.
+ */
+void teardown(void) {
+
+	Net_ShutdownSim();
+
+	Cvar_Shutdown();
+
+	Cmd_Shutdown();
+
+	Fs_Shutdown();
+
+	Mem_Shutdown();
+}
+
+/**
+ * @brief Impairs the client's inbound datagrams with latency, jitter, bursts of
+ * loss and reordering.
+ */
+static void impair(void) {
+
+	Cvar_ForceSetValue("net_sim_latency", 100.0);
+	Cvar_ForceSetValue("net_sim_jitter", 50.0);
+	Cvar_ForceSetValue("net_sim_loss", 0.1);
+	Cvar_ForceSetValue("net_sim_burst", 2.0);
+	Cvar_ForceSetValue("net_sim_reorder", 0.1);
+}
+
+/**
+ * @brief Receives a numbered datagram each frame, recording the sequence and
+ * time in which the simulator releases them.
+ * @return The number of datagrams released.
+ */
+static size_t receive(uint32_t *sequence, uint32_t *times) {
+	size_t count = 0;
+
+	for (uint32_t i = 0; i < NUM_DATAGRAMS + 100; i++) {
+
+		ck_assert(Net_SimActive(NS_UDP_CLIENT));
+
+		if (i < NUM_DATAGRAMS) {
+			Net_SimEnqueue(NS_UDP_CLIENT, NET_SIM_IN, &to, &i, sizeof(i));
+		}
+
+		while (Net_SimDequeue(NS_UDP_CLIENT, NET_SIM_IN, &from, &buf)) {
+			ck_assert_uint_eq(buf.size, sizeof(uint32_t));
+			ck_assert_uint_eq(from.port, to.port);
+
+			Net_SimCapture(NS_UDP_CLIENT, NET_SIM_IN, &from, buf.data, buf.size);
+
+			memcpy(&sequence[count], buf.data, sizeof(uint32_t));
+			if (times) {
+				times[count] = quetoo.ticks;
+			}
+			count++;
+		}
+
+		quetoo.ticks += QUETOO_TICK_MILLIS;
+	}
+
+	return count;
+}
+
+START_TEST(check_Net_SimSeed) {
+	static uint32_t a[NUM_DATAGRAMS], b[NUM_DATAGRAMS], c[NUM_DATAGRAMS];
+
+	impair();
+
+	const size_t num_a = receive(a, NULL);
+
+	Cvar_ForceSetInteger("net_sim_seed", 2);
+	const size_t num_b = receive(b, NULL);
+
+	Cvar_ForceSetInteger("net_sim_seed", 1);
+	const size_t num_c = receive(c, NULL);
+
+	// the same seed reproduces the same conditions, and another does not
+	ck_assert_uint_eq(num_a, num_c);
+	ck_assert(memcmp(a, c, num_a * sizeof(uint32_t)) == 0);
+
+	ck_assert(num_a != num_b || memcmp(a, b, num_a * sizeof(uint32_t)) != 0);
+
+	// and those conditions lost and reordered datagrams
+	ck_assert(num_a < NUM_DATAGRAMS);
+
+	size_t reordered = 0;
+	for (size_t i = 1; i < num_a; i++) {
+		if (a[i] < a[i - 1]) {
+			reordered++;
+		}
+	}
+
+	ck_assert(reordered > 0);
+}
+END_TEST
+
+START_TEST(check_Net_SimLoss) {
+	const uint32_t count = 100000;
+
+	Cvar_ForceSetValue("net_sim_loss", 0.05);
+	Cvar_ForceSetValue("net_sim_burst", 4.0);
+
+	ck_assert(Net_SimActive(NS_UDP_CLIENT));
+
+	uint32_t lost = 0, bursts = 0;
+	_Bool burst = false;
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		Net_SimEnqueue(NS_UDP_CLIENT, NET_SIM_IN, &to, &i, sizeof(i));
+
+		if (Net_SimDequeue(NS_UDP_CLIENT, NET_SIM_IN, &from, &buf)) {
+			burst = false;
+		} else {
+			if (!burst) {
+				bursts++;
+			}
+			burst = true;
+			lost++;
+		}
+	}
+
+	// bursts of 4 datagrams on average begin once in every 20 that are delivered,
+	// and the datagram which ends each burst is delivered, so 4 in 24 are lost
+	const double length = lost / (double) bursts;
+	ck_assert_msg(length > 3.8 && length < 4.2, "Mean burst length was %f", length);
+
+	const double rate = lost / (double) count;
+	ck_assert_msg(rate > 0.155 && rate < 0.18, "Loss rate was %f", rate);
+}
+END_TEST
+
+START_TEST(check_Net_SimBandwidth) {
+	byte data[500];
+
+	Cvar_ForceSetValue("net_sim_bandwidth", 10000.0);
+
+	ck_assert(Net_SimActive(NS_UDP_CLIENT));
+
+	memset(data, 0, sizeof(data));
+
+	quetoo.ticks = 1000;
+
+	for (int32_t i = 0; i < 100; i++) {
+		Net_SimEnqueue(NS_UDP_CLIENT, NET_SIM_IN, &to, data, sizeof(data));
+	}
+
+	// each datagram occupies the link for 50 milliseconds, and those which would
+	// wait in its buffer for more than a second are dropped
+	uint32_t released = 0;
+
+	for (uint32_t time = 0; time <= 2000; time++) {
+
+		quetoo.ticks = 1000 + time;
+
+		while (Net_SimDequeue(NS_UDP_CLIENT, NET_SIM_IN, &from, &buf)) {
+			released++;
+
+			ck_assert_uint_eq(buf.size, sizeof(data));
+			ck_assert_uint_eq(time, released * 50);
+		}
+	}
+
+	ck_assert_uint_eq(released, 21);
+}
+END_TEST
+
+START_TEST(check_Net_SimReplay) {
+	static uint32_t sequence[NUM_DATAGRAMS], times[NUM_DATAGRAMS];
+
+	impair();
+
+	Cmd_ExecuteString("net_capture client check_net_sim.pcap");
+
+	// outbound datagrams are captured, but are not replayed
+	for (uint32_t i = 0; i < 10; i++) {
+		Net_SimCapture(NS_UDP_CLIENT, NET_SIM_OUT, &to, &i, sizeof(i));
+	}
+
+	const uint32_t first = quetoo.ticks;
+	const size_t count = receive(sequence, times);
+
+	Cmd_ExecuteString("net_capture client");
+
+	ck_assert(count > 0);
+
+	Cvar_ForceSetInteger("net_sim", 0);
+
+	quetoo.ticks += 1000;
+
+	Cmd_ExecuteString("net_replay client check_net_sim.pcap");
+
+	ck_assert(Net_SimReplaying(NS_UDP_CLIENT));
+
+	// the inbound datagrams are delivered again, in order, with their original timing
+	const uint32_t start = quetoo.ticks;
+	size_t replayed = 0;
+
+	while (Net_SimReplaying(NS_UDP_CLIENT)) {
+
+		while (Net_SimReplay(NS_UDP_CLIENT, &from, &buf)) {
+			ck_assert(replayed < count);
+
+			ck_assert_uint_eq(buf.size, sizeof(uint32_t));
+			ck_assert(memcmp(buf.data, &sequence[replayed], sizeof(uint32_t)) == 0);
+
+			ck_assert_uint_eq(from.addr, to.addr);
+			ck_assert_uint_eq(from.port, to.port);
+
+			ck_assert_uint_eq(quetoo.ticks - start, times[replayed] - first);
+			replayed++;
+		}
+
+		quetoo.ticks++;
+
+		ck_assert(quetoo.ticks - start < 60000);
+	}
+
+	ck_assert_uint_eq(replayed, count);
+}
+END_TEST
+
+/**
+ * @brief Test entry point.
+ */
+int32_t main(int32_t argc, char **argv) {
+
+	Test_Init(argc, argv);
+
+	TCase *tcase = tcase_create("check_net_sim");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+
+	tcase_add_test(tcase, check_Net_SimSeed);
+	tcase_add_test(tcase, check_Net_SimLoss);
+	tcase_add_test(tcase, check_Net_SimBandwidth);
+	tcase_add_test(tcase, check_Net_SimReplay);
+
+	Suite *suite = suite_create("check_net_sim");
+	suite_add_tcase(suite, tcase);
+
+	int32_t failed = Test_Run(suite);
+
+	Test_Shutdown();
+	return failed;
+}
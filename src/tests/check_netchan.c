@@ -0,0 +1,286 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tests.h"
+#include "cmd.h"
+#include "cvar.h"
+#include "net_chan.h"
+#include "net_sim.h"
+
+#define MAX_STEPS 5000
+
+/**
+ * @brief The reliable messages sent, in bytes. Their total exceeds the send
+ * window, and the largest spans nearly all of it, so that the message after
+ * it must wait for the window to have room.
+ */
+static const size_t message_sizes[] = {
+	1, 1500, 30000, 12000, 700, NET_FRAGMENT_SIZE, 2048, 5000, 3
+};
+
+static byte stream[64 * 1024], received[64 * 1024];
+static size_t stream_size, received_size;
+
+static net_chan_t client, server;
+
+/**
+ * @brief The datagrams passed through the simulator in each direction, and the
+ * greatest sequence number delivered, by which reordering is detected.
+ */
+static struct {
+	uint32_t sent, delivered;
+	uint32_t sequence;
+} links[NS_UDP_SERVER + 1];
+
+static uint32_t reordered;
+
+/**
+ * @brief Setup fixture.
+ */
+void setup(void) {
+
+	Mem_Init();
+
+	Fs_Init(FS_NONE);
+
+	Cmd_Init();
+
+	Cvar_Init();
+
+	Netchan_Init();
+
+	// registers the loopback impairment variables, which default to none, and
+	// closes the socket again, lest it release the simulated datagrams itself
+	Net_Config(NS_UDP_CLIENT, true);
+	Net_Config(NS_UDP_CLIENT, false);
+
+	// instead, the loopback datagrams are impaired by the simulator, whose
+	// conditions are reproducible for its seed
+	Cvar_ForceSetInteger("net_sim", (1 << NS_UDP_CLIENT) | (1 << NS_UDP_SERVER));
+	Cvar_ForceSetValue("net_sim_latency", 60.0);
+	Cvar_ForceSetValue("net_sim_jitter", 30.0);
+	Cvar_ForceSetValue("net_sim_loss", 0.1);
+	Cvar_ForceSetValue("net_sim_burst", 2.0);
+	Cvar_ForceSetValue("net_sim_reorder", 0.1);
+
+	net_addr_t addr = { .type = NA_LOOP };
+
+	Netchan_Setup(NS_UDP_CLIENT, &client, &addr, 42);
+	Netchan_Setup(NS_UDP_SERVER, &server, &addr, 42);
+
+	stream_size = received_size = 0;
+	reordered = 0;
+
+	memset(links, 0, sizeof(links));
+}
+
+/**
+ * @brief Teardown fixture.
+ */
+void teardown(void) {
+
+	Netchan_Shutdown();
+
+	Cvar_Shutdown();
+
+	Cmd_Shutdown();
+
+	Fs_Shutdown();
+
+	Mem_Shutdown();
+}
+
+/**
+ * @brief Processes a datagram on the channel, collecting the reliable bytes the
+ * server delivers. No unreliable data is sent, so they are the entire payload.
+ */
+static void process(net_chan_t *chan, mem_buf_t *msg) {
+
+	if (!Netchan_Process(chan, msg)) {
+		return;
+	}
+
+	if (chan == &server) {
+		const size_t len = msg->size - msg->read;
+
+		ck_assert_msg(received_size + len <= stream_size, "Delivered more than was sent");
+		memcpy(received + received_size, msg->data + msg->read, len);
+
+		received_size += len;
+	}
+}
+
+/**
+ * @brief Passes the datagrams pending for the channel through the simulator,
+ * and delivers those which it releases.
+ */
+static void deliver(net_src_t source, net_chan_t *chan) {
+	net_addr_t from;
+
+	ck_assert(Net_SimActive(source));
+
+	while (Net_ReceiveDatagram(source, &from, &net_message)) {
+		Net_SimEnqueue(source, NET_SIM_IN, &from, net_message.data, net_message.size);
+		links[source].sent++;
+	}
+
+	while (Net_SimDequeue(source, NET_SIM_IN, &from, &net_message)) {
+		links[source].delivered++;
+
+		// the sequence number leads each datagram, with the reliable flag in its high bit
+		const uint32_t sequence = Net_ReadLong(&net_message) & ~(1u << 31);
+
+		if (sequence < links[source].sequence) {
+			reordered++;
+		} else {
+			links[source].sequence = sequence;
+		}
+
+		process(chan, &net_message);
+	}
+}
+
+/**
+ * @brief Sends the reliable messages from the client to the server, asserting
+ * that they arrive intact, exactly once, and in order.
+ */
+static void transfer(void) {
+	byte unreliable[1];
+	size_t num_messages = 0;
+	_Bool deferred = false;
+
+	for (int32_t step = 0; step < MAX_STEPS; step++) {
+
+		quetoo.ticks += QUETOO_TICK_MILLIS;
+
+		// stage the next message as soon as the previous one has been queued
+		if (num_messages < lengthof(message_sizes) && client.message.size == 0) {
+			const size_t size = message_sizes[num_messages++];
+
+			for (size_t i = 0; i < size; i++) {
+				stream[stream_size + i] = (byte) ((stream_size + i) * 2654435761u >> 24);
+			}
+
+			Mem_WriteBuffer(&client.message, stream + stream_size, size);
+			stream_size += size;
+		}
+
+		Netchan_Transmit(&client, unreliable, 0);
+
+		// the message waits for the window to have room for all of it
+		if (client.message.size) {
+			deferred = true;
+		}
+
+		deliver(NS_UDP_SERVER, &server);
+
+		Netchan_Transmit(&server, unreliable, 0);
+
+		deliver(NS_UDP_CLIENT, &client);
+
+		if (num_messages == lengthof(message_sizes) && received_size == stream_size) {
+			break;
+		}
+	}
+
+	ck_assert_uint_eq(received_size, stream_size);
+	ck_assert_msg(memcmp(received, stream, stream_size) == 0, "Reliable stream corrupted");
+
+	ck_assert(stream_size > 40 * 1024);
+	ck_assert(deferred);
+
+	// once acknowledged, nothing is delivered again
+	for (int32_t step = 0; step < 100; step++) {
+
+		quetoo.ticks += QUETOO_TICK_MILLIS;
+
+		Netchan_Transmit(&client, unreliable, 0);
+		deliver(NS_UDP_SERVER, &server);
+
+		Netchan_Transmit(&server, unreliable, 0);
+		deliver(NS_UDP_CLIENT, &client);
+	}
+
+	ck_assert_uint_eq(received_size, stream_size);
+	ck_assert_uint_eq(client.reliable_acknowledged, client.reliable_outgoing);
+
+	// release what remains in flight, so that only the lost datagrams are missing
+	quetoo.ticks += 1000;
+
+	deliver(NS_UDP_SERVER, &server);
+	deliver(NS_UDP_CLIENT, &client);
+
+	for (size_t i = 0; i < lengthof(links); i++) {
+		ck_assert(links[i].delivered < links[i].sent);
+	}
+
+	ck_assert(reordered > 0);
+}
+
+START_TEST(check_Netchan_Reliable) {
+	transfer();
+}
+END_TEST
+
+START_TEST(check_Netchan_ReliableCompressed) {
+	client.compress = server.compress = true;
+
+	transfer();
+}
+END_TEST
+
+START_TEST(check_Netchan_ReliableSpace) {
+	byte data[MAX_MSG_SIZE];
+
+	// an empty channel may be filled to its reported space, but no further
+	const size_t space = Netchan_ReliableSpace(&client);
+	ck_assert(space <= client.message.max_size);
+
+	memset(data, 0, sizeof(data));
+	Mem_WriteBuffer(&client.message, data, space);
+
+	ck_assert(!client.message.overflowed);
+	ck_assert_uint_eq(Netchan_ReliableSpace(&client), 0);
+}
+END_TEST
+
+/**
+ * @brief Test entry point.
+ */
+int32_t main(int32_t argc, char **argv) {
+
+	Test_Init(argc, argv);
+
+	TCase *tcase = tcase_create("check_netchan");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+
+	tcase_add_test(tcase, check_Netchan_Reliable);
+	tcase_add_test(tcase, check_Netchan_ReliableCompressed);
+	tcase_add_test(tcase, check_Netchan_ReliableSpace);
+
+	Suite *suite = suite_create("check_netchan");
+	suite_add_tcase(suite, tcase);
+
+	int32_t failed = Test_Run(suite);
+
+	Test_Shutdown();
+	return failed;
+}
@@ -81,6 +81,78 @@ START_TEST(check_Thread_Wait) {
 }
 END_TEST
 
+static SDL_atomic_t count;
+
+/**
+ * @brief Increments the shared counter.
+ */
+static void increment(void *data) {
+	SDL_AtomicAdd(&count, 1);
+}
+
+/**
+ * @brief Spawns child jobs which must complete before this job does.
+ */
+static void spawn(void *data) {
+
+	for (int32_t i = 0; i < 1000; i++) {
+		Thread_CreateChild(Thread_Current(), increment, NULL);
+	}
+}
+
+START_TEST(check_Thread_CreateChild) {
+	SDL_AtomicSet(&count, 0);
+
+	thread_t *t = Thread_Create(spawn, NULL);
+
+	Thread_Wait(t);
+
+	ck_assert_int_eq(SDL_AtomicGet(&count), 1000);
+}
+END_TEST
+
+START_TEST(check_Thread_NoWait) {
+	SDL_AtomicSet(&count, 0);
+
+	for (int32_t i = 0; i < 10000; i++) {
+		Thread_Create_(__func__, increment, NULL, THREAD_NO_WAIT);
+	}
+
+	Thread_Shutdown(); // waits for all outstanding jobs
+
+	ck_assert_int_eq(SDL_AtomicGet(&count), 10000);
+
+	Thread_Init(2);
+}
+END_TEST
+
+static SDL_atomic_t hits[10000];
+
+/**
+ * @brief ThreadRangeFunc marking each visited index.
+ */
+static void visit(int32_t begin, int32_t end, void *data) {
+
+	for (int32_t i = begin; i < end; i++) {
+		SDL_AtomicAdd(&hits[i], 1);
+	}
+}
+
+START_TEST(check_Thread_ParallelFor) {
+	const int32_t grains[] = { 0, 1, 7, 10000 };
+
+	for (size_t i = 0; i < lengthof(grains); i++) {
+		memset(hits, 0, sizeof(hits));
+
+		Thread_ParallelFor(1, 9999, grains[i], visit, NULL);
+
+		for (int32_t j = 0; j < (int32_t) lengthof(hits); j++) {
+			ck_assert_int_eq(SDL_AtomicGet(&hits[j]), (j >= 1 && j < 9999) ? 1 : 0);
+		}
+	}
+}
+END_TEST
+
 /**
  * @brief Test entry point.
  */
@@ -92,6 +164,9 @@ int32_t main(int32_t argc, char **argv) {
 	tcase_add_checked_fixture(tcase, setup, teardown);
 
 	tcase_add_test(tcase, check_Thread_Wait);
+	tcase_add_test(tcase, check_Thread_CreateChild);
+	tcase_add_test(tcase, check_Thread_NoWait);
+	tcase_add_test(tcase, check_Thread_ParallelFor);
 
 	Suite *suite = suite_create("check_threads");
 	suite_add_tcase(suite, tcase);
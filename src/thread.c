@@ -20,168 +20,456 @@
  */
 
 #include <SDL2/SDL_cpuinfo.h>
-#include <SDL2/SDL_timer.h>
 
 #include "thread.h"
 
+#define THREAD_QUEUE_SIZE 4096 // must be a power of two
+
+/**
+ * @brief A deque of jobs. The owning thread pushes and pops at the bottom, so
+ * that it works depth-first, while idle threads steal the oldest jobs from
+ * the top.
+ */
+typedef struct {
+	SDL_SpinLock lock;
+	thread_t *jobs[THREAD_QUEUE_SIZE];
+	volatile uint32_t top, bottom;
+} thread_queue_t;
+
 typedef struct thread_pool_s {
+	SDL_Thread **threads;
+	size_t num_threads;
+
+	/**
+	 * @brief One queue per worker, plus one shared by all other threads.
+	 */
+	thread_queue_t *queues;
+	size_t num_queues;
+
+	SDL_atomic_t queued; // jobs sitting in queues
+	SDL_atomic_t active; // jobs not yet completed
+
 	SDL_mutex *mutex;
+	SDL_cond *work; // signaled when jobs are queued
+	SDL_cond *done; // broadcast when jobs are queued or completed
+	SDL_atomic_t sleeping;
 
-	thread_t *threads;
-	size_t num_threads;
+	SDL_SpinLock free_lock;
+	thread_t *free_jobs;
+
+	volatile _Bool shutdown;
 } thread_pool_t;
 
 static thread_pool_t thread_pool;
 
+static __thread int32_t thread_index = -1;
+static __thread thread_t *thread_current;
+
 cvar_t *threads;
 
 /**
- * @brief Wrap the user's function in our own for introspection.
+ * @brief Allocates a job, recycling completed ones where possible.
  */
-static int32_t Thread_Run(void *data) {
-	thread_t *t = (thread_t *) data;
+static thread_t *Thread_Alloc(void) {
+	thread_t *t;
+
+	SDL_AtomicLock(&thread_pool.free_lock);
 
-	while (thread_pool.mutex) {
+	if ((t = thread_pool.free_jobs)) {
+		thread_pool.free_jobs = t->next;
+	}
 
-		SDL_mutexP(t->mutex);
+	SDL_AtomicUnlock(&thread_pool.free_lock);
 
-		if (t->status == THREAD_RUNNING) {
-			t->Run(t->data);
+	if (t) {
+		memset(t, 0, sizeof(*t));
+	} else {
+		t = Mem_Malloc(sizeof(thread_t));
+	}
 
-			t->Run = NULL;
-			t->data = NULL;
+	return t;
+}
 
-			t->status = THREAD_WAIT;
-		} else {
-			SDL_CondWait(t->cond, t->mutex);
+/**
+ * @brief Releases a reference to the specified job, returning it to the free
+ * list when no references remain.
+ */
+static void Thread_Release(thread_t *t) {
+
+	if (SDL_AtomicAdd(&t->refs, -1) == 1) {
+		SDL_AtomicLock(&thread_pool.free_lock);
+
+		t->next = thread_pool.free_jobs;
+		thread_pool.free_jobs = t;
+
+		SDL_AtomicUnlock(&thread_pool.free_lock);
+	}
+}
+
+/**
+ * @brief Wakes sleeping threads, if any. A single worker is woken for new work,
+ * while all waiters are woken so that they may re-evaluate their jobs.
+ */
+static void Thread_Wake(_Bool work) {
+
+	if (SDL_AtomicGet(&thread_pool.sleeping)) {
+		SDL_mutexP(thread_pool.mutex);
+
+		if (work) {
+			SDL_CondSignal(thread_pool.work);
 		}
 
-		SDL_mutexV(t->mutex);
+		SDL_CondBroadcast(thread_pool.done);
+
+		SDL_mutexV(thread_pool.mutex);
 	}
+}
 
-	return 0;
+/**
+ * @brief Blocks the calling thread until work is queued, or until the specified
+ * counter reaches zero. Pass NULL to wait for work only.
+ */
+static void Thread_Sleep(SDL_atomic_t *pending) {
+
+	SDL_mutexP(thread_pool.mutex);
+
+	SDL_AtomicAdd(&thread_pool.sleeping, 1);
+
+	if (SDL_AtomicGet(&thread_pool.queued) == 0 && !thread_pool.shutdown) {
+		if (pending == NULL) {
+			SDL_CondWait(thread_pool.work, thread_pool.mutex);
+		} else if (SDL_AtomicGet(pending)) {
+			SDL_CondWait(thread_pool.done, thread_pool.mutex);
+		}
+	}
+
+	SDL_AtomicAdd(&thread_pool.sleeping, -1);
+
+	SDL_mutexV(thread_pool.mutex);
 }
 
 /**
- * @brief Initializes the threads backing the thread pool.
+ * @brief Pushes the job onto the calling thread's queue.
+ *
+ * @return True if the job was queued, false if the queue is full.
  */
-static void Thread_Init_(ssize_t num_threads) {
+static _Bool Thread_Push(thread_t *t) {
 
-	if (num_threads == 0) {
-		num_threads = SDL_GetCPUCount();
-	} else if (num_threads == -1) {
-		num_threads = 0;
-	} else if (num_threads > MAX_THREADS) {
-		num_threads = MAX_THREADS;
+	const size_t index = thread_index == -1 ? thread_pool.num_threads : (size_t) thread_index;
+	thread_queue_t *q = &thread_pool.queues[index];
+
+	SDL_AtomicLock(&q->lock);
+
+	if (q->bottom - q->top == THREAD_QUEUE_SIZE) {
+		SDL_AtomicUnlock(&q->lock);
+		return false;
 	}
 
-	thread_pool.num_threads = num_threads;
+	q->jobs[q->bottom & (THREAD_QUEUE_SIZE - 1)] = t;
+	q->bottom++;
 
-	if (thread_pool.num_threads) {
-		thread_pool.threads = Mem_Malloc(sizeof(thread_t) * thread_pool.num_threads);
+	SDL_AtomicUnlock(&q->lock);
+
+	SDL_AtomicAdd(&thread_pool.queued, 1);
+
+	Thread_Wake(true);
+	return true;
+}
+
+/**
+ * @brief Pops the newest job from the calling thread's own queue or, failing
+ * that, steals the oldest job from another thread's queue.
+ */
+static thread_t *Thread_Pop(void) {
+	thread_t *t = NULL;
+
+	if (SDL_AtomicGet(&thread_pool.queued) == 0) {
+		return NULL;
+	}
+
+	if (thread_index != -1) {
+		thread_queue_t *q = &thread_pool.queues[thread_index];
 
-		thread_t *t = thread_pool.threads;
-		uint16_t i = 0;
+		SDL_AtomicLock(&q->lock);
 
-		for (i = 0; i < thread_pool.num_threads; i++, t++) {
-			t->cond = SDL_CreateCond();
-			t->mutex = SDL_CreateMutex();
-			t->thread = SDL_CreateThread(Thread_Run, __func__, t);
+		if (q->bottom != q->top) {
+			q->bottom--;
+			t = q->jobs[q->bottom & (THREAD_QUEUE_SIZE - 1)];
 		}
+
+		SDL_AtomicUnlock(&q->lock);
+	}
+
+	const size_t start = thread_index == -1 ? thread_pool.num_threads : (size_t) thread_index;
+
+	for (size_t i = 0; i < thread_pool.num_queues && t == NULL; i++) {
+		thread_queue_t *q = &thread_pool.queues[(start + i) % thread_pool.num_queues];
+
+		if (q->bottom == q->top) { // peek without locking
+			continue;
+		}
+
+		SDL_AtomicLock(&q->lock);
+
+		if (q->bottom != q->top) {
+			t = q->jobs[q->top & (THREAD_QUEUE_SIZE - 1)];
+			q->top++;
+		}
+
+		SDL_AtomicUnlock(&q->lock);
+	}
+
+	if (t) {
+		SDL_AtomicAdd(&thread_pool.queued, -1);
 	}
+
+	return t;
 }
 
 /**
- * Thread_Shutdown_
+ * @brief Marks one unit of the specified job as complete. When the job and all
+ * of its children have completed, its parent is notified in turn.
  */
-static void Thread_Shutdown_(void) {
+static void Thread_Finish(thread_t *t) {
 
-	if (thread_pool.num_threads) {
-		thread_t *t = thread_pool.threads;
-		uint16_t i = 0;
-
-		for (i = 0; i < thread_pool.num_threads; i++, t++) {
-			Thread_Wait(t);
-			SDL_CondSignal(t->cond);
-			SDL_WaitThread(t->thread, NULL);
-			SDL_DestroyCond(t->cond);
-			SDL_DestroyMutex(t->mutex);
+	while (t && SDL_AtomicAdd(&t->pending, -1) == 1) {
+		thread_t *parent = t->parent;
+
+		Thread_Release(t);
+
+		SDL_AtomicAdd(&thread_pool.active, -1);
+
+		Thread_Wake(false);
+
+		t = parent;
+	}
+}
+
+/**
+ * @brief Runs the specified job on the calling thread.
+ */
+static void Thread_Execute(thread_t *t) {
+
+	thread_t *current = thread_current;
+	thread_current = t;
+
+	t->Run(t->data);
+
+	thread_current = current;
+
+	Thread_Finish(t);
+}
+
+/**
+ * @brief The worker thread entry point.
+ */
+static int32_t Thread_Run(void *data) {
+
+	thread_index = (int32_t) (intptr_t) data;
+
+	while (!thread_pool.shutdown) {
+
+		thread_t *t = Thread_Pop();
+		if (t) {
+			Thread_Execute(t);
+		} else {
+			Thread_Sleep(NULL);
 		}
+	}
 
-		Mem_Free(thread_pool.threads);
+	return 0;
+}
+
+/**
+ * @brief Allocates and dispatches a job. If there are no workers, or if the
+ * queue is full, the job is run immediately on the calling thread.
+ */
+static thread_t *Thread_Dispatch(thread_t *parent, const char *name, ThreadRunFunc run, void *data,
+                                 thread_options_t options) {
+
+	if (thread_pool.num_threads == 0) {
+		run(data);
+		return NULL;
+	}
+
+	thread_t *t = Thread_Alloc();
+
+	g_strlcpy(t->name, name, sizeof(t->name));
+
+	t->Run = run;
+	t->data = data;
+	t->parent = parent;
+
+	SDL_AtomicSet(&t->pending, 1);
+	SDL_AtomicSet(&t->refs, (options & THREAD_NO_WAIT) ? 1 : 2);
+
+	if (parent) {
+		SDL_AtomicAdd(&parent->pending, 1);
 	}
+
+	SDL_AtomicAdd(&thread_pool.active, 1);
+
+	if (!Thread_Push(t)) {
+		Thread_Execute(t);
+	}
+
+	return (options & THREAD_NO_WAIT) ? NULL : t;
 }
 
 /**
- * @brief Creates a new thread to run the specified function. Callers must use
- * Thread_Wait on the returned handle to release the thread when finished.
+ * @brief Creates a new job to run the specified function. Unless THREAD_NO_WAIT
+ * is specified, callers must use Thread_Wait on the returned handle to release
+ * the job when finished.
  */
-thread_t *Thread_Create_(const char *name, ThreadRunFunc run, void *data) {
+thread_t *Thread_Create_(const char *name, ThreadRunFunc run, void *data, thread_options_t options) {
+	return Thread_Dispatch(NULL, name, run, data, options);
+}
 
-	thread_t *t = thread_pool.threads;
-	uint16_t i = 0;
+/**
+ * @brief Creates a child job of the specified parent, which will not complete
+ * until the child has. The parent must not yet have completed; typically, the
+ * child is created from within the parent's own function via Thread_Current.
+ */
+thread_t *Thread_CreateChild_(thread_t *parent, const char *name, ThreadRunFunc run, void *data) {
+	return Thread_Dispatch(parent, name, run, data, THREAD_NO_WAIT);
+}
 
-	// if threads are available, find an idle one and dispatch it
-	if (thread_pool.num_threads) {
-		SDL_mutexP(thread_pool.mutex);
+/**
+ * @return The job running on the calling thread, or NULL.
+ */
+thread_t *Thread_Current(void) {
+	return thread_current;
+}
 
-		for (i = 0; i < thread_pool.num_threads; i++, t++) {
+/**
+ * @brief Wait for the specified job and its children to complete. Rather than
+ * spinning, the calling thread runs other queued jobs while it waits, and
+ * otherwise sleeps until woken.
+ */
+void Thread_Wait(thread_t *t) {
 
-			// if the thread appears idle, lock it and check again
-			if (t->status == THREAD_IDLE) {
+	if (!t) {
+		return;
+	}
 
-				SDL_mutexP(t->mutex);
+	while (SDL_AtomicGet(&t->pending)) {
 
-				// if the thread is idle, dispatch it
-				if (t->status == THREAD_IDLE) {
-					g_strlcpy(t->name, name, sizeof(t->name));
+		thread_t *job = Thread_Pop();
+		if (job) {
+			Thread_Execute(job);
+		} else {
+			Thread_Sleep(&t->pending);
+		}
+	}
 
-					t->Run = run;
-					t->data = data;
+	Thread_Release(t);
+}
 
-					t->status = THREAD_RUNNING;
+/**
+ * @brief The shared state of a Thread_ParallelFor. Chunks are claimed from
+ * the range atomically, so no lock is held between iterations.
+ */
+typedef struct {
+	int32_t end;
+	int32_t grain;
+	int32_t divisor;
+	SDL_atomic_t next;
+	ThreadRangeFunc Run;
+	void *data;
+} thread_range_t;
 
-					SDL_mutexV(t->mutex);
-					SDL_CondSignal(t->cond);
+/**
+ * @brief Claims the next chunk of the range. With a fixed grain, chunks are of
+ * equal size. Otherwise, each chunk is a fraction of the remaining work, so
+ * that chunks start large and shrink towards the end of the range to balance
+ * uneven iterations.
+ *
+ * @return True if a chunk was claimed, false if the range is exhausted.
+ */
+static _Bool Thread_ClaimRange(thread_range_t *range, int32_t *begin, int32_t *end) {
 
-					break;
-				}
+	if (range->grain > 0) {
+		*begin = SDL_AtomicAdd(&range->next, range->grain);
+		if (*begin >= range->end) {
+			return false;
+		}
 
-				SDL_mutexV(t->mutex);
-			}
+		*end = *begin + range->grain;
+		if (*end > range->end) {
+			*end = range->end;
 		}
+	} else {
+		do {
+			*begin = SDL_AtomicGet(&range->next);
+			if (*begin >= range->end) {
+				return false;
+			}
 
-		SDL_mutexV(thread_pool.mutex);
+			const int32_t chunk = (range->end - *begin) / range->divisor;
+			*end = *begin + (chunk ? chunk : 1);
+		} while (!SDL_AtomicCAS(&range->next, *begin, *end));
 	}
 
-	// if we failed to allocate a thread, run the function in this thread
-	if (i == thread_pool.num_threads) {
-#if 0
-		if (thread_pool.num_threads) {
-			printf("No threads available for %s\n", name);
-		}
-#endif
-		t = NULL;
-		run(data);
+	return true;
+}
+
+/**
+ * @brief ThreadRunFunc for Thread_ParallelFor. Claims and runs chunks until the
+ * range is exhausted.
+ */
+static void Thread_ParallelFor_Run(void *data) {
+	thread_range_t *range = (thread_range_t *) data;
+
+	int32_t begin, end;
+	while (Thread_ClaimRange(range, &begin, &end)) {
+		range->Run(begin, end, range->data);
 	}
+}
 
-	return t;
+/**
+ * @brief ThreadRunFunc for Thread_ParallelFor. Spawns one child per worker.
+ */
+static void Thread_ParallelFor_Spawn(void *data) {
+
+	thread_t *parent = Thread_Current();
+
+	for (size_t i = 0; i < thread_pool.num_threads; i++) {
+		Thread_CreateChild(parent, Thread_ParallelFor_Run, data);
+	}
 }
 
 /**
- * @brief Wait for the specified thread to complete.
+ * @brief Runs func over the range [begin, end) across all workers, returning
+ * when the entire range has been processed. The calling thread participates.
+ *
+ * @param grain The chunk size, or 0 to adapt the chunk size to the work that
+ * remains.
  */
-void Thread_Wait(thread_t *t) {
+void Thread_ParallelFor(int32_t begin, int32_t end, int32_t grain, ThreadRangeFunc func, void *data) {
 
-	if (!t || t->status == THREAD_IDLE) {
+	if (end <= begin) {
 		return;
 	}
 
-	while (t->status != THREAD_WAIT) {
-		SDL_Delay(0);
+	thread_range_t range = {
+		.end = end,
+		.grain = grain,
+		.divisor = (int32_t) (thread_pool.num_threads + 1) * 4,
+		.Run = func,
+		.data = data
+	};
+
+	SDL_AtomicSet(&range.next, begin);
+
+	thread_t *t = NULL;
+
+	if (thread_pool.num_threads && end - begin > grain) {
+		t = Thread_Create(Thread_ParallelFor_Spawn, &range);
 	}
 
-	t->status = THREAD_IDLE;
+	Thread_ParallelFor_Run(&range);
+
+	Thread_Wait(t);
 }
 
 /**
@@ -198,22 +486,76 @@ void Thread_Init(ssize_t num_threads) {
 
 	memset(&thread_pool, 0, sizeof(thread_pool));
 
-	thread_pool.mutex = SDL_CreateMutex();
+	if (num_threads == 0) {
+		num_threads = SDL_GetCPUCount();
+	} else if (num_threads == -1) {
+		num_threads = 0;
+	} else if (num_threads > MAX_THREADS) {
+		num_threads = MAX_THREADS;
+	}
+
+	thread_pool.num_threads = num_threads;
+
+	if (thread_pool.num_threads) {
+
+		thread_pool.mutex = SDL_CreateMutex();
+		thread_pool.work = SDL_CreateCond();
+		thread_pool.done = SDL_CreateCond();
+
+		thread_pool.num_queues = thread_pool.num_threads + 1;
+		thread_pool.queues = Mem_Malloc(sizeof(thread_queue_t) * thread_pool.num_queues);
+
+		thread_pool.threads = Mem_Malloc(sizeof(SDL_Thread *) * thread_pool.num_threads);
 
-	Thread_Init_(num_threads);
+		for (size_t i = 0; i < thread_pool.num_threads; i++) {
+			thread_pool.threads[i] = SDL_CreateThread(Thread_Run, __func__, (void *) (intptr_t) i);
+		}
+	}
 }
 
 /**
- * @brief Shuts down the thread pool.
+ * @brief Shuts down the thread pool, after all outstanding jobs have completed.
  */
 void Thread_Shutdown(void) {
 
-	if (thread_pool.mutex) {
+	if (thread_pool.num_threads) {
+
+		while (SDL_AtomicGet(&thread_pool.active)) {
+
+			thread_t *t = Thread_Pop();
+			if (t) {
+				Thread_Execute(t);
+			} else {
+				Thread_Sleep(&thread_pool.active);
+			}
+		}
+
+		SDL_mutexP(thread_pool.mutex);
+
+		thread_pool.shutdown = true;
+
+		SDL_CondBroadcast(thread_pool.work);
+		SDL_CondBroadcast(thread_pool.done);
+
+		SDL_mutexV(thread_pool.mutex);
+
+		for (size_t i = 0; i < thread_pool.num_threads; i++) {
+			SDL_WaitThread(thread_pool.threads[i], NULL);
+		}
+
+		while (thread_pool.free_jobs) {
+			thread_t *t = thread_pool.free_jobs;
+			thread_pool.free_jobs = t->next;
+			Mem_Free(t);
+		}
+
+		SDL_DestroyCond(thread_pool.work);
+		SDL_DestroyCond(thread_pool.done);
 		SDL_DestroyMutex(thread_pool.mutex);
-		thread_pool.mutex = NULL;
-	}
 
-	Thread_Shutdown_();
+		Mem_Free(thread_pool.queues);
+		Mem_Free(thread_pool.threads);
+	}
 
 	memset(&thread_pool, 0, sizeof(thread_pool));
 }
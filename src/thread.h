@@ -21,33 +21,54 @@
 
 #pragma once
 
+#include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_thread.h>
 
 #include "mem.h"
 
 #define MAX_THREADS 128
 
+/**
+ * @brief Options for Thread_Create_.
+ */
 typedef enum {
-	THREAD_IDLE,
-	THREAD_RUNNING,
-	THREAD_WAIT
-} thread_status_t;
+	THREAD_NONE,
+
+	/**
+	 * @brief The job is released upon completion, and no handle is returned.
+	 */
+	THREAD_NO_WAIT = 0x1
+} thread_options_t;
 
 typedef void (*ThreadRunFunc)(void *data);
 
-typedef struct {
-	SDL_Thread *thread;
-	SDL_cond *cond;
-	SDL_mutex *mutex;
+/**
+ * @brief Processes the half-open range [begin, end) of a Thread_ParallelFor.
+ */
+typedef void (*ThreadRangeFunc)(int32_t begin, int32_t end, void *data);
+
+/**
+ * @brief Jobs are pushed to the deque of the creating thread, and run by
+ * whichever worker pops or steals them first. A job is complete once it and
+ * all of its children have run.
+ */
+typedef struct thread_s {
 	char name[64];
-	volatile thread_status_t status;
 	ThreadRunFunc Run;
 	void *data;
+	struct thread_s *parent;
+	SDL_atomic_t pending; // this job plus its unfinished children
+	SDL_atomic_t refs; // the scheduler's reference and, optionally, the caller's
+	struct thread_s *next; // the free list
 } thread_t;
 
-thread_t *Thread_Create_(const char *name, ThreadRunFunc run, void *data);
-#define Thread_Create(function, data) Thread_Create_(#function, function, data)
+thread_t *Thread_Create_(const char *name, ThreadRunFunc run, void *data, thread_options_t options);
+#define Thread_Create(function, data) Thread_Create_(#function, function, data, THREAD_NONE)
+thread_t *Thread_CreateChild_(thread_t *parent, const char *name, ThreadRunFunc run, void *data);
+#define Thread_CreateChild(parent, function, data) Thread_CreateChild_(parent, #function, function, data)
+thread_t *Thread_Current(void);
 void Thread_Wait(thread_t *t);
+void Thread_ParallelFor(int32_t begin, int32_t end, int32_t grain, ThreadRangeFunc func, void *data);
 uint16_t Thread_Count(void);
 void Thread_Init(ssize_t num_threads);
 void Thread_Shutdown(void);
@@ -487,25 +487,106 @@ static _Bool CheckPlaneAgainstVolume(int32_t pnum, node_t *node) {
 	return good;
 }
 
+/**
+ * @brief Split candidates are scored in parallel once there are at least this many
+ * brush tests (candidates times brushes) to perform.
+ */
+#define PARALLEL_SPLIT_TESTS 4096
+
+/**
+ * @brief A side whose plane may partition the brushes of a node.
+ */
+typedef struct {
+	side_t *side;
+	int32_t plane_num;
+	int32_t value;
+	_Bool valid; // false if the plane would produce a tiny volume
+} split_candidate_t;
+
+/**
+ * @brief The shared state of ScoreSplitCandidates.
+ */
+typedef struct {
+	brush_t *brushes;
+	node_t *node;
+	split_candidate_t *candidates;
+} split_scoring_t;
+
+/**
+ * @brief Scores a range of split candidates. Each candidate is tested against every
+ * brush, without modifying any of them, so that candidates may be scored in parallel.
+ */
+static void ScoreSplitCandidates(int32_t begin, int32_t end, void *data) {
+	const split_scoring_t *scoring = (split_scoring_t *) data;
+
+	for (int32_t i = begin; i < end; i++) {
+		split_candidate_t *c = &scoring->candidates[i];
+
+		c->valid = CheckPlaneAgainstVolume(c->plane_num, scoring->node);
+		if (!c->valid) {
+			continue; // would produce a tiny volume
+		}
+
+		int32_t front = 0, back = 0, facing = 0, splits = 0, epsilonbrush = 0;
+		_Bool hintsplit = false;
+
+		for (brush_t *test = scoring->brushes; test; test = test->next) {
+			int32_t bsplits;
+			const int32_t s = TestBrushToPlanenum(test, c->plane_num, &bsplits, &hintsplit, &epsilonbrush);
+
+			splits += bsplits;
+			if (bsplits && (s & SIDE_FACING)) {
+				Com_Error(ERROR_FATAL, "SIDE_FACING with splits\n");
+			}
+
+			if (s & SIDE_FACING) {
+				facing++;
+			}
+			if (s & SIDE_FRONT) {
+				front++;
+			}
+			if (s & SIDE_BACK) {
+				back++;
+			}
+		}
+
+		// give a value estimate for using this plane
+
+		c->value = 5 * facing - 5 * splits - abs(front - back);
+		if (AXIAL(&map_planes[c->plane_num])) {
+			c->value += 5;    // axial is better
+		}
+		c->value -= epsilonbrush * 1000; // avoid!
+
+		// never split a hint side except with another hint
+		if (hintsplit && !(c->side->surf & SURF_HINT)) {
+			c->value = -9999999;
+		}
+	}
+}
+
 /**
  * @brief Using a heuristic, chooses one of the sides out of the brush list
  * to partition the brushes with.
  * Returns NULL if there are no valid planes to split with..
+ * @details Each plane is scored once, for the first side found on it, and the first
+ * of the best scoring planes is chosen. Candidates are gathered serially and scored
+ * in parallel, so the choice is the same regardless of the number of threads.
  */
-static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
-	int32_t value, bestvalue;
-	brush_t *brush, *test;
-	side_t *side, *bestside;
-	int32_t i, j, pass, numpasses;
-	int32_t pnum;
-	int32_t s;
-	int32_t front, back, both, facing, splits;
-	int32_t bsplits;
-	int32_t epsilonbrush;
-	_Bool hintsplit;
+static side_t *SelectSplitSide(tree_t *tree, brush_t *brushes, node_t *node) {
+	int32_t i, pass, numpasses;
 
-	bestside = NULL;
-	bestvalue = -99999;
+	side_t *bestside = NULL;
+	int32_t bestvalue = -99999;
+
+	int32_t num_brushes = 0, max_candidates = 0;
+	for (brush_t *brush = brushes; brush; brush = brush->next) {
+		num_brushes++;
+		max_candidates += brush->num_sides;
+	}
+
+	split_candidate_t *candidates = Mem_TagMalloc(Max(max_candidates, 1) * sizeof(split_candidate_t), MEM_TAG_BRUSH);
+	byte *planes = Mem_TagMalloc((num_map_planes >> 4) + 1, MEM_TAG_BRUSH); // the planes already scored
 
 	// the search order goes: visible-structural, visible-detail,
 	// nonvisible-structural, nonvisible-detail.
@@ -513,7 +594,9 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 	// passes will be tried.
 	numpasses = 4;
 	for (pass = 0; pass < numpasses; pass++) {
-		for (brush = brushes; brush; brush = brush->next) {
+		int32_t num_candidates = 0;
+
+		for (brush_t *brush = brushes; brush; brush = brush->next) {
 			if ((pass & 1) && !(brush->original->contents & CONTENTS_DETAIL)) {
 				continue;
 			}
@@ -521,7 +604,7 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 				continue;
 			}
 			for (i = 0; i < brush->num_sides; i++) {
-				side = brush->sides + i;
+				side_t *side = brush->sides + i;
 				if (side->bevel) {
 					continue;    // never use a bevel as a splitter
 				}
@@ -531,9 +614,6 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 				if (side->texinfo == TEXINFO_NODE) {
 					continue;    // already a node splitter
 				}
-				if (side->tested) {
-					continue;    // we already have metrics for this plane
-				}
 				if (side->surf & SURF_SKIP) {
 					continue;    // skip surfaces are never chosen
 				}
@@ -541,76 +621,39 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 					continue;    // only check visible faces on first pass
 				}
 
-				pnum = side->plane_num;
-				pnum &= ~1; // always use positive facing plane
-
-				CheckPlaneAgainstParents(pnum, node);
+				const int32_t pnum = side->plane_num & ~1; // always use positive facing plane
 
-				if (!CheckPlaneAgainstVolume(pnum, node)) {
-					continue;    // would produce a tiny volume
+				const int32_t bit = pnum >> 1;
+				if (planes[bit >> 3] & (1 << (bit & 7))) {
+					continue;    // we already have metrics for this plane
 				}
+				planes[bit >> 3] |= (1 << (bit & 7));
 
-				front = 0;
-				back = 0;
-				both = 0;
-				facing = 0;
-				splits = 0;
-				epsilonbrush = 0;
-				hintsplit = false;
-
-				for (test = brushes; test; test = test->next) {
-					s = TestBrushToPlanenum(test, pnum, &bsplits, &hintsplit, &epsilonbrush);
-
-					splits += bsplits;
-					if (bsplits && (s & SIDE_FACING)) {
-						Com_Error(ERROR_FATAL, "SIDE_FACING with splits\n");
-					}
-
-					test->test_side = s;
-					// if the brush shares this face, don't bother
-					// testing that facenum as a splitter again
-					if (s & SIDE_FACING) {
-						facing++;
-						for (j = 0; j < test->num_sides; j++) {
-							if ((test->sides[j].plane_num & ~1) == pnum) {
-								test->sides[j].tested = true;
-							}
-						}
-					}
-					if (s & SIDE_FRONT) {
-						front++;
-					}
-					if (s & SIDE_BACK) {
-						back++;
-					}
-					if (s == SIDE_BOTH) {
-						both++;
-					}
-				}
+				CheckPlaneAgainstParents(pnum, node);
 
-				// give a value estimate for using this plane
+				candidates[num_candidates++] = (split_candidate_t) {
+					.side = side,
+					.plane_num = pnum
+				};
+			}
+		}
 
-				value = 5 * facing - 5 * splits - abs(front - back);
-				if (AXIAL(&map_planes[pnum])) {
-					value += 5;    // axial is better
-				}
-				value -= epsilonbrush * 1000; // avoid!
+		split_scoring_t scoring = {
+			.brushes = brushes,
+			.node = node,
+			.candidates = candidates
+		};
 
-				// never split a hint side except with another hint
-				if (hintsplit && !(side->surf & SURF_HINT)) {
-					value = -9999999;
-				}
+		if (num_candidates * num_brushes >= PARALLEL_SPLIT_TESTS) {
+			Thread_ParallelFor(0, num_candidates, 0, ScoreSplitCandidates, &scoring);
+		} else {
+			ScoreSplitCandidates(0, num_candidates, &scoring);
+		}
 
-				// save off the side test so we don't need
-				// to recalculate it when we actually seperate
-				// the brushes
-				if (value > bestvalue) {
-					bestvalue = value;
-					bestside = side;
-					for (test = brushes; test; test = test->next) {
-						test->side = test->test_side;
-					}
-				}
+		for (i = 0; i < num_candidates; i++) {
+			if (candidates[i].valid && candidates[i].value > bestvalue) {
+				bestvalue = candidates[i].value;
+				bestside = candidates[i].side;
 			}
 		}
 
@@ -618,7 +661,7 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 		if (bestside) {
 			if (pass > 1) {
 				if (debug) {
-					SDL_SemPost(semaphores.nonvis_nodes);
+					SDL_AtomicAdd(&tree->nonvis_nodes, 1);
 				}
 			}
 			if (pass > 0) {
@@ -628,10 +671,18 @@ static side_t *SelectSplitSide(brush_t *brushes, node_t *node) {
 		}
 	}
 
-	// clear all the tested flags we set
-	for (brush = brushes; brush; brush = brush->next) {
-		for (i = 0; i < brush->num_sides; i++) {
-			brush->sides[i].tested = false;
+	Mem_Free(candidates);
+	Mem_Free(planes);
+
+	// save off the side test so we don't need
+	// to recalculate it when we actually seperate
+	// the brushes
+	if (bestside) {
+		for (brush_t *test = brushes; test; test = test->next) {
+			int32_t bsplits, epsilonbrush = 0;
+			_Bool hintsplit;
+
+			test->side = TestBrushToPlanenum(test, bestside->plane_num & ~1, &bsplits, &hintsplit, &epsilonbrush);
 		}
 	}
 
@@ -888,23 +939,48 @@ static void SplitBrushList(brush_t *brushes, node_t *node, brush_t **front,
 	}
 }
 
+/**
+ * @brief Subtrees of at least this many brushes are built as jobs of their own.
+ */
+#define PARALLEL_TREE_BRUSHES 32
+
+/**
+ * @brief A subtree to be built as a job.
+ */
+typedef struct {
+	tree_t *tree;
+	node_t *node;
+	brush_t *brushes;
+} build_tree_t;
+
+static node_t *BuildTree_r(tree_t *tree, node_t *node, brush_t *brushes);
+
+/**
+ * @brief ThreadRunFunc for building a subtree.
+ */
+static void BuildTree_Thread(void *data) {
+	build_tree_t *job = (build_tree_t *) data;
+
+	BuildTree_r(job->tree, job->node, job->brushes);
+}
+
 /*
  * ================
  * BuildTree_r
  * ================
  */
-static node_t *BuildTree_r(node_t *node, brush_t *brushes) {
+static node_t *BuildTree_r(tree_t *tree, node_t *node, brush_t *brushes) {
 	node_t *newnode;
 	side_t *bestside;
 	int32_t i;
 	brush_t *children[2];
 
 	if (debug) {
-		SDL_SemPost(semaphores.vis_nodes);
+		SDL_AtomicAdd(&tree->vis_nodes, 1);
 	}
 
 	// find the best plane to use as a splitter
-	bestside = SelectSplitSide(brushes, node);
+	bestside = SelectSplitSide(tree, brushes, node);
 	if (!bestside) {
 		// leaf node
 		node->side = NULL;
@@ -929,11 +1005,26 @@ static node_t *BuildTree_r(node_t *node, brush_t *brushes) {
 	SplitBrush(node->volume, node->plane_num, &node->children[0]->volume,
 	           &node->children[1]->volume);
 
-	// recursively process children
-	for (i = 0; i < 2; i++) {
-		node->children[i] = BuildTree_r(node->children[i], children[i]);
+	// recursively process children, building the front as a job of its own if it is
+	// large enough. Each subtree owns its nodes and brushes, so the result is the same.
+	build_tree_t job = {
+		.tree = tree,
+		.node = node->children[0],
+		.brushes = children[0]
+	};
+
+	thread_t *thread = NULL;
+
+	if (Thread_Count() && CountBrushList(children[0]) >= PARALLEL_TREE_BRUSHES) {
+		thread = Thread_Create(BuildTree_Thread, &job);
+	} else {
+		BuildTree_r(tree, job.node, job.brushes);
 	}
 
+	BuildTree_r(tree, node->children[1], children[1]);
+
+	Thread_Wait(thread);
+
 	return node;
 }
 
@@ -995,22 +1086,20 @@ tree_t *BrushBSP(brush_t *brushlist, vec3_t mins, vec3_t maxs) {
 	Com_Debug(DEBUG_ALL, "%5i visible faces\n", c_faces);
 	Com_Debug(DEBUG_ALL, "%5i nonvisible faces\n", c_nonvisfaces);
 
-	SDL_DestroySemaphore(semaphores.vis_nodes);
-	semaphores.vis_nodes = SDL_CreateSemaphore(0);
-
-	SDL_DestroySemaphore(semaphores.nonvis_nodes);
-	semaphores.nonvis_nodes = SDL_CreateSemaphore(0);
-
 	node = AllocNode();
 
+	ThreadLock(); // finding planes may add them
+
 	node->volume = BrushFromBounds(mins, maxs);
 
+	ThreadUnlock();
+
 	tree->head_node = node;
 
-	node = BuildTree_r(node, brushlist);
+	node = BuildTree_r(tree, node, brushlist);
 
-	const uint32_t vis_nodes = SDL_SemValue(semaphores.vis_nodes);
-	const uint32_t nonvis_nodes = SDL_SemValue(semaphores.nonvis_nodes);
+	const int32_t vis_nodes = SDL_AtomicGet(&tree->vis_nodes);
+	const int32_t nonvis_nodes = SDL_AtomicGet(&tree->nonvis_nodes);
 
 	Com_Debug(DEBUG_ALL, "%5i visible nodes\n", vis_nodes / 2 - nonvis_nodes);
 	Com_Debug(DEBUG_ALL, "%5i nonvis nodes\n", nonvis_nodes);
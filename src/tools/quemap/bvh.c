@@ -0,0 +1,615 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "qlight.h"
+
+#if defined(__SSE__)
+	#include <xmmintrin.h>
+#endif
+
+/*
+ * The lighting BVH is a bounding volume hierarchy over every brush of every
+ * model in the BSP, built once at light time. It answers the same queries as
+ * Light_Trace, which traces each inline model's BSP tree in turn, with a single
+ * walk. Shadow rays are traced in packets of four, which share the walk for as
+ * long as their bounds agree, and leave it as soon as they are occluded.
+ *
+ * Brushes are clipped exactly as Cm_BoxTrace clips a point trace to them, so
+ * that lighting does not depend on which path was taken.
+ */
+
+/**
+ * @brief Plane side epsilon, as in cm_trace.c.
+ */
+#define BVH_DIST_EPSILON 0.03125
+
+/**
+ * @brief The maximum number of brushes in a leaf node.
+ */
+#define BVH_LEAF_BRUSHES 4
+
+/**
+ * @brief The maximum depth of the tree, which bounds the traversal stacks.
+ */
+#define BVH_MAX_DEPTH 64
+
+/**
+ * @brief The number of bins used to evaluate the surface area heuristic.
+ */
+#define BVH_BINS 16
+
+/**
+ * @brief The number of rays in a packet.
+ */
+#define BVH_PACKET_SIZE 4
+
+/**
+ * @brief BVH nodes are stored depth first, so that the first child of an
+ * interior node immediately follows it.
+ */
+typedef struct {
+	vec3_t mins, maxs;
+	int32_t first; // leafs: the first brush, interior nodes: the second child
+	int32_t count; // leafs: the number of brushes, interior nodes: 0
+} bvh_node_t;
+
+/**
+ * @brief Brushes are copied so that leaf tests do not chase pointers.
+ */
+typedef struct {
+	vec3_t mins, maxs;
+	int32_t contents;
+	int32_t num_sides;
+	const cm_bsp_brush_side_t *sides;
+} bvh_brush_t;
+
+static struct {
+	bvh_node_t *nodes;
+	int32_t num_nodes;
+
+	bvh_brush_t *brushes;
+	int32_t num_brushes;
+} bvh_tree;
+
+/**
+ * @brief A packet of rays, stored as structures of arrays.
+ */
+typedef struct {
+	vec_t origin[3][BVH_PACKET_SIZE];
+	vec_t inv_dir[3][BVH_PACKET_SIZE];
+	vec3_t start[BVH_PACKET_SIZE], end[BVH_PACKET_SIZE];
+	vec3_t mins[BVH_PACKET_SIZE], maxs[BVH_PACKET_SIZE];
+} bvh_packet_t;
+
+/**
+ * @return The surface area of the specified bounds, for the SAH.
+ */
+static vec_t BVH_Area(const vec3_t mins, const vec3_t maxs) {
+
+	vec3_t size;
+	VectorSubtract(maxs, mins, size);
+
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+/**
+ * @brief Recursively builds the subtree over the specified brushes, choosing
+ * splits by the binned surface area heuristic.
+ */
+static void BVH_BuildNode(int32_t node_num, int32_t first, int32_t count, int32_t depth) {
+	vec3_t centroid_mins, centroid_maxs;
+
+	bvh_node_t *node = &bvh_tree.nodes[node_num];
+
+	ClearBounds(node->mins, node->maxs);
+	ClearBounds(centroid_mins, centroid_maxs);
+
+	for (int32_t i = first; i < first + count; i++) {
+		const bvh_brush_t *b = &bvh_tree.brushes[i];
+
+		AddPointToBounds(b->mins, node->mins, node->maxs);
+		AddPointToBounds(b->maxs, node->mins, node->maxs);
+
+		vec3_t center;
+		VectorLerp(b->mins, b->maxs, 0.5, center);
+		AddPointToBounds(center, centroid_mins, centroid_maxs);
+	}
+
+	node->first = first;
+	node->count = count;
+
+	if (count <= BVH_LEAF_BRUSHES || depth == BVH_MAX_DEPTH) {
+		return;
+	}
+
+	int32_t best_axis = -1, best_bin = 0;
+	vec_t best_cost = BVH_Area(node->mins, node->maxs) * count;
+
+	for (int32_t axis = 0; axis < 3; axis++) {
+		const vec_t extent = centroid_maxs[axis] - centroid_mins[axis];
+		if (extent < 1.0) {
+			continue;
+		}
+
+		struct {
+			vec3_t mins, maxs;
+			int32_t count;
+		} bins[BVH_BINS];
+
+		for (int32_t i = 0; i < BVH_BINS; i++) {
+			ClearBounds(bins[i].mins, bins[i].maxs);
+			bins[i].count = 0;
+		}
+
+		for (int32_t i = first; i < first + count; i++) {
+			const bvh_brush_t *b = &bvh_tree.brushes[i];
+
+			const vec_t center = (b->mins[axis] + b->maxs[axis]) * 0.5;
+			const int32_t bin = Clamp((int32_t) ((center - centroid_mins[axis]) / extent * BVH_BINS), 0, BVH_BINS - 1);
+
+			AddPointToBounds(b->mins, bins[bin].mins, bins[bin].maxs);
+			AddPointToBounds(b->maxs, bins[bin].mins, bins[bin].maxs);
+			bins[bin].count++;
+		}
+
+		for (int32_t split = 1; split < BVH_BINS; split++) {
+			vec3_t left_mins, left_maxs, right_mins, right_maxs;
+			int32_t left = 0, right = 0;
+
+			ClearBounds(left_mins, left_maxs);
+			ClearBounds(right_mins, right_maxs);
+
+			for (int32_t i = 0; i < BVH_BINS; i++) {
+				if (bins[i].count == 0) {
+					continue;
+				}
+				if (i < split) {
+					AddPointToBounds(bins[i].mins, left_mins, left_maxs);
+					AddPointToBounds(bins[i].maxs, left_mins, left_maxs);
+					left += bins[i].count;
+				} else {
+					AddPointToBounds(bins[i].mins, right_mins, right_maxs);
+					AddPointToBounds(bins[i].maxs, right_mins, right_maxs);
+					right += bins[i].count;
+				}
+			}
+
+			if (left == 0 || right == 0) {
+				continue;
+			}
+
+			const vec_t cost = BVH_Area(left_mins, left_maxs) * left + BVH_Area(right_mins, right_maxs) * right;
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = split;
+			}
+		}
+	}
+
+	if (best_axis == -1) {
+		return; // no split is cheaper than testing every brush
+	}
+
+	// partition the brushes about the chosen split
+	const vec_t extent = centroid_maxs[best_axis] - centroid_mins[best_axis];
+
+	int32_t i = first, j = first + count - 1;
+	while (i <= j) {
+		const bvh_brush_t *b = &bvh_tree.brushes[i];
+
+		const vec_t center = (b->mins[best_axis] + b->maxs[best_axis]) * 0.5;
+		const int32_t bin = Clamp((int32_t) ((center - centroid_mins[best_axis]) / extent * BVH_BINS), 0, BVH_BINS - 1);
+
+		if (bin < best_bin) {
+			i++;
+		} else {
+			const bvh_brush_t swap = bvh_tree.brushes[i];
+			bvh_tree.brushes[i] = bvh_tree.brushes[j];
+			bvh_tree.brushes[j] = swap;
+			j--;
+		}
+	}
+
+	const int32_t left = i - first;
+
+	const int32_t left_num = bvh_tree.num_nodes++;
+	BVH_BuildNode(left_num, first, left, depth + 1);
+
+	const int32_t right_num = bvh_tree.num_nodes++;
+	BVH_BuildNode(right_num, i, count - left, depth + 1);
+
+	node = &bvh_tree.nodes[node_num];
+	node->first = right_num;
+	node->count = 0;
+}
+
+/**
+ * @brief Builds the lighting BVH from the brushes of the loaded collision model.
+ */
+void BuildBVH(void) {
+
+	const uint32_t start = SDL_GetTicks();
+
+	const cm_bsp_t *bsp = Cm_Bsp();
+
+	bvh_tree.brushes = Mem_TagMalloc(bsp->bsp.num_brushes * sizeof(bvh_brush_t), MEM_TAG_BVH);
+	bvh_tree.num_brushes = 0;
+
+	for (int32_t i = 0; i < bsp->bsp.num_brushes; i++) {
+		const cm_bsp_brush_t *b = &bsp->brushes[i];
+
+		if (!b->num_sides || !b->contents) {
+			continue;
+		}
+
+		bvh_brush_t *out = &bvh_tree.brushes[bvh_tree.num_brushes++];
+
+		VectorCopy(b->mins, out->mins);
+		VectorCopy(b->maxs, out->maxs);
+
+		out->contents = b->contents;
+		out->num_sides = b->num_sides;
+		out->sides = &bsp->brush_sides[b->first_brush_side];
+	}
+
+	if (bvh_tree.num_brushes == 0) {
+		Com_Error(ERROR_FATAL, "No brushes for BVH\n");
+	}
+
+	// a binary tree with single-brush leafs has fewer than twice as many nodes
+	bvh_tree.nodes = Mem_TagMalloc(2 * bvh_tree.num_brushes * sizeof(bvh_node_t), MEM_TAG_BVH);
+	bvh_tree.num_nodes = 1;
+
+	BVH_BuildNode(0, 0, bvh_tree.num_brushes, 0);
+
+	Com_Verbose("Built BVH of %d brushes with %d nodes in %u ms\n",
+	            bvh_tree.num_brushes, bvh_tree.num_nodes, SDL_GetTicks() - start);
+}
+
+/**
+ * @brief Frees the lighting BVH.
+ */
+void FreeBVH(void) {
+
+	Mem_FreeTag(MEM_TAG_BVH);
+
+	memset(&bvh_tree, 0, sizeof(bvh_tree));
+}
+
+/**
+ * @brief Clips the trace to the specified brush, exactly as Cm_BoxTrace would
+ * for a point trace.
+ */
+static void BVH_TraceToBrush(cm_trace_t *trace, const vec3_t start, const vec3_t end, const bvh_brush_t *brush) {
+
+	vec_t enter_fraction = -1.0;
+	vec_t leave_fraction = 1.0;
+
+	const cm_bsp_brush_side_t *clip_side = NULL;
+
+	_Bool end_outside = false, start_outside = false;
+
+	const cm_bsp_brush_side_t *side = brush->sides;
+
+	for (int32_t i = 0; i < brush->num_sides; i++, side++) {
+		const cm_bsp_plane_t *plane = side->plane;
+
+		const vec_t d1 = DotProduct(start, plane->normal) - plane->dist;
+		const vec_t d2 = DotProduct(end, plane->normal) - plane->dist;
+
+		if (d2 > 0.0) {
+			end_outside = true;
+		}
+		if (d1 > 0.0) {
+			start_outside = true;
+		}
+
+		if (d1 > 0.0 && d2 >= d1) {
+			return;
+		}
+
+		if (d1 <= 0.0 && d2 <= 0.0) {
+			continue;
+		}
+
+		if (d1 > d2) { // enter
+			const vec_t f = (d1 - BVH_DIST_EPSILON) / (d1 - d2);
+
+			if (f > enter_fraction) {
+				enter_fraction = f;
+				clip_side = side;
+			}
+		} else { // leave
+			const vec_t f = (d1 + BVH_DIST_EPSILON) / (d1 - d2);
+
+			if (f < leave_fraction) {
+				leave_fraction = f;
+			}
+		}
+	}
+
+	if (!start_outside) {
+		trace->start_solid = true;
+		if (!end_outside) {
+			trace->all_solid = true;
+			trace->fraction = 0.0;
+			trace->contents = brush->contents;
+		}
+	} else if (enter_fraction < leave_fraction) {
+		if (enter_fraction > -1.0 && enter_fraction < trace->fraction) {
+			trace->fraction = Max(0.0, enter_fraction);
+			trace->plane = *clip_side->plane;
+			trace->surface = clip_side->surface;
+			trace->contents = brush->contents;
+		}
+	}
+}
+
+/**
+ * @brief Resolves the bounds against which brushes are culled, as Cm_BoxTrace
+ * does, and the reciprocal direction of the ray.
+ */
+static void BVH_InitRay(const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs, vec3_t inv_dir) {
+
+	for (int32_t i = 0; i < 3; i++) {
+		mins[i] = Min(start[i], end[i]) - 1.0;
+		maxs[i] = Max(start[i], end[i]) + 1.0;
+
+		const vec_t dir = end[i] - start[i];
+		inv_dir[i] = fabsf(dir) > 1e-6 ? 1.0 / dir : copysignf(1e30, dir);
+	}
+}
+
+/**
+ * @return True if the ray, in parametric form, intersects the node's bounds
+ * between 0 and max_fraction. Node bounds are padded by the culling distance.
+ */
+static _Bool BVH_IntersectNode(const bvh_node_t *node, const vec3_t start, const vec3_t inv_dir,
+                               vec_t max_fraction) {
+
+	vec_t t_min = 0.0, t_max = max_fraction;
+
+	for (int32_t i = 0; i < 3; i++) {
+		const vec_t t1 = (node->mins[i] - 1.0 - start[i]) * inv_dir[i];
+		const vec_t t2 = (node->maxs[i] + 1.0 - start[i]) * inv_dir[i];
+
+		t_min = Max(t_min, Min(t1, t2));
+		t_max = Min(t_max, Max(t1, t2));
+	}
+
+	return t_min <= t_max;
+}
+
+/**
+ * @brief Traces a point from start to end through the BVH, against brushes
+ * matching mask. The nearest impact is returned, as with Light_Trace.
+ */
+void BVH_Trace(cm_trace_t *trace, const vec3_t start, const vec3_t end, int32_t mask) {
+	int32_t stack[BVH_MAX_DEPTH + 1];
+	int32_t depth = 0;
+
+	vec3_t mins, maxs, inv_dir;
+	BVH_InitRay(start, end, mins, maxs, inv_dir);
+
+	memset(trace, 0, sizeof(*trace));
+	trace->fraction = 1.0;
+
+	stack[depth++] = 0;
+
+	while (depth) {
+		const bvh_node_t *node = &bvh_tree.nodes[stack[--depth]];
+
+		if (!BVH_IntersectNode(node, start, inv_dir, trace->fraction)) {
+			continue;
+		}
+
+		if (node->count) {
+			for (int32_t i = node->first; i < node->first + node->count; i++) {
+				const bvh_brush_t *b = &bvh_tree.brushes[i];
+
+				if (!(b->contents & mask)) {
+					continue;
+				}
+
+				if (!BoxIntersect(mins, maxs, b->mins, b->maxs)) {
+					continue;
+				}
+
+				BVH_TraceToBrush(trace, start, end, b);
+
+				if (trace->all_solid) {
+					break;
+				}
+			}
+
+			if (trace->all_solid) {
+				break;
+			}
+		} else {
+			const int32_t near = (node - bvh_tree.nodes) + 1, far = node->first;
+
+			// visit the child nearer the start first, so that the far child may be culled
+			const vec_t *near_mins = bvh_tree.nodes[near].mins, *far_mins = bvh_tree.nodes[far].mins;
+			const int32_t axis = fabsf(inv_dir[0]) < fabsf(inv_dir[1]) ?
+			                     (fabsf(inv_dir[0]) < fabsf(inv_dir[2]) ? 0 : 2) :
+			                     (fabsf(inv_dir[1]) < fabsf(inv_dir[2]) ? 1 : 2);
+
+			if ((near_mins[axis] < far_mins[axis]) == (inv_dir[axis] > 0.0)) {
+				stack[depth++] = far;
+				stack[depth++] = near;
+			} else {
+				stack[depth++] = near;
+				stack[depth++] = far;
+			}
+		}
+	}
+
+	if (trace->fraction == 0.0) {
+		VectorCopy(start, trace->end);
+	} else if (trace->fraction == 1.0) {
+		VectorCopy(end, trace->end);
+	} else {
+		VectorLerp(start, end, trace->fraction, trace->end);
+	}
+}
+
+/**
+ * @return The mask of rays in the packet which intersect the node's bounds.
+ */
+static uint32_t BVH_IntersectPacket(const bvh_node_t *node, const bvh_packet_t *packet) {
+
+#if defined(__SSE__)
+	__m128 t_min = _mm_setzero_ps();
+	__m128 t_max = _mm_set1_ps(1.0);
+
+	for (int32_t i = 0; i < 3; i++) {
+		const __m128 origin = _mm_loadu_ps(packet->origin[i]);
+		const __m128 inv_dir = _mm_loadu_ps(packet->inv_dir[i]);
+
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->mins[i] - 1.0), origin), inv_dir);
+		const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->maxs[i] + 1.0), origin), inv_dir);
+
+		t_min = _mm_max_ps(t_min, _mm_min_ps(t1, t2));
+		t_max = _mm_min_ps(t_max, _mm_max_ps(t1, t2));
+	}
+
+	return _mm_movemask_ps(_mm_cmple_ps(t_min, t_max));
+#else
+	uint32_t mask = 0;
+
+	for (uint32_t j = 0; j < BVH_PACKET_SIZE; j++) {
+		vec_t t_min = 0.0, t_max = 1.0;
+
+		for (int32_t i = 0; i < 3; i++) {
+			const vec_t t1 = (node->mins[i] - 1.0 - packet->origin[i][j]) * packet->inv_dir[i][j];
+			const vec_t t2 = (node->maxs[i] + 1.0 - packet->origin[i][j]) * packet->inv_dir[i][j];
+
+			t_min = Max(t_min, Min(t1, t2));
+			t_max = Min(t_max, Max(t1, t2));
+		}
+
+		if (t_min <= t_max) {
+			mask |= (1 << j);
+		}
+	}
+
+	return mask;
+#endif
+}
+
+/**
+ * @brief Tests whether each of the specified segments is occluded by a brush
+ * matching mask, as Light_Trace would with a fraction less than 1.0. Segments
+ * are traced in packets, and each leaves its packet once it is occluded.
+ *
+ * @param starts The segment start points.
+ * @param ends The segment end points.
+ * @param count The number of segments.
+ * @param mask The contents mask.
+ * @param occluded Receives true for each occluded segment, false otherwise.
+ */
+void BVH_Occluded(const vec3_t *starts, const vec3_t *ends, size_t count, int32_t mask, _Bool *occluded) {
+
+	for (size_t i = 0; i < count; i += BVH_PACKET_SIZE) {
+		bvh_packet_t packet;
+		uint32_t active = 0;
+
+		for (uint32_t j = 0; j < BVH_PACKET_SIZE; j++) {
+			const size_t k = i + j < count ? i + j : i; // pad with the first segment
+
+			VectorCopy(starts[k], packet.start[j]);
+			VectorCopy(ends[k], packet.end[j]);
+
+			vec3_t inv_dir;
+			BVH_InitRay(starts[k], ends[k], packet.mins[j], packet.maxs[j], inv_dir);
+
+			for (int32_t l = 0; l < 3; l++) {
+				packet.origin[l][j] = starts[k][l];
+				packet.inv_dir[l][j] = inv_dir[l];
+			}
+
+			if (i + j < count) {
+				occluded[k] = false;
+				active |= (1 << j);
+			}
+		}
+
+		int32_t stack[BVH_MAX_DEPTH + 1];
+		uint32_t masks[BVH_MAX_DEPTH + 1];
+		int32_t depth = 0;
+
+		stack[depth] = 0;
+		masks[depth++] = active;
+
+		while (depth) {
+			depth--;
+
+			const bvh_node_t *node = &bvh_tree.nodes[stack[depth]];
+
+			// rays occluded since this node was pushed leave the packet
+			const uint32_t rays = BVH_IntersectPacket(node, &packet) & masks[depth] & active;
+			if (!rays) {
+				continue;
+			}
+
+			if (node->count) {
+				for (uint32_t j = 0; j < BVH_PACKET_SIZE; j++) {
+					if (!(rays & (1 << j))) {
+						continue;
+					}
+
+					cm_trace_t trace = { .fraction = 1.0 };
+
+					for (int32_t l = node->first; l < node->first + node->count; l++) {
+						const bvh_brush_t *b = &bvh_tree.brushes[l];
+
+						if (!(b->contents & mask)) {
+							continue;
+						}
+
+						if (!BoxIntersect(packet.mins[j], packet.maxs[j], b->mins, b->maxs)) {
+							continue;
+						}
+
+						BVH_TraceToBrush(&trace, packet.start[j], packet.end[j], b);
+
+						if (trace.fraction < 1.0) {
+							occluded[i + j] = true;
+							active &= ~(1 << j);
+							break;
+						}
+					}
+				}
+			} else {
+				stack[depth] = node->first;
+				masks[depth++] = rays;
+
+				stack[depth] = (node - bvh_tree.nodes) + 1;
+				masks[depth++] = rays;
+			}
+
+			if (!active) {
+				break;
+			}
+		}
+	}
+}
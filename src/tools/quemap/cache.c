@@ -0,0 +1,225 @@
+/*
+ * Copyright(c) 1997-2001 id Software, Inc.
+ * Copyright(c) 2002 The Quakeforge Project.
+ * Copyright(c) 2006 Quetoo.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "quemap.h"
+
+/*
+ * The stage cache stores the outputs of expensive compile stages in the write
+ * directory, under the hash of everything that they were computed from. A
+ * subsequent compile whose inputs hash the same simply loads the output back.
+ * Nothing is ever invalidated explicitly: changed inputs yield a new key.
+ */
+
+/**
+ * @brief Bump this whenever the output of a cached stage changes for the
+ * same inputs, to orphan all existing entries.
+ */
+#define CACHE_VERSION 1
+
+/**
+ * @brief Every cache entry begins with this header, so that truncated or
+ * foreign files are treated as misses.
+ */
+typedef struct {
+	int32_t ident;
+	int32_t version;
+	int64_t length;
+} cache_header_t;
+
+#define CACHE_IDENT (('C' << 24) + ('M' << 16) + ('Q' << 8) + 'Q')
+
+static const char *cache_stage_names[CACHE_STAGES] = {
+	"bsp",
+	"vis",
+	"light"
+};
+
+static struct {
+	int32_t hits, misses;
+	int64_t bytes;
+} cache_stats[CACHE_STAGES];
+
+/**
+ * @brief Initializes the key for an output of the specified stage.
+ */
+void Cache_InitKey(cache_key_t *key, cache_stage_t stage) {
+
+	key->stage = stage;
+	key->checksum = g_checksum_new(G_CHECKSUM_SHA1);
+
+	const int32_t version = CACHE_VERSION;
+
+	Cache_AddKey(key, &version, sizeof(version));
+	Cache_AddKey(key, &legacy, sizeof(legacy));
+	Cache_AddKey(key, REVISION, strlen(REVISION));
+	Cache_AddKey(key, cache_stage_names[stage], strlen(cache_stage_names[stage]));
+}
+
+/**
+ * @brief Copies the key, so that a common prefix need only be hashed once.
+ */
+void Cache_CopyKey(const cache_key_t *in, cache_key_t *out) {
+
+	out->stage = in->stage;
+	out->checksum = g_checksum_copy(in->checksum);
+}
+
+/**
+ * @brief Hashes the specified input into the key.
+ */
+void Cache_AddKey(cache_key_t *key, const void *data, size_t len) {
+	g_checksum_update(key->checksum, data, len);
+}
+
+/**
+ * @brief Frees the key.
+ */
+void Cache_FreeKey(cache_key_t *key) {
+
+	g_checksum_free(key->checksum);
+	key->checksum = NULL;
+}
+
+/**
+ * @brief Resolves the path of the entry for the specified key.
+ */
+static void Cache_Path(cache_key_t *key, char *path, size_t len) {
+
+	const gchar *hash = g_checksum_get_string(key->checksum);
+
+	g_snprintf(path, len, "cache/%s/%.2s/%s", cache_stage_names[key->stage], hash, hash);
+}
+
+/**
+ * @brief Loads the output for the specified key, if it has been cached.
+ * @return The output, which must be freed with Mem_Free, or NULL on a miss.
+ * @remarks This function is safe to call from worker threads. Each key has its own path,
+ * and the file is read without Fs_Load, so only the statistics are updated under the lock.
+ */
+void *Cache_Load(cache_key_t *key, size_t *len) {
+	char path[MAX_QPATH];
+	void *buffer = NULL;
+
+	*len = 0;
+
+	if (!cache) {
+		return NULL;
+	}
+
+	Cache_Path(key, path, sizeof(path));
+
+	// read the entry directly, as Fs_Load registers its buffers in a table shared by all threads
+	file_t *file = Fs_OpenRead(path);
+	if (file) {
+		cache_header_t header;
+
+		const int64_t file_len = Fs_FileLength(file);
+
+		if (Fs_Read(file, &header, sizeof(header), 1) == 1 &&
+		        header.ident == CACHE_IDENT &&
+		        header.version == CACHE_VERSION &&
+		        header.length == file_len - (int64_t) sizeof(header)) {
+
+			buffer = Mem_TagMalloc(Max(header.length, 1), MEM_TAG_CACHE);
+
+			if (header.length == 0 || Fs_Read(file, buffer, header.length, 1) == 1) {
+				*len = header.length;
+			} else {
+				Mem_Free(buffer);
+				buffer = NULL;
+			}
+		}
+
+		if (buffer == NULL) {
+			Com_Warn("Ignoring invalid cache entry %s\n", path);
+		}
+
+		Fs_Close(file);
+	}
+
+	ThreadLock();
+
+	if (buffer) {
+		cache_stats[key->stage].hits++;
+		cache_stats[key->stage].bytes += *len;
+	} else {
+		cache_stats[key->stage].misses++;
+	}
+
+	ThreadUnlock();
+
+	return buffer;
+}
+
+/**
+ * @brief Stores the output for the specified key.
+ * @remarks This function is safe to call from worker threads.
+ */
+void Cache_Store(cache_key_t *key, const void *data, size_t len) {
+	char path[MAX_QPATH];
+
+	if (!cache) {
+		return;
+	}
+
+	Cache_Path(key, path, sizeof(path));
+
+	file_t *file = Fs_OpenWrite(path);
+	if (file) {
+		const cache_header_t header = {
+			.ident = CACHE_IDENT,
+			.version = CACHE_VERSION,
+			.length = len
+		};
+
+		if (Fs_Write(file, &header, sizeof(header), 1) != 1 || (len && Fs_Write(file, data, len, 1) != 1)) {
+			Com_Warn("Failed to write %s: %s\n", path, Fs_LastError());
+		}
+
+		Fs_Close(file);
+	} else {
+		Com_Warn("Failed to open %s: %s\n", path, Fs_LastError());
+	}
+}
+
+/**
+ * @brief Prints the hit rate of each stage which consulted the cache.
+ */
+void Cache_Report(void) {
+
+	if (!cache) {
+		return;
+	}
+
+	Com_Print("\nCache:\n");
+
+	for (int32_t i = 0; i < CACHE_STAGES; i++) {
+		const int32_t total = cache_stats[i].hits + cache_stats[i].misses;
+
+		if (total == 0) {
+			continue;
+		}
+
+		Com_Print(" %-5s %d of %d hits (%.1f%%), %.1f KB loaded\n", cache_stage_names[i],
+		          cache_stats[i].hits, total, 100.0 * cache_stats[i].hits / total,
+		          cache_stats[i].bytes / 1024.0);
+	}
+}
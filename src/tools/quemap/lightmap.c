@@ -230,6 +230,17 @@ static void CalcSamplePoints(const light_info_t *l, vec_t sofs, vec_t tofs, vec_
 	}
 }
 
+/**
+ * @brief A reflected light sample, landing on the sample of another face.
+ */
+typedef struct {
+	int32_t face_num;
+	int32_t sample;
+	vec3_t color;
+	vec3_t direction; // back towards the reflecting surface
+	vec_t scale; // attenuation over the distance travelled
+} photon_t;
+
 /**
  * @brief Light sample accumulation for each face.
  */
@@ -239,6 +250,10 @@ typedef struct {
 	vec_t *direct;
 	vec_t *directions;
 	vec_t *indirect;
+	vec_t *bounce; // the light reflected in the next bounce, initially the direct light
+	vec_t *bounce_directions;
+	photon_t *photons; // the light reflected by this face in the current bounce
+	int32_t num_photons;
 } face_lighting_t;
 
 static face_lighting_t face_lighting[MAX_BSP_FACES];
@@ -253,11 +268,51 @@ typedef struct light_s { // a light source
 	vec3_t color;
 	vec3_t normal; // spotlight direction
 	vec_t stopdot; // spotlight cone
+
+	int32_t cluster;
+	int32_t num; // the order in which lights are gathered
+	vec_t radius; // beyond which the light contributes nothing, or 0.0 if unbounded
 } light_t;
 
 static light_t *lights[MAX_BSP_LEAFS];
 static int32_t num_lights;
 
+/**
+ * @brief The maximum number of grid cells along each axis.
+ */
+#define LIGHT_GRID_DIMS 64
+
+/**
+ * @brief The minimum size of a grid cell, in world units.
+ */
+#define LIGHT_GRID_CELL_SIZE 64.0
+
+/**
+ * @brief Lights whose influence would span more cells than this are treated
+ * as unbounded, rather than being added to every cell.
+ */
+#define LIGHT_GRID_MAX_CELLS 4096
+
+/**
+ * @brief A uniform grid over the world, listing in each cell the lights whose
+ * influence reaches it. Lights of unbounded influence remain bucketed by
+ * cluster. Both are listed in the order in which lights are gathered, so that
+ * samples accumulate light in the same order regardless of which were culled.
+ */
+static struct {
+	vec3_t mins;
+	vec_t cell_size;
+	int32_t dims[3];
+
+	int32_t *offsets; // per cell, into lights, with a trailing sentinel
+	const light_t **lights;
+
+	int32_t *cluster_offsets; // per cluster, into unbounded, with a trailing sentinel
+	const light_t **unbounded;
+
+	const light_t **all; // by num, for hashing the lights which reach a face
+} light_grid;
+
 // sunlight, borrowed from ufo2map
 typedef struct {
 	vec_t light;
@@ -284,6 +339,165 @@ static entity_t *FindTargetEntity(const char *target) {
 	return NULL;
 }
 
+/**
+ * @brief Resolves the radius beyond which the light's contribution can not
+ * exceed the light threshold.
+ * @return The radius, 0.0 if unbounded, or -1.0 if the light contributes nothing.
+ */
+static vec_t LightRadius(const light_t *l) {
+
+	switch (l->type) {
+		case LIGHT_POINT:
+		case LIGHT_SPOT: // linear falloff, of at least the distance
+			return l->intensity - light_threshold > 0.0 ? l->intensity - light_threshold : -1.0;
+
+		case LIGHT_FACE: // exponential falloff
+			if (l->intensity <= 0.0) {
+				return -1.0;
+			}
+			return light_threshold > 0.0 ? sqrt(l->intensity / light_threshold) : 0.0;
+
+		default:
+			return 0.0;
+	}
+}
+
+/**
+ * @brief Resolves the grid cell coordinates containing the specified point,
+ * clamped to the grid.
+ */
+static void LightGridCoords(const vec3_t point, int32_t *coords) {
+
+	for (int32_t i = 0; i < 3; i++) {
+		const int32_t c = (int32_t) floor((point[i] - light_grid.mins[i]) / light_grid.cell_size);
+		coords[i] = Clamp(c, 0, light_grid.dims[i] - 1);
+	}
+}
+
+/**
+ * @brief Resolves the range of grid cells which the light's influence reaches.
+ * @return The number of cells in the range.
+ */
+static int32_t LightGridRange(const light_t *l, int32_t *lo, int32_t *hi) {
+	vec3_t mins, maxs;
+
+	for (int32_t i = 0; i < 3; i++) {
+		mins[i] = l->origin[i] - l->radius;
+		maxs[i] = l->origin[i] + l->radius;
+	}
+
+	LightGridCoords(mins, lo);
+	LightGridCoords(maxs, hi);
+
+	return (hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+}
+
+/**
+ * @brief Indexes the lights by the grid cells their influence reaches. Lights
+ * are visited in the order of their cluster buckets, which is the order in
+ * which they are gathered.
+ */
+static void BuildLightGrid(void) {
+
+	const bsp_model_t *world = &bsp_file.models[0];
+
+	vec3_t size;
+	VectorSubtract(world->maxs, world->mins, size);
+
+	const vec_t max_size = Max(size[0], Max(size[1], size[2]));
+
+	VectorCopy(world->mins, light_grid.mins);
+	light_grid.cell_size = Max(LIGHT_GRID_CELL_SIZE, max_size / LIGHT_GRID_DIMS);
+
+	int32_t num_cells = 1;
+	for (int32_t i = 0; i < 3; i++) {
+		light_grid.dims[i] = Clamp((int32_t) ceil(size[i] / light_grid.cell_size), 1, LIGHT_GRID_DIMS);
+		num_cells *= light_grid.dims[i];
+	}
+
+	const int32_t num_clusters = bsp_file.vis_data.vis->num_clusters;
+
+	light_grid.offsets = Mem_TagMalloc((num_cells + 1) * sizeof(int32_t), MEM_TAG_LIGHT);
+	light_grid.cluster_offsets = Mem_TagMalloc((num_clusters + 1) * sizeof(int32_t), MEM_TAG_LIGHT);
+	light_grid.unbounded = Mem_TagMalloc(Max(num_lights, 1) * sizeof(light_t *), MEM_TAG_LIGHT);
+	light_grid.all = Mem_TagMalloc(Max(num_lights, 1) * sizeof(light_t *), MEM_TAG_LIGHT);
+
+	int32_t num = 0, num_unbounded = 0, culled = 0;
+
+	// resolve the radius of each light, and count the lights of each cell
+	for (int32_t i = 0; i < num_clusters; i++) {
+
+		light_grid.cluster_offsets[i] = num_unbounded;
+
+		for (light_t *l = lights[i]; l; l = l->next) {
+
+			l->cluster = i;
+			l->num = num++;
+			l->radius = LightRadius(l);
+
+			light_grid.all[l->num] = l;
+
+			if (l->radius < 0.0) {
+				culled++;
+				continue;
+			}
+
+			int32_t lo[3], hi[3];
+			if (l->radius == 0.0 || LightGridRange(l, lo, hi) > LIGHT_GRID_MAX_CELLS) {
+				l->radius = 0.0;
+				light_grid.unbounded[num_unbounded++] = l;
+				continue;
+			}
+
+			for (int32_t z = lo[2]; z <= hi[2]; z++) {
+				for (int32_t y = lo[1]; y <= hi[1]; y++) {
+					for (int32_t x = lo[0]; x <= hi[0]; x++) {
+						light_grid.offsets[(z * light_grid.dims[1] + y) * light_grid.dims[0] + x + 1]++;
+					}
+				}
+			}
+		}
+	}
+
+	light_grid.cluster_offsets[num_clusters] = num_unbounded;
+
+	for (int32_t i = 0; i < num_cells; i++) {
+		light_grid.offsets[i + 1] += light_grid.offsets[i];
+	}
+
+	light_grid.lights = Mem_TagMalloc(Max(light_grid.offsets[num_cells], 1) * sizeof(light_t *), MEM_TAG_LIGHT);
+
+	int32_t *fill = Mem_TagMalloc(num_cells * sizeof(int32_t), MEM_TAG_LIGHT);
+	memcpy(fill, light_grid.offsets, num_cells * sizeof(int32_t));
+
+	// and list them, in order
+	for (int32_t i = 0; i < num_clusters; i++) {
+		for (light_t *l = lights[i]; l; l = l->next) {
+
+			if (l->radius <= 0.0) {
+				continue;
+			}
+
+			int32_t lo[3], hi[3];
+			LightGridRange(l, lo, hi);
+
+			for (int32_t z = lo[2]; z <= hi[2]; z++) {
+				for (int32_t y = lo[1]; y <= hi[1]; y++) {
+					for (int32_t x = lo[0]; x <= hi[0]; x++) {
+						light_grid.lights[fill[(z * light_grid.dims[1] + y) * light_grid.dims[0] + x]++] = l;
+					}
+				}
+			}
+		}
+	}
+
+	Mem_Free(fill);
+
+	Com_Verbose("Indexed %d lights in %dx%dx%d cells of %1.0f units, %d unbounded, %d culled\n",
+	            num - culled, light_grid.dims[0], light_grid.dims[1], light_grid.dims[2],
+	            light_grid.cell_size, num_unbounded, culled);
+}
+
 #define ANGLE_UP	-1.0
 #define ANGLE_DOWN	-2.0
 
@@ -468,6 +682,8 @@ void BuildLights(void) {
 			lightmap_scale = BSP_DEFAULT_LIGHTMAP_SCALE;
 		}
 	}
+
+	BuildLightGrid();
 }
 
 /**
@@ -508,76 +724,161 @@ static void GatherSampleSunlight(const vec3_t pos, const vec3_t normal, vec_t *s
 }
 
 /**
- * @brief Iterate over all light sources for the sample position's PVS, accumulating
- * light and directional information to the specified pointers.
+ * @brief The number of light sources whose shadow rays are traced together.
  */
-static void GatherSampleLight(vec3_t pos, vec3_t normal, byte *pvs, vec_t *sample, vec_t *direction, vec_t scale) {
+#define LIGHT_BATCH 16
 
-	// iterate over lights, which are in buckets by cluster
-	for (int32_t i = 0; i < bsp_file.vis_data.vis->num_clusters; i++) {
+/**
+ * @brief A light source which would illuminate a sample, if it is not occluded.
+ */
+typedef struct {
+	const light_t *light;
+	vec3_t delta;
+	vec_t value;
+} light_candidate_t;
 
-		if (!(pvs[i >> 3] & (1 << (i & 7)))) {
+/**
+ * @brief Traces the shadow rays of the candidate lights to the sample position,
+ * adding light and directional information for those which are not occluded.
+ * Contributions are added in the order in which the candidates were found.
+ */
+static void GatherCandidateLight(const light_candidate_t *candidates, size_t count, const vec3_t pos,
+                                 const vec3_t normal, vec_t *sample, vec_t *direction, vec_t scale) {
+	vec3_t starts[LIGHT_BATCH], ends[LIGHT_BATCH];
+	_Bool occluded[LIGHT_BATCH];
+
+	for (size_t i = 0; i < count; i++) {
+		VectorCopy(candidates[i].light->origin, starts[i]);
+		VectorCopy(pos, ends[i]);
+	}
+
+	Light_Occluded(starts, ends, count, CONTENTS_SOLID, occluded);
+
+	for (size_t i = 0; i < count; i++) {
+
+		if (occluded[i]) {
 			continue;
 		}
 
-		for (light_t *l = lights[i]; l; l = l->next) {
+		const light_t *l = candidates[i].light;
+		const vec_t light = candidates[i].value;
 
-			vec3_t delta;
-			VectorSubtract(l->origin, pos, delta);
+		// add some light to it
+		VectorMA(sample, light * scale, l->color, sample);
 
-			const vec_t dist = VectorNormalize(delta);
+		// and add some direction
+		vec3_t delta;
+		VectorMix(normal, candidates[i].delta, 2.0 * light / l->intensity, delta);
+		VectorMA(direction, light * scale, delta, direction);
+	}
+}
 
-			const vec_t dot = DotProduct(delta, normal);
-			if (dot <= 0.001) {
-				continue;    // behind sample surface
-			}
+/**
+ * @brief Iterate over all light sources for the sample position's PVS, accumulating
+ * light and directional information to the specified pointers.
+ */
+static void GatherSampleLight(vec3_t pos, vec3_t normal, byte *pvs, vec_t *sample, vec_t *direction, vec_t scale) {
+	light_candidate_t candidates[LIGHT_BATCH];
+	size_t num_candidates = 0;
 
-			vec_t light = 0.0;
+	int32_t coords[3];
+	LightGridCoords(pos, coords);
 
-			switch (l->type) {
-				case LIGHT_POINT: // linear falloff
-					light = (l->intensity - dist) * dot;
-					break;
-
-				case LIGHT_FACE: // exponential falloff
-					light = (l->intensity / (dist * dist)) * dot;
-					break;
-
-				case LIGHT_SPOT: { // linear falloff with cone
-					const vec_t dot2 = -DotProduct(delta, l->normal);
-					if (dot2 > l->stopdot) { // inside the cone
-						light = (l->intensity - dist) * dot;
-					} else { // outside the cone
-						const vec_t decay = 1.0 + l->stopdot - dot2;
-						light = (l->intensity - decay * decay * dist) * dot;
-					}
-				}
-					break;
-				default:
-					Mon_SendPoint(MON_WARN, l->origin, "Light with bad type");
-					break;
+	const int32_t cell = (coords[2] * light_grid.dims[1] + coords[1]) * light_grid.dims[0] + coords[0];
+
+	const light_t **bounded = light_grid.lights + light_grid.offsets[cell];
+	const int32_t num_bounded = light_grid.offsets[cell + 1] - light_grid.offsets[cell];
+
+	const int32_t num_clusters = bsp_file.vis_data.vis->num_clusters;
+
+	int32_t cluster = 0, j = 0, j_end = 0;
+
+	// merge the lights of this cell with the unbounded lights of each cluster in
+	// the PVS, which are both in order
+	for (int32_t i = 0; ;) {
+
+		while (j == j_end && cluster < num_clusters) {
+			if (pvs[cluster >> 3] & (1 << (cluster & 7))) {
+				j = light_grid.cluster_offsets[cluster];
+				j_end = light_grid.cluster_offsets[cluster + 1];
 			}
+			cluster++;
+		}
 
-			if (light <= 0.0) { // no light
+		const light_t *l;
+		if (i < num_bounded && (j == j_end || bounded[i]->num < light_grid.unbounded[j]->num)) {
+			l = bounded[i++];
+
+			if (!(pvs[l->cluster >> 3] & (1 << (l->cluster & 7)))) {
 				continue;
 			}
+		} else if (j < j_end) {
+			l = light_grid.unbounded[j++];
+		} else {
+			break;
+		}
 
-			cm_trace_t trace;
-			Light_Trace(&trace, l->origin, pos, CONTENTS_SOLID);
+		vec3_t delta;
+		VectorSubtract(l->origin, pos, delta);
 
-			if (trace.fraction < 1.0) {
-				continue; // occluded
+		if (l->radius > 0.0 && DotProduct(delta, delta) >= l->radius * l->radius) {
+			continue; // out of range
+		}
+
+		const vec_t dist = VectorNormalize(delta);
+
+		const vec_t dot = DotProduct(delta, normal);
+		if (dot <= 0.001) {
+			continue;    // behind sample surface
+		}
+
+		vec_t light = 0.0;
+
+		switch (l->type) {
+			case LIGHT_POINT: // linear falloff
+				light = (l->intensity - dist) * dot;
+				break;
+
+			case LIGHT_FACE: // exponential falloff
+				light = (l->intensity / (dist * dist)) * dot;
+				break;
+
+			case LIGHT_SPOT: { // linear falloff with cone
+				const vec_t dot2 = -DotProduct(delta, l->normal);
+				if (dot2 > l->stopdot) { // inside the cone
+					light = (l->intensity - dist) * dot;
+				} else { // outside the cone
+					const vec_t decay = 1.0 + l->stopdot - dot2;
+					light = (l->intensity - decay * decay * dist) * dot;
+				}
 			}
+				break;
+			default:
+				Mon_SendPoint(MON_WARN, l->origin, "Light with bad type");
+				break;
+		}
 
-			// add some light to it
-			VectorMA(sample, light * scale, l->color, sample);
+		if (light <= light_threshold) { // no light, or too little to trace
+			continue;
+		}
+
+		// trace the shadow rays of several lights at once
+		light_candidate_t *c = &candidates[num_candidates++];
 
-			// and add some direction
-			VectorMix(normal, delta, 2.0 * light / l->intensity, delta);
-			VectorMA(direction, light * scale, delta, direction);
+		c->light = l;
+		VectorCopy(delta, c->delta);
+		c->value = light;
+
+		if (num_candidates == LIGHT_BATCH) {
+			GatherCandidateLight(candidates, num_candidates, pos, normal, sample, direction, scale);
+			num_candidates = 0;
 		}
 	}
 
+	if (num_candidates) {
+		GatherCandidateLight(candidates, num_candidates, pos, normal, sample, direction, scale);
+	}
+
 	GatherSampleSunlight(pos, normal, sample, direction, scale);
 }
 
@@ -744,6 +1045,273 @@ static const vec_t sampleofs[MAX_SAMPLES][2] = {
 	{ -0.5, 0.5 }
 };
 
+/**
+ * @brief The inputs common to the lighting of all faces, hashed only when caching.
+ */
+static cache_key_t lighting_key;
+
+/**
+ * @brief Hashes the inputs common to the lighting of all faces: the options, the sun and
+ * the world's geometry and visibility. Faces' lightmap offsets, written by previous light
+ * compiles, are excluded.
+ */
+void BuildLightingCacheKey(void) {
+
+	if (!cache) {
+		return;
+	}
+
+	cache_key_t *key = &lighting_key;
+	Cache_InitKey(key, CACHE_LIGHT);
+
+	Cache_AddKey(key, &antialias, sizeof(antialias));
+	Cache_AddKey(key, &bvh, sizeof(bvh));
+	Cache_AddKey(key, &light_threshold, sizeof(light_threshold));
+	Cache_AddKey(key, &lightmap_scale, sizeof(lightmap_scale));
+
+	Cache_AddKey(key, &sun.light, sizeof(sun.light));
+	Cache_AddKey(key, sun.color, sizeof(sun.color));
+	Cache_AddKey(key, sun.dir, sizeof(sun.dir));
+
+	Cache_AddKey(key, bsp_file.planes, bsp_file.num_planes * sizeof(bsp_plane_t));
+	Cache_AddKey(key, bsp_file.vertexes, bsp_file.num_vertexes * sizeof(bsp_vertex_t));
+	Cache_AddKey(key, bsp_file.vis_data.raw, bsp_file.vis_data_size);
+	Cache_AddKey(key, bsp_file.nodes, bsp_file.num_nodes * sizeof(bsp_node_t));
+	Cache_AddKey(key, bsp_file.texinfo, bsp_file.num_texinfo * sizeof(bsp_texinfo_t));
+	Cache_AddKey(key, bsp_file.leafs, bsp_file.num_leafs * sizeof(bsp_leaf_t));
+	Cache_AddKey(key, bsp_file.leaf_faces, bsp_file.num_leaf_faces * sizeof(uint16_t));
+	Cache_AddKey(key, bsp_file.leaf_brushes, bsp_file.num_leaf_brushes * sizeof(uint16_t));
+	Cache_AddKey(key, bsp_file.edges, bsp_file.num_edges * sizeof(bsp_edge_t));
+	Cache_AddKey(key, bsp_file.face_edges, bsp_file.num_face_edges * sizeof(int32_t));
+	Cache_AddKey(key, bsp_file.models, bsp_file.num_models * sizeof(bsp_model_t));
+	Cache_AddKey(key, bsp_file.brushes, bsp_file.num_brushes * sizeof(bsp_brush_t));
+	Cache_AddKey(key, bsp_file.brush_sides, bsp_file.num_brush_sides * sizeof(bsp_brush_side_t));
+
+	if (!legacy) {
+		Cache_AddKey(key, bsp_file.normals, bsp_file.num_normals * sizeof(bsp_normal_t));
+	}
+
+	for (int32_t i = 0; i < bsp_file.num_faces; i++) {
+		bsp_face_t face = bsp_file.faces[i];
+
+		memset(face.unused, 0, sizeof(face.unused));
+		face.light_ofs = 0;
+
+		Cache_AddKey(key, &face, sizeof(face));
+	}
+}
+
+/**
+ * @brief Frees the common lighting key.
+ */
+void FreeLightingCacheKey(void) {
+
+	if (lighting_key.checksum) {
+		Cache_FreeKey(&lighting_key);
+	}
+}
+
+/**
+ * @brief Marks the clusters of the leafs which the specified bounds touch.
+ */
+static void BoundsClusters_r(int32_t node_num, const vec3_t mins, const vec3_t maxs, byte *clusters) {
+
+	while (node_num >= 0) {
+		const bsp_node_t *node = &bsp_file.nodes[node_num];
+		const bsp_plane_t *plane = &bsp_file.planes[node->plane_num];
+
+		// resolve the extents of the bounds along the plane normal
+		vec_t lo = -plane->dist, hi = -plane->dist;
+
+		for (int32_t i = 0; i < 3; i++) {
+			if (plane->normal[i] > 0.0) {
+				lo += plane->normal[i] * mins[i];
+				hi += plane->normal[i] * maxs[i];
+			} else {
+				lo += plane->normal[i] * maxs[i];
+				hi += plane->normal[i] * mins[i];
+			}
+		}
+
+		// and descend as Light_PointLeafnum would for any point within them
+		if (lo > 0.0) {
+			node_num = node->children[0];
+		} else if (hi <= 0.0) {
+			node_num = node->children[1];
+		} else {
+			BoundsClusters_r(node->children[0], mins, maxs, clusters);
+			node_num = node->children[1];
+		}
+	}
+
+	const int32_t cluster = bsp_file.leafs[-node_num - 1].cluster;
+	if (cluster != -1) {
+		clusters[cluster >> 3] |= 1 << (cluster & 7);
+	}
+}
+
+/**
+ * @brief Resolves the union of the PVS of every leaf which the specified bounds touch, which
+ * includes the PVS of any sample position within them.
+ */
+static void BoundsPVS(const vec3_t mins, const vec3_t maxs, byte *pvs) {
+
+	const int32_t num_clusters = bsp_file.vis_data.vis->num_clusters;
+	const int32_t row = (num_clusters + 7) >> 3;
+
+	if (!bsp_file.vis_data_size) {
+		memset(pvs, 0xff, row);
+		return;
+	}
+
+	byte clusters[MAX_BSP_LEAFS >> 3];
+	memset(clusters, 0, row);
+
+	BoundsClusters_r(0, mins, maxs, clusters);
+
+	memset(pvs, 0, row);
+
+	for (int32_t i = 0; i < num_clusters; i++) {
+
+		if (!(clusters[i >> 3] & (1 << (i & 7)))) {
+			continue;
+		}
+
+		byte cluster_pvs[MAX_BSP_LEAFS >> 3];
+		Bsp_DecompressVis(&bsp_file, bsp_file.vis_data.raw + bsp_file.vis_data.vis->bit_offsets[i][DVIS_PVS],
+		                  cluster_pvs);
+
+		for (int32_t j = 0; j < row; j++) {
+			pvs[j] |= cluster_pvs[j];
+		}
+	}
+}
+
+/**
+ * @brief Hashes the inputs to the direct lighting of the specified face: the common inputs,
+ * the face's bmodel offset, and every light which may reach its samples. These are the lights
+ * of the grid cells the samples occupy, and the unbounded lights of the clusters potentially
+ * visible to them. Lights are hashed in the order in which they are gathered, without their
+ * index, so that adding, removing or changing lights elsewhere in the map does not invalidate
+ * the face.
+ */
+static void HashFaceLighting(const light_info_t *l, int32_t face_num, int32_t num_passes, cache_key_t *key) {
+
+	Cache_CopyKey(&lighting_key, key);
+
+	Cache_AddKey(key, &face_num, sizeof(face_num));
+	Cache_AddKey(key, l->model_org, sizeof(vec3_t));
+
+	// resolve the bounds of the samples, including any nudging
+	vec3_t mins, maxs;
+	ClearBounds(mins, maxs);
+
+	for (int32_t i = 0; i < l->num_sample_points * num_passes; i++) {
+		AddPointToBounds(l->sample_points + i * 3, mins, maxs);
+	}
+
+	for (int32_t i = 0; i < 3; i++) {
+		mins[i] -= SAMPLE_NUDGE * 2.0 + 1.0;
+		maxs[i] += SAMPLE_NUDGE * 2.0 + 1.0;
+	}
+
+	// and mark the lights which may reach them
+	byte *marks = Mem_Malloc(Max(num_lights, 1));
+
+	int32_t lo[3], hi[3];
+	LightGridCoords(mins, lo);
+	LightGridCoords(maxs, hi);
+
+	for (int32_t z = lo[2]; z <= hi[2]; z++) {
+		for (int32_t y = lo[1]; y <= hi[1]; y++) {
+			for (int32_t x = lo[0]; x <= hi[0]; x++) {
+				const int32_t cell = (z * light_grid.dims[1] + y) * light_grid.dims[0] + x;
+
+				for (int32_t i = light_grid.offsets[cell]; i < light_grid.offsets[cell + 1]; i++) {
+					marks[light_grid.lights[i]->num] = true;
+				}
+			}
+		}
+	}
+
+	byte pvs[MAX_BSP_LEAFS >> 3];
+	BoundsPVS(mins, maxs, pvs);
+
+	const int32_t num_clusters = bsp_file.vis_data.vis->num_clusters;
+
+	for (int32_t i = 0; i < num_clusters; i++) {
+
+		if (!(pvs[i >> 3] & (1 << (i & 7)))) {
+			continue;
+		}
+
+		for (int32_t j = light_grid.cluster_offsets[i]; j < light_grid.cluster_offsets[i + 1]; j++) {
+			marks[light_grid.unbounded[j]->num] = true;
+		}
+	}
+
+	for (int32_t i = 0; i < num_lights; i++) {
+
+		if (!marks[i]) {
+			continue;
+		}
+
+		const light_t *light = light_grid.all[i];
+
+		Cache_AddKey(key, &light->type, sizeof(light->type));
+		Cache_AddKey(key, &light->intensity, sizeof(light->intensity));
+		Cache_AddKey(key, light->origin, sizeof(light->origin));
+		Cache_AddKey(key, light->color, sizeof(light->color));
+		Cache_AddKey(key, light->normal, sizeof(light->normal));
+		Cache_AddKey(key, &light->stopdot, sizeof(light->stopdot));
+	}
+
+	Mem_Free(marks);
+}
+
+/**
+ * @brief Restores the direct lighting of the specified face.
+ * @return True on a cache hit, false otherwise.
+ */
+static _Bool LoadCachedFaceLighting(cache_key_t *key, face_lighting_t *fl) {
+	size_t len;
+
+	void *data = Cache_Load(key, &len);
+	if (!data) {
+		return false;
+	}
+
+	const size_t size = fl->num_samples * sizeof(vec3_t);
+
+	if (len != size * 2) {
+		Com_Warn("Invalid cached lighting\n");
+		Mem_Free(data);
+		return false;
+	}
+
+	memcpy(fl->direct, data, size);
+	memcpy(fl->directions, (byte *) data + size, size);
+
+	Mem_Free(data);
+	return true;
+}
+
+/**
+ * @brief Stores the direct lighting of the specified face.
+ */
+static void StoreCachedFaceLighting(cache_key_t *key, const face_lighting_t *fl) {
+
+	const size_t size = fl->num_samples * sizeof(vec3_t);
+	byte *data = Mem_TagMalloc(Max(size * 2, 1), MEM_TAG_CACHE);
+
+	memcpy(data, fl->direct, size);
+	memcpy(data + size, fl->directions, size);
+
+	Cache_Store(key, data, size * 2);
+
+	Mem_Free(data);
+}
+
 /**
  * @brief
  */
@@ -810,6 +1378,21 @@ void DirectLighting(int32_t face_num) {
 	fl->directions = Mem_TagMalloc(fl->num_samples * sizeof(vec3_t), MEM_TAG_FACE_LIGHTING);
 	fl->indirect = Mem_TagMalloc(fl->num_samples * sizeof(vec3_t), MEM_TAG_FACE_LIGHTING);
 
+	fl->bounce = fl->direct;
+	fl->bounce_directions = fl->directions;
+
+	cache_key_t key;
+
+	if (cache) {
+		HashFaceLighting(&light, face_num, num_samples, &key);
+
+		if (LoadCachedFaceLighting(&key, fl)) {
+			Cache_FreeKey(&key);
+			Mem_Free(light.sample_points);
+			return;
+		}
+	}
+
 	const vec_t *center = face_extents[face_num].center; // center of the face
 
 	for (int32_t i = 0; i < fl->num_samples; i++) { // calculate light for each sample
@@ -841,21 +1424,27 @@ void DirectLighting(int32_t face_num) {
 		}
 	}
 
+	if (cache) {
+		StoreCachedFaceLighting(&key, fl);
+		Cache_FreeKey(&key);
+	}
+
 	// free the sample points
 	Mem_Free(light.sample_points);
 }
 
 /**
- * @brief Tests surfaces in the impacted leaf, modulating the lighting sample closest to
+ * @brief Tests surfaces in the impacted leaf, resolving the lighting sample closest to
  * the impact point.
+ * @return True if a sample was found, with the photon's face and sample set.
  */
-static void IndirectLightingImpact(const cm_trace_t *trace, const vec3_t color) {
+static _Bool IndirectLightingImpact(const cm_trace_t *trace, photon_t *photon) {
 
 	const int32_t leaf_num = Light_PointLeafnum(trace->end);
 
 	if (leaf_num == -1) {
 		Com_Debug(DEBUG_ALL, "Invalid leaf @ %s: %s\n", vtos(trace->end), trace->surface->name);
-		return;
+		return false;
 	}
 
 	const bsp_leaf_t *leaf = &bsp_file.leafs[leaf_num];
@@ -877,10 +1466,10 @@ static void IndirectLightingImpact(const cm_trace_t *trace, const vec3_t color)
 			continue;
 		}
 
-		face_lighting_t *lighting = &face_lighting[face - bsp_file.faces];
+		const face_lighting_t *lighting = &face_lighting[face - bsp_file.faces];
 
 		vec_t best_dist = MAX_WORLD_DIST;
-		vec_t *sample = NULL;
+		int32_t sample = -1;
 
 		for (int32_t j = 0; j < lighting->num_samples; j++) {
 			const vec_t *org = lighting->origins + j * 3;
@@ -890,24 +1479,29 @@ static void IndirectLightingImpact(const cm_trace_t *trace, const vec3_t color)
 
 			const vec_t dist = VectorLengthSquared(delta);
 			if (dist < best_dist) {
-				sample = lighting->indirect + j * 3;
+				sample = j;
 				best_dist = dist;
 			}
 		}
 
-		if (sample) {
-			VectorMA(sample, 1.0 - trace->fraction, color, sample);
+		if (sample == -1) {
+			return false;
 		}
 
-		break; // once we've hit a surface, we can skip the rest of the leaf
+		photon->face_num = (int32_t) (face - bsp_file.faces);
+		photon->sample = sample;
+		return true; // once we've hit a surface, we can skip the rest of the leaf
 	}
+
+	return false;
 }
 
 /**
- * @brief Calculates indirect lighting via photon bouncing.
- * @details Direct lighting results are reflected outwards. Hits on neighboring surfaces are
- * traced to their lightmap sample, much like stain mapping.
- * @remarks TODO: Ensure this is thread safe for impacted faces.
+ * @brief Calculates one bounce of indirect lighting via photon bouncing.
+ * @details The light received by this face in the previous bounce (or its direct lighting,
+ * for the first bounce) is reflected outwards. Hits on neighboring surfaces are traced to
+ * their lightmap sample, much like stain mapping, and recorded as photons on this face only,
+ * so that faces may be bounced in parallel. BounceIndirectLighting then merges them.
  */
 void IndirectLighting(int32_t face_num) {
 
@@ -918,6 +1512,12 @@ void IndirectLighting(int32_t face_num) {
 		return; // we have no light to reflect
 	}
 
+	face_lighting_t *source_lighting = &face_lighting[face_num];
+
+	if (!source_lighting->num_samples) {
+		return;
+	}
+
 	const cm_material_t *material = LoadMaterial(texinfo->texture, ASSET_CONTEXT_TEXTURES);
 	const bsp_plane_t *plane = &bsp_file.planes[face->plane_num];
 
@@ -929,18 +1529,23 @@ void IndirectLighting(int32_t face_num) {
 		VectorCopy(plane->normal, normal);
 	}
 
-	const face_lighting_t *source_lighting = &face_lighting[face_num];
+	photon_t *photons = Mem_TagMalloc(source_lighting->num_samples * sizeof(photon_t), MEM_TAG_FACE_LIGHTING);
+	int32_t num_photons = 0;
 
 	for (int32_t i = 0; i < source_lighting->num_samples; i++) {
 
 		const vec_t *org = source_lighting->origins + i * 3;
-		const vec_t *sample = source_lighting->direct + i * 3;
-		const vec_t *direction = source_lighting->directions + i * 3;
+		const vec_t *sample = source_lighting->bounce + i * 3;
+		const vec_t *direction = source_lighting->bounce_directions + i * 3;
 
 		vec3_t color;
 		VectorCopy(sample, color);
 
 		const vec_t light = VectorLength(color) * material->hardness;
+		if (light == 0.0) {
+			continue;
+		}
+
 		ColorNormalize(color, color);
 
 		vec3_t reflect;
@@ -958,7 +1563,67 @@ void IndirectLighting(int32_t face_num) {
 
 		assert(trace.surface);
 
-		IndirectLightingImpact(&trace, color);
+		photon_t *photon = &photons[num_photons];
+
+		if (IndirectLightingImpact(&trace, photon)) {
+			VectorCopy(color, photon->color);
+			VectorNegate(reflect, photon->direction);
+			photon->scale = 1.0 - trace.fraction;
+			num_photons++;
+		}
+	}
+
+	source_lighting->photons = photons;
+	source_lighting->num_photons = num_photons;
+}
+
+/**
+ * @brief Merges the photons of the current bounce into the indirect lighting of the faces
+ * they landed on, which will in turn reflect them in the next bounce.
+ * @details Photons are accumulated serially in face and sample order, so the result does
+ * not depend on the number of threads, or the order in which faces were bounced.
+ */
+void BounceIndirectLighting(void) {
+
+	for (int32_t i = 0; i < bsp_file.num_faces; i++) {
+		face_lighting_t *fl = &face_lighting[i];
+
+		if (!fl->num_samples) {
+			continue;
+		}
+
+		if (fl->bounce == fl->direct) {
+			fl->bounce = Mem_TagMalloc(fl->num_samples * sizeof(vec3_t), MEM_TAG_FACE_LIGHTING);
+			fl->bounce_directions = Mem_TagMalloc(fl->num_samples * sizeof(vec3_t), MEM_TAG_FACE_LIGHTING);
+		} else {
+			memset(fl->bounce, 0, fl->num_samples * sizeof(vec3_t));
+			memset(fl->bounce_directions, 0, fl->num_samples * sizeof(vec3_t));
+		}
+	}
+
+	for (int32_t i = 0; i < bsp_file.num_faces; i++) {
+		face_lighting_t *fl = &face_lighting[i];
+
+		const photon_t *photon = fl->photons;
+		for (int32_t j = 0; j < fl->num_photons; j++, photon++) {
+			face_lighting_t *lighting = &face_lighting[photon->face_num];
+
+			vec_t *indirect = lighting->indirect + photon->sample * 3;
+			VectorMA(indirect, photon->scale, photon->color, indirect);
+
+			vec_t *bounce = lighting->bounce + photon->sample * 3;
+			VectorMA(bounce, photon->scale, photon->color, bounce);
+
+			vec_t *direction = lighting->bounce_directions + photon->sample * 3;
+			VectorMA(direction, photon->scale, photon->direction, direction);
+		}
+
+		if (fl->photons) {
+			Mem_Free(fl->photons);
+		}
+
+		fl->photons = NULL;
+		fl->num_photons = 0;
 	}
 }
 
@@ -41,6 +41,7 @@ char bsp_name[MAX_OS_PATH]; // the input bsp name (e.g. "maps/edge.bsp")
 _Bool verbose = false;
 _Bool debug = false;
 _Bool legacy = false;
+_Bool cache = false;
 static _Bool is_monitor = false;
 
 static void Print(const char *msg);
@@ -266,6 +267,13 @@ static void Check_LIGHT_Options(int32_t argc) {
 		} if (!g_strcmp0(Com_Argv(i), "-indirect")) {
 			indirect = true;
 			Com_Verbose("indirect lighting: true\n");
+		} else if (!g_strcmp0(Com_Argv(i), "-bounces")) {
+			indirect_bounces = Max(atoi(Com_Argv(i + 1)), 1);
+			Com_Verbose("indirect bounces: %d\n", indirect_bounces);
+			i++;
+		} else if (!g_strcmp0(Com_Argv(i), "-bvh")) {
+			bvh = true;
+			Com_Verbose("bvh: true\n");
 		} else if (!g_strcmp0(Com_Argv(i), "-brightness")) {
 			brightness = atof(Com_Argv(i + 1));
 			Com_Verbose("brightness: %f\n", brightness);
@@ -286,6 +294,10 @@ static void Check_LIGHT_Options(int32_t argc) {
 			entity_scale *= atof(Com_Argv(i + 1));
 			Com_Verbose("entity light scale: %f\n", entity_scale);
 			i++;
+		} else if (!g_strcmp0(Com_Argv(i), "-threshold")) {
+			light_threshold = atof(Com_Argv(i + 1));
+			Com_Verbose("light threshold: %f\n", light_threshold);
+			i++;
 		} else if (!g_strcmp0(Com_Argv(i), "-patch")) {
 			patch_size = atof(Com_Argv(i + 1));
 			Com_Verbose("patch size: %f\n", patch_size);
@@ -322,6 +334,7 @@ static void PrintHelpMessage(void) {
 	Com_Print("-v -verbose\n");
 	Com_Print("-d -debug\n");
 	Com_Print("-l -legacy - compile a legacy Quake II map\n");
+	Com_Print("-cache - reuse stage outputs from previous compiles with the same inputs\n");
 	Com_Print("-t -threads <int> - Specify the number of worker threads (default auto)\n");
 	Com_Print("-p -path <game directory> - add the path to the search directory\n");
 	Com_Print("-w -wpath <game directory> - add the write path to the search directory\n");
@@ -358,12 +371,15 @@ static void PrintHelpMessage(void) {
 	Com_Print("-light             LIGHT stage options:\n");
 	Com_Print(" -antialias - calculate extra lighting samples and average them\n");
 	Com_Print(" -indirect - calculate indirect lighting\n");
+	Com_Print(" -bounces <int> - indirect lighting bounces (default 1)\n");
+	Com_Print(" -bvh - trace lighting with a bounding volume hierarchy of the map's brushes\n");
 	Com_Print(" -entity <float> - entity light scaling\n");
 	Com_Print(" -surface <float> - surface light scaling\n");
 	Com_Print(" -brightness <float> - brightness factor\n");
 	Com_Print(" -contrast <float> - contrast factor\n");
 	Com_Print(" -saturation <float> - saturation factor\n");
 	Com_Print(" -patch <float> - surface light patch size (default 64)\n");
+	Com_Print(" -threshold <float> - skip lights contributing less than this to a sample (default 0)\n");
 	Com_Print("\n");
 
 	Com_Print("-aas               AAS stage options:\n");
@@ -448,6 +464,11 @@ int32_t main(int32_t argc, char **argv) {
 			continue;
 		}
 
+		if (!g_strcmp0(Com_Argv(i), "-cache")) {
+			cache = true;
+			continue;
+		}
+
 		if (!g_strcmp0(Com_Argv(i), "-t") || !g_strcmp0(Com_Argv(i), "-threads")) {
 			num_threads = atoi(Com_Argv(i + 1));
 			continue;
@@ -552,6 +573,8 @@ int32_t main(int32_t argc, char **argv) {
 		ZIP_Main();
 	}
 
+	Cache_Report();
+
 	// emit time
 	const time_t end = time(NULL);
 	const time_t duration = end - start;
@@ -112,6 +112,8 @@ static void ProcessBlock_Thread(int32_t blocknum) {
 	maxs[1] = (yblock + 1) * 1024;
 	maxs[2] = MAX_WORLD_COORD;
 
+	// brush lists are made under the lock, as making them may add planes, but the
+	// trees of the blocks are built in parallel, and spawn jobs of their own
 	ThreadLock();
 
 	// the makelist and chopbrushes could be cached between the passes...
@@ -129,9 +131,10 @@ static void ProcessBlock_Thread(int32_t blocknum) {
 		brushes = ChopBrushes(brushes);
 	}
 
+	ThreadUnlock();
+
 	tree = BrushBSP(brushes, mins, maxs);
 
-	ThreadUnlock();
 	block_nodes[xblock + 5][yblock + 5] = tree->head_node;
 }
 
@@ -323,6 +326,156 @@ static void CreateBSPFile(void) {
 	}
 }
 
+/**
+ * @brief Hashes everything that the BSP stage output depends on: the compile options,
+ * the brushes and their textures, and the entities' classnames and origins. Other entity
+ * keys are only written to the entity string, which is regenerated on a cache hit, so
+ * editing or moving lights does not invalidate the cached BSP unless it floods differently.
+ */
+static void HashBSPInputs(cache_key_t *key) {
+
+	const _Bool options[] = { noprune, nodetail, fulldetail, nomerge, nowater, nocsg, noweld,
+	                          noshare, notjunc, noopt, leaktest
+	                        };
+	Cache_AddKey(key, options, sizeof(options));
+
+	const int32_t blocks[] = { block_xl, block_xh, block_yl, block_yh };
+	Cache_AddKey(key, blocks, sizeof(blocks));
+	Cache_AddKey(key, &microvolume, sizeof(microvolume));
+
+	for (int32_t i = 0; i < num_map_brushes; i++) {
+		const map_brush_t *b = &map_brushes[i];
+
+		Cache_AddKey(key, &b->entity_num, sizeof(b->entity_num));
+		Cache_AddKey(key, &b->contents, sizeof(b->contents));
+		Cache_AddKey(key, &b->num_sides, sizeof(b->num_sides));
+
+		for (int32_t j = 0; j < b->num_sides; j++) {
+			const side_t *s = &b->original_sides[j];
+			const map_plane_t *p = &map_planes[s->plane_num];
+
+			Cache_AddKey(key, p->normal, sizeof(p->normal));
+			Cache_AddKey(key, &p->dist, sizeof(p->dist));
+			Cache_AddKey(key, &s->contents, sizeof(s->contents));
+			Cache_AddKey(key, &s->surf, sizeof(s->surf));
+			Cache_AddKey(key, &s->bevel, sizeof(s->bevel));
+
+			if (s->texinfo >= 0) {
+				const bsp_texinfo_t *tex = &bsp_file.texinfo[s->texinfo];
+
+				Cache_AddKey(key, tex->vecs, sizeof(tex->vecs));
+				Cache_AddKey(key, &tex->flags, sizeof(tex->flags));
+				Cache_AddKey(key, &tex->value, sizeof(tex->value));
+				Cache_AddKey(key, tex->texture, strlen(tex->texture) + 1);
+			}
+		}
+	}
+
+	for (int32_t i = 0; i < num_entities; i++) {
+		const entity_t *e = &entities[i];
+		const char *classname = ValueForKey(e, "classname");
+
+		vec3_t origin;
+		VectorForKey(e, "origin", origin);
+
+		Cache_AddKey(key, classname, strlen(classname) + 1);
+		Cache_AddKey(key, origin, sizeof(origin));
+		Cache_AddKey(key, &e->first_brush, sizeof(e->first_brush));
+		Cache_AddKey(key, &e->num_brushes, sizeof(e->num_brushes));
+	}
+}
+
+/**
+ * @brief Writes the specified buffer to a file in the write directory.
+ */
+static void WriteCachedFile(const char *filename, const void *data, size_t len) {
+
+	file_t *file = Fs_OpenWrite(filename);
+	if (!file) {
+		Com_Error(ERROR_FATAL, "Failed to open %s: %s\n", filename, Fs_LastError());
+	}
+
+	if (len && Fs_Write(file, data, len, 1) != 1) {
+		Com_Error(ERROR_FATAL, "Failed to write %s: %s\n", filename, Fs_LastError());
+	}
+
+	Fs_Close(file);
+}
+
+/**
+ * @brief Restores the BSP and portal files for the specified key, and rewrites the
+ * entity string from the map file, as -onlyents would.
+ * @return True on a cache hit, false otherwise.
+ */
+static _Bool LoadCachedBSPFile(cache_key_t *key) {
+	size_t len;
+
+	byte *data = Cache_Load(key, &len);
+	if (!data) {
+		return false;
+	}
+
+	int64_t bsp_len;
+	memcpy(&bsp_len, data, sizeof(bsp_len));
+
+	if (bsp_len <= 0 || (size_t) bsp_len > len - sizeof(bsp_len)) {
+		Com_Warn("Invalid cached BSP file\n");
+		Mem_Free(data);
+		return false;
+	}
+
+	const byte *bsp = data + sizeof(bsp_len);
+	const byte *prt = bsp + bsp_len;
+
+	WriteCachedFile(va("maps/%s.bsp", map_base), bsp, bsp_len);
+	WriteCachedFile(va("maps/%s.prt", map_base), prt, len - sizeof(bsp_len) - bsp_len);
+
+	Mem_Free(data);
+
+	const int32_t version = LoadBSPFile(va("maps/%s.bsp", map_base), BSP_LUMPS_ALL);
+
+	UnparseEntities();
+
+	WriteBSPFile(va("maps/%s.bsp", map_base), version);
+
+	Com_Print("Restored BSP from cache\n");
+	return true;
+}
+
+/**
+ * @brief Stores the BSP and portal files for the specified key. Maps which leaked have
+ * no portal file, and are not cached, so that the leak is reported on every compile.
+ */
+static void StoreCachedBSPFile(cache_key_t *key) {
+	void *bsp, *prt;
+
+	if (!cache) {
+		return;
+	}
+
+	const int64_t bsp_len = Fs_Load(va("maps/%s.bsp", map_base), &bsp);
+	const int64_t prt_len = Fs_Load(va("maps/%s.prt", map_base), &prt);
+
+	if (bsp_len > 0 && prt_len > 0) {
+		const size_t len = sizeof(bsp_len) + bsp_len + prt_len;
+		byte *data = Mem_TagMalloc(len, MEM_TAG_CACHE);
+
+		memcpy(data, &bsp_len, sizeof(bsp_len));
+		memcpy(data + sizeof(bsp_len), bsp, bsp_len);
+		memcpy(data + sizeof(bsp_len) + bsp_len, prt, prt_len);
+
+		Cache_Store(key, data, len);
+		Mem_Free(data);
+	}
+
+	if (bsp) {
+		Fs_Free(bsp);
+	}
+	if (prt) {
+		Fs_Free(prt);
+	}
+}
+
 /**
  * @brief
  */
@@ -357,7 +510,17 @@ int32_t BSP_Main(void) {
 		LoadMapFile(map_name);
 		SetModelNumbers();
 
-		ProcessModels();
+		cache_key_t key;
+		Cache_InitKey(&key, CACHE_BSP);
+
+		HashBSPInputs(&key);
+
+		if (!LoadCachedBSPFile(&key)) {
+			ProcessModels();
+			StoreCachedBSPFile(&key);
+		}
+
+		Cache_FreeKey(&key);
 	}
 
 	FreeMaterials();
@@ -95,7 +95,7 @@ typedef struct face_s {
 typedef struct brush_s {
 	struct brush_s *next;
 	vec3_t mins, maxs;
-	int32_t side, test_side; // side of node during construction
+	int32_t side; // side of node during construction
 	map_brush_t *original;
 	int32_t num_sides;
 	side_t sides[6]; // variably sized
@@ -141,6 +141,8 @@ typedef struct {
 	node_t *head_node;
 	node_t outside_node;
 	vec3_t mins, maxs;
+
+	SDL_atomic_t vis_nodes, nonvis_nodes; // counted when debugging
 } tree_t;
 
 extern int32_t entity_num;
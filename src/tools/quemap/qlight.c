@@ -34,6 +34,8 @@ vec3_t face_offset[MAX_BSP_FACES]; // for rotating bmodels
 vec_t patch_size = PATCH_SIZE;
 _Bool antialias = false;
 _Bool indirect = false;
+int32_t indirect_bounces = 1;
+_Bool bvh = false;
 
 vec3_t ambient;
 
@@ -44,6 +46,8 @@ vec_t contrast = 1.0;
 vec_t surface_scale = 1.0;
 vec_t entity_scale = 1.0;
 
+vec_t light_threshold = 0.0;
+
 /**
  * @brief
  */
@@ -121,6 +125,11 @@ static cm_bsp_model_t *cmodels[MAX_BSP_MODELS];
  */
 void Light_Trace(cm_trace_t *trace, const vec3_t start, const vec3_t end, int32_t mask) {
 
+	if (bvh) {
+		BVH_Trace(trace, start, end, mask);
+		return;
+	}
+
 	vec_t frac = 999.0;
 
 	for (int32_t i = 0; i < num_cmodels; i++) {
@@ -133,6 +142,25 @@ void Light_Trace(cm_trace_t *trace, const vec3_t start, const vec3_t end, int32_
 	}
 }
 
+/**
+ * @brief Tests whether each of the specified segments is occluded, i.e. whether
+ * Light_Trace would return a fraction less than 1.0 for it.
+ */
+void Light_Occluded(const vec3_t *starts, const vec3_t *ends, size_t count, int32_t mask, _Bool *occluded) {
+
+	if (bvh) {
+		BVH_Occluded(starts, ends, count, mask, occluded);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		cm_trace_t trace;
+		Light_Trace(&trace, starts[i], ends[i], mask);
+
+		occluded[i] = trace.fraction < 1.0;
+	}
+}
+
 /**
  * @brief
  */
@@ -150,6 +178,10 @@ static void LightWorld(void) {
 		cmodels[i] = Cm_Model(va("*%d", i));
 	}
 
+	if (bvh) {
+		BuildBVH();
+	}
+
 	// turn each face into a single patch
 	BuildPatches();
 
@@ -170,14 +202,31 @@ static void LightWorld(void) {
 		BuildVertexNormals();
 	}
 
+	const uint32_t start = SDL_GetTicks();
+
+	// hash the inputs common to all faces, so that unaffected faces may be restored
+	BuildLightingCacheKey();
+
 	// calculate direct lighting
 	RunThreadsOn(bsp_file.num_faces, true, DirectLighting);
 
+	FreeLightingCacheKey();
+
 	// free the direct light sources
 	Mem_FreeTag(MEM_TAG_LIGHT);
 
-	if (indirect) { // calculate indirect lighting
-		RunThreadsOn(bsp_file.num_faces, true, IndirectLighting);
+	if (indirect) { // calculate indirect lighting, reflecting each bounce in the next
+		for (int32_t i = 0; i < indirect_bounces; i++) {
+			RunThreadsOn(bsp_file.num_faces, true, IndirectLighting);
+			BounceIndirectLighting();
+		}
+	}
+
+	Com_Print("Traced lighting in %.2f seconds with %s\n", (SDL_GetTicks() - start) / 1000.0,
+	          bvh ? "the BVH" : "the BSP");
+
+	if (bvh) {
+		FreeBVH();
 	}
 
 	// finalize it and write it out
@@ -50,12 +50,21 @@ typedef struct patch_s {
 extern patch_t *face_patches[MAX_BSP_FACES];
 extern vec3_t face_offset[MAX_BSP_FACES]; // for rotating bmodels
 
+// bvh.c
+void BuildBVH(void);
+void FreeBVH(void);
+void BVH_Trace(cm_trace_t *trace, const vec3_t start, const vec3_t end, int32_t mask);
+void BVH_Occluded(const vec3_t *starts, const vec3_t *ends, size_t count, int32_t mask, _Bool *occluded);
+
 // lightmap.c
 void BuildLights(void);
 void BuildFaceExtents(void);
 void BuildVertexNormals(void);
+void BuildLightingCacheKey(void);
+void FreeLightingCacheKey(void);
 void DirectLighting(int32_t face_num);
 void IndirectLighting(int32_t face_num);
+void BounceIndirectLighting(void);
 void FinalizeLighting(int32_t face_num);
 
 // patches.c
@@ -71,4 +80,5 @@ _Bool Light_PointPVS(const vec3_t org, byte *pvs);
 _Bool Light_InPVS(const vec3_t point1, const vec3_t point2);
 int32_t Light_PointLeafnum(const vec3_t point);
 void Light_Trace(cm_trace_t *trace, const vec3_t start, const vec3_t end, int32_t mask);
+void Light_Occluded(const vec3_t *starts, const vec3_t *ends, size_t count, int32_t mask, _Bool *occluded);
 vec3_t *Light_AverageTextureColor(const char *name);
@@ -42,6 +42,7 @@ extern char bsp_name[MAX_OS_PATH];
 extern _Bool verbose;
 extern _Bool debug;
 extern _Bool legacy;
+extern _Bool cache;
 
 // VIS
 extern _Bool fastvis;
@@ -72,6 +73,8 @@ extern vec_t microvolume;
 // LIGHT
 extern _Bool antialias;
 extern _Bool indirect;
+extern int32_t indirect_bounces;
+extern _Bool bvh;
 
 extern vec_t brightness;
 extern vec_t saturation;
@@ -80,6 +83,8 @@ extern vec_t contrast;
 extern vec_t surface_scale;
 extern vec_t entity_scale;
 
+extern vec_t light_threshold;
+
 extern vec3_t ambient;
 
 extern vec_t patch_size;
@@ -88,8 +93,6 @@ extern vec_t patch_size;
 typedef struct semaphores_s {
 	SDL_sem *active_portals;
 	SDL_sem *active_nodes;
-	SDL_sem *vis_nodes;
-	SDL_sem *nonvis_nodes;
 	SDL_sem *active_brushes;
 	SDL_sem *active_windings;
 	SDL_sem *removed_points;
@@ -101,9 +104,9 @@ void Sem_Init(void);
 void Sem_Shutdown(void);
 
 typedef struct thread_work_s {
-	int32_t index; // current work cycle
+	SDL_atomic_t completed; // completed work cycles
 	int32_t count; // total work cycles
-	int32_t fraction; // last fraction of work completed
+	SDL_atomic_t fraction; // last fraction of work completed
 	_Bool progress; // are we reporting progress
 } thread_work_t;
 
@@ -115,6 +118,30 @@ void ThreadLock(void);
 void ThreadUnlock(void);
 void RunThreadsOn(int32_t workcount, _Bool progress, ThreadWorkFunc func);
 
+// cache.c
+typedef enum {
+	CACHE_BSP,
+	CACHE_VIS,
+	CACHE_LIGHT,
+	CACHE_STAGES
+} cache_stage_t;
+
+/**
+ * @brief A cache key, hashed from everything that a stage output depends on.
+ */
+typedef struct {
+	cache_stage_t stage;
+	GChecksum *checksum;
+} cache_key_t;
+
+void Cache_InitKey(cache_key_t *key, cache_stage_t stage);
+void Cache_CopyKey(const cache_key_t *in, cache_key_t *out);
+void Cache_AddKey(cache_key_t *key, const void *data, size_t len);
+void Cache_FreeKey(cache_key_t *key);
+void *Cache_Load(cache_key_t *key, size_t *len);
+void Cache_Store(cache_key_t *key, const void *data, size_t len);
+void Cache_Report(void);
+
 enum {
 	MEM_TAG_QUEMAP	= 1000,
 	MEM_TAG_TREE,
@@ -124,9 +151,11 @@ enum {
 	MEM_TAG_FACE,
 	MEM_TAG_VIS,
 	MEM_TAG_LIGHT,
+	MEM_TAG_BVH,
 	MEM_TAG_FACE_LIGHTING,
 	MEM_TAG_PATCH,
 	MEM_TAG_WINDING,
 	MEM_TAG_PORTAL,
-	MEM_TAG_ASSET
+	MEM_TAG_ASSET,
+	MEM_TAG_CACHE
 };
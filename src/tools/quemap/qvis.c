@@ -440,6 +440,35 @@ static void CalcPHS(void) {
 	}
 }
 
+/**
+ * @brief Restores the visibility data for the specified key.
+ * @return True on a cache hit, false otherwise.
+ */
+static _Bool LoadCachedVis(cache_key_t *key) {
+	size_t len;
+
+	byte *data = Cache_Load(key, &len);
+	if (!data) {
+		return false;
+	}
+
+	if (len > MAX_BSP_VISIBILITY) {
+		Com_Warn("Invalid cached VIS data\n");
+		Mem_Free(data);
+		return false;
+	}
+
+	Bsp_AllocLump(&bsp_file, BSP_LUMP_VISIBILITY, MAX_BSP_VISIBILITY);
+
+	memcpy(bsp_file.vis_data.raw, data, len);
+	bsp_file.vis_data_size = (int32_t) len;
+
+	Mem_Free(data);
+
+	Com_Print("Restored VIS data from cache: %d bytes\n", bsp_file.vis_data_size);
+	return true;
+}
+
 /**
  * @brief
  */
@@ -455,15 +484,45 @@ int32_t VIS_Main(void) {
 		Com_Error(ERROR_FATAL, "Empty map\n");
 	}
 
-	LoadPortals(va("maps/%s.prt", map_base));
+	// the visibility data depends only on the portal file and our options
+	cache_key_t key;
+	Cache_InitKey(&key, CACHE_VIS);
 
-	CalcVis();
+	Cache_AddKey(&key, &fastvis, sizeof(fastvis));
+	Cache_AddKey(&key, &nosort, sizeof(nosort));
 
-	CalcPHS();
+	_Bool hashed = false;
+
+	if (cache) {
+		void *prt;
+		const int64_t len = Fs_Load(va("maps/%s.prt", map_base), &prt);
+
+		if (len > 0) {
+			Cache_AddKey(&key, prt, len);
+			Fs_Free(prt);
+
+			hashed = true;
+		}
+	}
+
+	if (!hashed || !LoadCachedVis(&key)) {
+
+		LoadPortals(va("maps/%s.prt", map_base));
+
+		CalcVis();
+
+		CalcPHS();
+
+		bsp_file.vis_data_size = (int32_t) (ptrdiff_t) (map_vis.pointer - bsp_file.vis_data.raw);
+		Com_Print("VIS data: %d bytes (compressed from %u bytes)\n", bsp_file.vis_data_size,
+		          (uint32_t) (map_vis.uncompressed_size * 2));
+
+		if (hashed) {
+			Cache_Store(&key, bsp_file.vis_data.raw, bsp_file.vis_data_size);
+		}
+	}
 
-	bsp_file.vis_data_size = (int32_t) (ptrdiff_t) (map_vis.pointer - bsp_file.vis_data.raw);
-	Com_Print("VIS data: %d bytes (compressed from %u bytes)\n", bsp_file.vis_data_size,
-	          (uint32_t) (map_vis.uncompressed_size * 2));
+	Cache_FreeKey(&key);
 
 	WriteBSPFile(va("maps/%s.bsp", map_base), version);
 
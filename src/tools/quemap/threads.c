@@ -34,8 +34,6 @@ void Sem_Init(void) {
 
 	semaphores.active_portals = SDL_CreateSemaphore(0);
 	semaphores.active_nodes = SDL_CreateSemaphore(0);
-	semaphores.vis_nodes = SDL_CreateSemaphore(0);
-	semaphores.nonvis_nodes = SDL_CreateSemaphore(0);
 	semaphores.active_brushes = SDL_CreateSemaphore(0);
 	semaphores.active_windings = SDL_CreateSemaphore(0);
 	semaphores.removed_points = SDL_CreateSemaphore(0);
@@ -48,64 +46,59 @@ void Sem_Shutdown(void) {
 
 	SDL_DestroySemaphore(semaphores.active_portals);
 	SDL_DestroySemaphore(semaphores.active_nodes);
-	SDL_DestroySemaphore(semaphores.vis_nodes);
-	SDL_DestroySemaphore(semaphores.nonvis_nodes);
 	SDL_DestroySemaphore(semaphores.active_brushes);
 	SDL_DestroySemaphore(semaphores.active_windings);
 	SDL_DestroySemaphore(semaphores.removed_points);
 }
 
 /**
- * @brief Return an iteration of work, updating progress when appropriate.
+ * @brief Records the completion of an iteration of work, and outputs progress
+ * when appropriate. The thread that advances the fraction prints it, so no
+ * lock is required.
  */
-static int32_t GetThreadWork(void) {
-
-	ThreadLock();
-
-	if (thread_work.index == thread_work.count || !Com_WasInit(QUETOO_MAPTOOL)) { // done or killed
-		ThreadUnlock();
-		return -1;
-	}
-
-	// update work fraction and output progress if desired
-	const int32_t f = 50 * thread_work.index / thread_work.count;
-	if (f != thread_work.fraction) {
-		if (thread_work.progress && !(verbose || debug)) {
-			for (int32_t i = thread_work.fraction; i < f; i++) {
-				if (i % 5 == 0) {
-					Com_Print("%i", i / 5);
-				} else {
-					Com_Print(".");
+static void ThreadProgress(void) {
+
+	const int32_t completed = SDL_AtomicAdd(&thread_work.completed, 1) + 1;
+	const int32_t f = 50 * completed / thread_work.count;
+
+	int32_t fraction = SDL_AtomicGet(&thread_work.fraction);
+	while (f > fraction) {
+
+		if (SDL_AtomicCAS(&thread_work.fraction, fraction, f)) {
+			if (thread_work.progress && !(verbose || debug)) {
+				for (int32_t i = fraction; i < f; i++) {
+					if (i % 5 == 0) {
+						Com_Print("%i", i / 5);
+					} else {
+						Com_Print(".");
+					}
 				}
 			}
+			break;
 		}
-		thread_work.fraction = f;
-	}
-
-	// assign the next work iteration
-	const int32_t r = thread_work.index;
-	thread_work.index++;
-
-	ThreadUnlock();
 
-	return r;
+		fraction = SDL_AtomicGet(&thread_work.fraction);
+	}
 }
 
 // generic function pointer to actual work to be done
 static ThreadWorkFunc WorkFunction;
 
 /**
- * @brief Shared work entry point by all threads. Retrieve and perform
- * chunks of work iteratively until work is finished.
+ * @brief ThreadRangeFunc shared by all threads. Performs a chunk of work
+ * claimed by Thread_ParallelFor.
  */
-static void ThreadWork(void *p) {
+static void ThreadWork(int32_t begin, int32_t end, void *data) {
 
-	while (true) {
-		const int32_t work = GetThreadWork();
-		if (work == -1) {
-			break;
+	for (int32_t i = begin; i < end; i++) {
+
+		if (!Com_WasInit(QUETOO_MAPTOOL)) { // killed
+			return;
 		}
-		WorkFunction(work);
+
+		WorkFunction(i);
+
+		ThreadProgress();
 	}
 }
 
@@ -140,28 +133,17 @@ void ThreadUnlock(void) {
  */
 static void RunThreads(void) {
 
-	const uint16_t thread_count = Thread_Count();
-
-	if (thread_count == 0) {
-		ThreadWork(0);
-		return;
+	if (Thread_Count()) {
+		assert(!lock);
+		lock = SDL_CreateMutex();
 	}
 
-	assert(!lock);
-	lock = SDL_CreateMutex();
+	Thread_ParallelFor(0, thread_work.count, 0, ThreadWork, NULL);
 
-	thread_t *threads[thread_count];
-
-	for (uint16_t i = 0; i < thread_count; i++) {
-		threads[i] = Thread_Create(ThreadWork, NULL);
-	}
-
-	for (uint16_t i = 0; i < thread_count; i++) {
-		Thread_Wait(threads[i]);
+	if (lock) {
+		SDL_DestroyMutex(lock);
+		lock = NULL;
 	}
-
-	SDL_DestroyMutex(lock);
-	lock = NULL;
 }
 
 /**
@@ -169,9 +151,9 @@ static void RunThreads(void) {
  */
 void RunThreadsOn(int32_t work_count, _Bool progress, ThreadWorkFunc func) {
 
-	thread_work.index = 0;
+	SDL_AtomicSet(&thread_work.completed, 0);
 	thread_work.count = work_count;
-	thread_work.fraction = 0;
+	SDL_AtomicSet(&thread_work.fraction, 0);
 	thread_work.progress = progress;
 
 	WorkFunction = func;